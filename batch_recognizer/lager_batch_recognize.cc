@@ -0,0 +1,458 @@
+/*
+ * lager_batch_recognize.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <stdint.h>
+#include <stdlib.h>     // for atoi
+#include <atomic>
+using std::atomic;
+#include <chrono>
+using std::chrono::duration;
+using std::chrono::steady_clock;
+#include <fstream>
+using std::ifstream;
+using std::ofstream;
+#include <iostream>
+using std::cout;
+using std::endl;
+using std::istream;
+#include <sstream>
+using std::stringstream;
+#include <string>
+using std::string;
+#include <thread>
+using std::thread;
+#include <vector>
+using std::vector;
+
+#include "lager_distance.h"
+#include "lager_ranking.h"
+#include "lager_run_length.h"
+
+#define BATCH_RECOGNIZER_ERROR -1
+#define BATCH_RECOGNIZER_NO_ERROR 0
+
+/// Number of input gestures read, recognized and written at a time
+#define BATCH_CHUNK_SIZE 65536
+/// Number of input gestures a worker thread takes from the chunk at a time
+#define BATCH_WORK_UNIT 64
+
+/**
+ * Input gesture, with the name it is expected to be recognized as, if known.
+ */
+struct BatchInput {
+  string expected_name;
+  string lager;
+};
+
+/**
+ * Recognition result for an input gesture. The runner-up is the closest
+ * gesture with a different name, or -1 if there is none.
+ */
+struct BatchResult {
+  int closest_gesture;
+  int distance;
+  float distance_pct;
+  int threshold_pct;
+  int runner_up_gesture;
+  float runner_up_distance_pct;
+};
+
+/**
+ * Scratch state of a worker thread, reused across input gestures.
+ */
+struct BatchWorkerState {
+  /// Closest gesture and closest one with a different name
+  vector<LagerTemplateScore> closest;
+};
+
+/**
+ * Shared state of the worker threads that recognize a chunk.
+ */
+struct BatchChunkWork {
+  const vector<LagerTemplate>* gestures;
+  const vector<BatchInput>* inputs;
+  vector<BatchResult>* results;
+  bool use_run_length_distance;
+  atomic<size_t> next_input;
+};
+
+/**
+ * Reads the program arguments and returns whether a given string is present
+ */
+bool DetermineArgumentPresent(const int argc, const char** argv,
+                              const char* string_to_find) {
+  bool string_found = false;
+
+  if (argc > 1) {
+    int i = 1;
+    for (; i < argc; i++) {
+      string_found = std::string(argv[i]).find(string_to_find)
+          != std::string::npos;
+      if (string_found) {
+        break;
+      }
+    }
+  }
+
+  return string_found;
+}
+
+/**
+ * Reads the program arguments and returns the value that follows a given
+ * argument, or a default value if the argument is not present.
+ */
+string DetermineArgumentValue(const int argc, const char** argv,
+                              const char* string_to_find,
+                              const string& default_value) {
+  for (int i = 1; i < argc - 1; i++) {
+    if (string(argv[i]) == string_to_find) {
+      return string(argv[i + 1]);
+    }
+  }
+
+  return default_value;
+}
+
+/**
+ * Reads the program arguments and returns the number of worker threads set
+ * with --threads, or one per core if it is not set.
+ */
+unsigned int DetermineThreadCount(const int argc, const char** argv) {
+  int num_threads = atoi(DetermineArgumentValue(argc, argv, "--threads",
+                                                "0").c_str());
+
+  if (num_threads <= 0) {
+    num_threads = thread::hardware_concurrency();
+  }
+
+  return (num_threads > 0) ? num_threads : 1;
+}
+
+/**
+ * Takes the name of a gestures file, in the same format as the gestures.dat
+ * file read by lager_recognizer, and stores its gestures in a vector.
+ */
+int GetGesturesFromFile(const string& file_name,
+                        vector<LagerTemplate>& gestures) {
+  ifstream gestures_file(file_name.c_str());
+  string current_line;
+
+  if (!gestures_file.is_open()) {
+    return BATCH_RECOGNIZER_ERROR;
+  }
+
+  while (getline(gestures_file, current_line)) {
+    stringstream ss(current_line);
+    LagerTemplate new_gesture;
+
+    string lager;
+    ss >> new_gesture.name >> lager;
+    if (lager.empty()) {
+      continue;
+    }
+
+    PrepareLagerTemplate(lager, new_gesture);
+    gestures.push_back(new_gesture);
+  }
+
+  return BATCH_RECOGNIZER_NO_ERROR;
+}
+
+/*
+ * Reads a length-prefixed string from a binary input file.
+ */
+bool ReadBinaryString(istream& input_file, string& value) {
+  uint32_t length;
+
+  if (!input_file.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+    return false;
+  }
+
+  value.resize(length);
+  return length == 0 || input_file.read(&value[0], length);
+}
+
+/**
+ * Takes an input file and reads up to BATCH_CHUNK_SIZE input gestures from it,
+ * replacing the contents of inputs. Returns the number of gestures read.
+ *
+ * Text files hold one gesture per line, either a LaGeR string alone or the
+ * expected gesture name followed by the LaGeR string. Binary files hold one
+ * record per gesture: the expected name and the LaGeR string, each preceded
+ * by its length as a native-endian 32-bit integer. An empty name means that
+ * the expected gesture is not known.
+ */
+size_t ReadInputChunk(istream& input_file, bool binary_input,
+                      vector<BatchInput>& inputs) {
+  string current_line;
+
+  inputs.resize(BATCH_CHUNK_SIZE);
+  size_t num_inputs = 0;
+
+  while (num_inputs < BATCH_CHUNK_SIZE) {
+    BatchInput& input = inputs[num_inputs];
+
+    if (binary_input) {
+      if (!ReadBinaryString(input_file, input.expected_name)
+          || !ReadBinaryString(input_file, input.lager)) {
+        break;
+      }
+    } else {
+      if (!getline(input_file, current_line)) {
+        break;
+      }
+
+      stringstream ss(current_line);
+      string first_field, second_field;
+      ss >> first_field >> second_field;
+      if (first_field.empty()) {
+        continue;
+      }
+
+      if (second_field.empty()) {
+        input.expected_name.clear();
+        input.lager = first_field;
+      } else {
+        input.expected_name = first_field;
+        input.lager = second_field;
+      }
+    }
+
+    num_inputs++;
+  }
+
+  inputs.resize(num_inputs);
+  return num_inputs;
+}
+
+/*
+ * Takes an input gesture and finds its closest gesture and the closest one
+ * with a different name. Ties go to the gesture that comes first in the
+ * gestures file.
+ */
+void RecognizeInput(const vector<LagerTemplate>& gestures,
+                    const BatchInput& input, bool use_run_length_distance,
+                    struct BatchWorkerState& state, BatchResult& result) {
+  result.closest_gesture = -1;
+  result.distance = 0;
+  result.distance_pct = 0;
+  result.threshold_pct = GetLagerDistanceThresholdPct(input.lager);
+  result.runner_up_gesture = -1;
+  result.runner_up_distance_pct = 0;
+
+  RankLagerTemplates(gestures, input.lager, use_run_length_distance, 2, true,
+                     [](const LagerTemplate&) { return true; },
+                     state.closest);
+
+  if (state.closest.size() > 0) {
+    result.closest_gesture = state.closest[0].gesture_index;
+    result.distance = state.closest[0].distance;
+    result.distance_pct = state.closest[0].distance_pct;
+  }
+  if (state.closest.size() > 1) {
+    result.runner_up_gesture = state.closest[1].gesture_index;
+    result.runner_up_distance_pct = state.closest[1].distance_pct;
+  }
+}
+
+/*
+ * Worker thread: takes units of work from the chunk until none are left.
+ */
+void RecognizeChunkInputs(struct BatchChunkWork* work) {
+  struct BatchWorkerState state;
+  size_t num_inputs = work->inputs->size();
+
+  while (true) {
+    size_t first_input = work->next_input.fetch_add(BATCH_WORK_UNIT);
+    if (first_input >= num_inputs) {
+      break;
+    }
+
+    size_t last_input = first_input + BATCH_WORK_UNIT;
+    if (last_input > num_inputs) {
+      last_input = num_inputs;
+    }
+
+    for (size_t i = first_input; i < last_input; i++) {
+      RecognizeInput(*work->gestures, (*work->inputs)[i],
+                     work->use_run_length_distance, state,
+                     (*work->results)[i]);
+    }
+  }
+}
+
+/**
+ * Takes a chunk of input gestures and recognizes them against the gestures
+ * using num_threads worker threads.
+ */
+void RecognizeChunk(const vector<LagerTemplate>& gestures,
+                    const vector<BatchInput>& inputs,
+                    bool use_run_length_distance, unsigned int num_threads,
+                    vector<BatchResult>& results) {
+  struct BatchChunkWork work;
+  vector<thread> threads;
+
+  results.resize(inputs.size());
+  work.gestures = &gestures;
+  work.inputs = &inputs;
+  work.results = &results;
+  work.use_run_length_distance = use_run_length_distance;
+  work.next_input = 0;
+
+  for (unsigned int i = 0; i < num_threads; i++) {
+    threads.push_back(thread(RecognizeChunkInputs, &work));
+  }
+  for (vector<thread>::iterator it = threads.begin(); it < threads.end();
+      ++it) {
+    it->join();
+  }
+}
+
+/**
+ * Writes the header of the results file, with one tab-separated column per
+ * result field.
+ */
+void WriteResultsHeader(ofstream& results_file) {
+  results_file << "index\texpected\trecognized\tmatch\tdistance\tdistance_pct"
+               << "\tthreshold_pct\trunner_up\trunner_up_distance_pct" << endl;
+}
+
+/**
+ * Takes a chunk of inputs and their results, and writes one row per input.
+ * Returns the number of inputs with an expected name that were recognized as
+ * that name, and adds the number of inputs with an expected name to
+ * num_labelled_inputs.
+ */
+size_t WriteResultsChunk(ofstream& results_file, size_t first_index,
+                         const vector<LagerTemplate>& gestures,
+                         const vector<BatchInput>& inputs,
+                         const vector<BatchResult>& results,
+                         size_t& num_labelled_inputs) {
+  size_t num_correct_inputs = 0;
+
+  for (size_t i = 0; i < inputs.size(); i++) {
+    const BatchResult& result = results[i];
+    bool match = result.closest_gesture >= 0
+        && result.distance_pct <= result.threshold_pct;
+    const string& recognized_name = (result.closest_gesture >= 0) ?
+        gestures[result.closest_gesture].name : "-";
+
+    results_file << first_index + i << '\t'
+                 << (inputs[i].expected_name.empty() ?
+                     "-" : inputs[i].expected_name) << '\t'
+                 << recognized_name << '\t' << match << '\t'
+                 << result.distance << '\t' << result.distance_pct << '\t'
+                 << result.threshold_pct << '\t';
+
+    if (result.runner_up_gesture >= 0) {
+      results_file << gestures[result.runner_up_gesture].name << '\t'
+                   << result.runner_up_distance_pct << '\n';
+    } else {
+      results_file << "-\t-\n";
+    }
+
+    if (!inputs[i].expected_name.empty()) {
+      num_labelled_inputs++;
+      if (match && recognized_name == inputs[i].expected_name) {
+        num_correct_inputs++;
+      }
+    }
+  }
+
+  return num_correct_inputs;
+}
+
+/**
+ * Recognizes every gesture in an input file against a gestures file and
+ * writes the results in tab-separated columns.
+ *
+ * Usage: lager_batch_recognize --input <file> [--binary_input]
+ *            [--gestures <file>] [--output <file>] [--threads <count>]
+ *            [--run_length_distance]
+ */
+int main(int argc, const char *argv[]) {
+  string input_file_name = DetermineArgumentValue(argc, argv, "--input", "");
+  string gestures_file_name = DetermineArgumentValue(argc, argv, "--gestures",
+                                                     "gestures.dat");
+  string results_file_name = DetermineArgumentValue(argc, argv, "--output",
+                                                    "batch_results.tsv");
+  bool binary_input = DetermineArgumentPresent(argc, argv, "--binary_input");
+  bool use_run_length_distance = DetermineArgumentPresent(
+      argc, argv, "--run_length_distance");
+  unsigned int num_threads = DetermineThreadCount(argc, argv);
+  vector<LagerTemplate> gestures;
+
+  if (input_file_name.empty()) {
+    cout << "Usage: lager_batch_recognize --input <file> [--binary_input] "
+         << "[--gestures <file>] [--output <file>] [--threads <count>] "
+         << "[--run_length_distance]" << endl;
+    return BATCH_RECOGNIZER_ERROR;
+  }
+
+  if (GetGesturesFromFile(gestures_file_name, gestures)
+      == BATCH_RECOGNIZER_ERROR || gestures.empty()) {
+    cout << "Could not read any gestures from " << gestures_file_name << endl;
+    return BATCH_RECOGNIZER_ERROR;
+  }
+
+  ifstream input_file(input_file_name.c_str(),
+                      binary_input ? std::ios::binary : std::ios::in);
+  if (!input_file.is_open()) {
+    cout << "Could not open " << input_file_name << endl;
+    return BATCH_RECOGNIZER_ERROR;
+  }
+
+  ofstream results_file(results_file_name.c_str());
+  if (!results_file.is_open()) {
+    cout << "Could not open " << results_file_name << endl;
+    return BATCH_RECOGNIZER_ERROR;
+  }
+
+  cout << "Recognizing " << input_file_name << " against "
+       << gestures.size() << " gestures with "
+       << (use_run_length_distance ? "run-length" : "Damerau-Levenshtein")
+       << " distances on " << num_threads << " threads." << endl;
+
+  vector<BatchInput> inputs;
+  vector<BatchResult> results;
+  size_t num_inputs = 0;
+  size_t num_labelled_inputs = 0;
+  size_t num_correct_inputs = 0;
+  double recognition_seconds = 0;
+  steady_clock::time_point start_time = steady_clock::now();
+
+  WriteResultsHeader(results_file);
+
+  while (ReadInputChunk(input_file, binary_input, inputs) > 0) {
+    steady_clock::time_point chunk_start_time = steady_clock::now();
+    RecognizeChunk(gestures, inputs, use_run_length_distance, num_threads,
+                   results);
+    recognition_seconds += duration<double>(steady_clock::now()
+        - chunk_start_time).count();
+
+    num_correct_inputs += WriteResultsChunk(results_file, num_inputs, gestures,
+                                            inputs, results,
+                                            num_labelled_inputs);
+    num_inputs += inputs.size();
+  }
+
+  results_file.close();
+  double total_seconds = duration<double>(steady_clock::now()
+      - start_time).count();
+
+  cout << "Recognized " << num_inputs << " gestures in " << total_seconds
+       << " s (" << ((total_seconds > 0) ? num_inputs / total_seconds : 0)
+       << " gestures/s overall, "
+       << ((recognition_seconds > 0) ? num_inputs / recognition_seconds : 0)
+       << " gestures/s recognizing)." << endl;
+  if (num_labelled_inputs > 0) {
+    cout << "Correct:\t" << num_correct_inputs << " of "
+         << num_labelled_inputs << " labelled gestures" << endl;
+  }
+  cout << "Results written to " << results_file_name << endl;
+
+  return BATCH_RECOGNIZER_NO_ERROR;
+}
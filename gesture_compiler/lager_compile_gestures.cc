@@ -0,0 +1,230 @@
+/*
+ * lager_compile_gestures.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <fstream>
+using std::ifstream;
+using std::ofstream;
+#include <iostream>
+using std::cout;
+using std::endl;
+using std::ostream;
+#include <sstream>
+using std::stringstream;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "lager_distance.h"
+#include "lager_gesture_library.h"
+#include "lager_gesture_plugin.h"
+#include "lager_run_length.h"
+
+#define GESTURE_COMPILER_ERROR -1
+#define GESTURE_COMPILER_NO_ERROR 0
+
+/**
+ * Gesture from the gestures file, with the representations that are compiled
+ * into the plugin.
+ */
+struct CompiledGesture {
+  string name;
+  string lager;
+  RunLengthLager run_length;
+  struct LagerHistogram histogram;
+};
+
+/**
+ * Reads the program arguments and returns the value that follows a given
+ * argument, or a default value if the argument is not present.
+ */
+string DetermineArgumentValue(const int argc, const char** argv,
+                              const char* string_to_find,
+                              const string& default_value) {
+  for (int i = 1; i < argc - 1; i++) {
+    if (string(argv[i]) == string_to_find) {
+      return string(argv[i + 1]);
+    }
+  }
+
+  return default_value;
+}
+
+/**
+ * Takes the name of a gestures file and appends its gestures, encoded, to the
+ * given vector.
+ */
+int GetGesturesFromFile(const string& file_name,
+                        vector<CompiledGesture>& gestures) {
+  ifstream gestures_file(file_name.c_str());
+  string current_line;
+
+  if (!gestures_file.is_open()) {
+    return GESTURE_COMPILER_ERROR;
+  }
+
+  while (getline(gestures_file, current_line)) {
+    stringstream ss(current_line);
+    CompiledGesture new_gesture;
+
+    ss >> new_gesture.name >> new_gesture.lager;
+    if (new_gesture.lager.empty()) {
+      continue;
+    }
+
+    EncodeRunLengthLager(new_gesture.lager, new_gesture.run_length);
+    ComputeLagerHistogram(new_gesture.lager, new_gesture.histogram);
+    gestures.push_back(new_gesture);
+  }
+
+  return GESTURE_COMPILER_NO_ERROR;
+}
+
+/**
+ * Takes an output stream and a string, and writes the string as a C++ string
+ * literal.
+ */
+void WriteStringLiteral(ostream& output, const string& value) {
+  output << '"';
+  for (string::const_iterator it = value.begin(); it < value.end(); ++it) {
+    if (*it == '"' || *it == '\\') {
+      output << '\\';
+    }
+    output << *it;
+  }
+  output << '"';
+}
+
+/**
+ * Takes an output stream, the name of the gestures file and its gestures, and
+ * writes the translation unit of a plugin holding them.
+ */
+void WritePluginSource(ostream& output, const string& gestures_file_name,
+                       const vector<CompiledGesture>& gestures) {
+  output << "/*" << endl
+         << " * Generated by lager_compile_gestures from "
+         << gestures_file_name << "." << endl
+         << " * Do not edit." << endl
+         << " */" << endl << endl
+         << "#include \"lager_gesture_plugin.h\"" << endl << endl
+         << "namespace {" << endl << endl;
+
+  for (size_t i = 0; i < gestures.size(); i++) {
+    const vector<LagerRun>& runs = gestures[i].run_length.runs;
+
+    output << "// " << gestures[i].name << endl
+           << "constexpr struct LagerRun kRuns" << i << "[] = {" << endl;
+    for (size_t j = 0; j < runs.size(); j++) {
+      output << "  {0x" << std::hex << runs[j].symbol << std::dec << "ULL, "
+             << runs[j].count << "}," << endl;
+    }
+    output << "};" << endl << endl;
+  }
+
+  output << "constexpr struct LagerPluginGesture kGestures[] = {" << endl;
+  for (size_t i = 0; i < gestures.size(); i++) {
+    const CompiledGesture& gesture = gestures[i];
+
+    output << "  {";
+    WriteStringLiteral(output, gesture.name);
+    output << ", ";
+    WriteStringLiteral(output, gesture.lager);
+    output << "," << endl
+           << "   kRuns" << i << ", " << gesture.run_length.runs.size() << ", "
+           << gesture.run_length.num_movements << ", "
+           << gesture.run_length.symbol_width << "," << endl
+           << "   {{";
+    for (int j = 0; j < LAGER_HISTOGRAM_BINS; j++) {
+      output << (j > 0 ? ", " : "") << gesture.histogram.counts[j];
+    }
+    output << "}, " << gesture.histogram.length << "}}," << endl;
+  }
+  output << "};" << endl << endl;
+
+  output << "constexpr struct LagerGesturePlugin kPlugin = {" << endl
+         << "  LAGER_GESTURE_PLUGIN_VERSION, ";
+  WriteStringLiteral(output, gestures_file_name);
+  output << ", " << gestures.size() << ", kGestures" << endl
+         << "};" << endl << endl
+         << "}  // namespace" << endl << endl
+         << "extern \"C\" const struct LagerGesturePlugin* "
+         << LAGER_GESTURE_PLUGIN_SYMBOL << "() {" << endl
+         << "  return &kPlugin;" << endl
+         << "}" << endl;
+}
+
+/**
+ * Takes the name of a gesture library and its gestures, and writes them to
+ * it. Returns whether the library could be written.
+ */
+bool WriteLibrary(const string& library_file_name,
+                  const vector<CompiledGesture>& gestures) {
+  vector<string> names, lagers;
+  for (size_t i = 0; i < gestures.size(); i++) {
+    names.push_back(gestures[i].name);
+    lagers.push_back(gestures[i].lager);
+  }
+
+  return WriteLagerGestureLibrary(library_file_name, names, lagers);
+}
+
+/**
+ * Reads a gestures file and writes either a C++ translation unit that
+ * compiles into a gesture plugin for lager_recognizer --gesture_plugin, or,
+ * if the output file name ends in .lgb, a gesture library for
+ * lager_recognizer --gesture_library.
+ */
+int main(int argc, const char *argv[]) {
+  string gestures_file_name = DetermineArgumentValue(argc, argv, "--gestures",
+                                                     "");
+  string output_file_name = DetermineArgumentValue(argc, argv, "--output", "");
+  vector<CompiledGesture> gestures;
+
+  if (gestures_file_name.empty() || output_file_name.empty()) {
+    cout << "Usage: lager_compile_gestures --gestures <file> "
+         << "--output <file.cc|file.lgb>" << endl;
+    return GESTURE_COMPILER_ERROR;
+  }
+
+  if (GetGesturesFromFile(gestures_file_name, gestures)
+      == GESTURE_COMPILER_ERROR || gestures.empty()) {
+    cout << "Could not read any gestures from " << gestures_file_name << endl;
+    return GESTURE_COMPILER_ERROR;
+  }
+
+  string library_extension = ".lgb";
+  if (output_file_name.size() > library_extension.size()
+      && output_file_name.compare(
+          output_file_name.size() - library_extension.size(),
+          library_extension.size(), library_extension) == 0) {
+    if (!WriteLibrary(output_file_name, gestures)) {
+      cout << "Could not write " << output_file_name << endl;
+      return GESTURE_COMPILER_ERROR;
+    }
+
+    cout << "Stored " << gestures.size() << " gestures from "
+         << gestures_file_name << " in " << output_file_name << endl;
+    return GESTURE_COMPILER_NO_ERROR;
+  }
+
+  ofstream output_file(output_file_name.c_str());
+  if (!output_file.is_open()) {
+    cout << "Could not open " << output_file_name << endl;
+    return GESTURE_COMPILER_ERROR;
+  }
+
+  // Only the file name is recorded, so builds do not depend on the directory
+  size_t last_slash = gestures_file_name.find_last_of('/');
+  WritePluginSource(output_file,
+                    (last_slash == string::npos) ? gestures_file_name :
+                        gestures_file_name.substr(last_slash + 1),
+                    gestures);
+
+  cout << "Compiled " << gestures.size() << " gestures from "
+       << gestures_file_name << " into " << output_file_name << endl;
+
+  return GESTURE_COMPILER_NO_ERROR;
+}
@@ -1,5 +1,9 @@
+#include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <unistd.h>
+#include <stdlib.h>   // for atol
+#include <string.h>   // for memset, strncpy
 #include <string>
 #include <iostream>
 #include <vector>
@@ -20,6 +24,9 @@ using std::ostringstream;
 using std::string;
 using std::stringstream;
 
+/// Identifier of the latest request sent to the recognition service
+static unsigned long g_last_recognition_request_id = 0;
+
 #define MAX_NUM_MSG 100
 
 void CreateGestureSubscriptionQueue() {
@@ -34,7 +41,10 @@ void CreateGestureSubscriptionQueue() {
   }
 }
 
-void AddSubscribedGestures(vector<SubscribedGesture>* subscribed_gestures) {
+void AddSubscribedGestures(
+    vector<SubscribedGesture>* subscribed_gestures,
+    std::mutex* subscribed_gestures_mutex,
+    std::atomic<unsigned int>* subscribed_gestures_generation) {
   while (true) {
     GestureSubscriptionMessage message = GetGestureSubscriptionMessage();
 
@@ -44,12 +54,114 @@ void AddSubscribedGestures(vector<SubscribedGesture>* subscribed_gestures) {
     cout << "Lager: \"" << message.gesture_lager() << endl;
     cout << endl;
 
-    SubscribedGesture subscription;
-    subscription.name = message.gesture_name();
-    subscription.lager = message.gesture_lager();
-    subscription.pid = message.pid();
-    subscribed_gestures->push_back(subscription);
+    if (!message.gesture_context().empty()) {
+      cout << "Context: \"" << message.gesture_context() << "\"" << endl;
+      cout << endl;
+    }
+
+    bool gesture_added;
+    {
+      // Appending may move the gestures other threads are reading
+      std::lock_guard<std::mutex> lock(*subscribed_gestures_mutex);
+      gesture_added = AddGestureSubscriber(subscribed_gestures,
+                                           message.gesture_name(),
+                                           message.gesture_lager(),
+                                           message.pid(),
+                                           message.gesture_context());
+      (*subscribed_gestures_generation)++;
+    }
+
+    if (!gesture_added) {
+      cout << "Gesture already subscribed, added PID " << message.pid()
+           << " to its subscribers." << endl;
+      cout << endl;
+    }
+  }
+}
+
+bool AddGestureSubscriber(vector<SubscribedGesture>* subscribed_gestures,
+                          string gesture_name, string gesture_lager,
+                          pid_t pid, string gesture_context) {
+  GestureSubscriber subscriber;
+  subscriber.name = gesture_name;
+  subscriber.pid = pid;
+  subscriber.context = gesture_context;
+
+  for (vector<SubscribedGesture>::iterator it = subscribed_gestures->begin();
+      it < subscribed_gestures->end(); ++it) {
+    if (it->lager != gesture_lager) {
+      continue;
+    }
+
+    // The same process subscribing twice still gets a single notification
+    for (vector<GestureSubscriber>::iterator subscriber_it =
+        it->subscribers.begin(); subscriber_it < it->subscribers.end();
+        ++subscriber_it) {
+      if (subscriber_it->name == gesture_name && subscriber_it->pid == pid
+          && subscriber_it->context == gesture_context) {
+        return false;
+      }
+    }
+
+    it->subscribers.push_back(subscriber);
+    return false;
   }
+
+  SubscribedGesture subscription;
+  subscription.name = gesture_name;
+  subscription.lager = gesture_lager;
+  subscription.pid = pid;
+  subscription.subscribers.push_back(subscriber);
+  subscribed_gestures->push_back(subscription);
+
+  return true;
+}
+
+bool IsGestureContextActive(const string& gesture_context,
+                            const vector<string>& active_contexts) {
+  if (gesture_context.empty()) {
+    return true;
+  }
+
+  for (vector<string>::const_iterator it = active_contexts.begin();
+      it < active_contexts.end(); ++it) {
+    if (*it == gesture_context) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ActiveGestureContexts::SetProcessContexts(
+    pid_t pid, const vector<string>& active_contexts) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (active_contexts.empty()) {
+    process_contexts_.erase(pid);
+  } else {
+    process_contexts_[pid] = active_contexts;
+  }
+  generation_++;
+}
+
+vector<string> ActiveGestureContexts::GetActiveContexts(
+    unsigned int& generation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  vector<string> active_contexts;
+
+  for (map<pid_t, vector<string> >::iterator it = process_contexts_.begin();
+      it != process_contexts_.end(); ++it) {
+    for (vector<string>::iterator context_it = it->second.begin();
+        context_it < it->second.end(); ++context_it) {
+      if (!IsGestureContextActive(*context_it, active_contexts)) {
+        active_contexts.push_back(*context_it);
+      }
+    }
+  }
+  generation = generation_;
+
+  return active_contexts;
 }
 
 GestureSubscriptionMessage GetGestureSubscriptionMessage() {
@@ -81,9 +193,11 @@ GestureSubscriptionMessage GetGestureSubscriptionMessage() {
   return message;
 }
 
-void SendGestureSubscriptionMessage(string gesture_name, string gesture_lager) {
+void SendGestureSubscriptionMessage(string gesture_name, string gesture_lager,
+                                    string gesture_context) {
   try {
-    GestureSubscriptionMessage message(getpid(), gesture_name, gesture_lager);
+    GestureSubscriptionMessage message(getpid(), gesture_name, gesture_lager,
+                                       gesture_context);
     string queue_name = "gesture_subscription";
     stringstream output_stringstream;
 
@@ -100,7 +214,7 @@ void SendGestureSubscriptionMessage(string gesture_name, string gesture_lager) {
   }
 }
 
-void SubscribeToGesturesInFile(string file_name) {
+void SubscribeToGesturesInFile(string file_name, string gesture_context) {
   try {
     ifstream gestures_file;
     string current_line;
@@ -116,7 +230,7 @@ void SubscribeToGesturesInFile(string file_name) {
       stringstream ss(current_line);
       ss >> name >> lager;
 
-      SendGestureSubscriptionMessage(name, lager);
+      SendGestureSubscriptionMessage(name, lager, gesture_context);
     }
 
   } catch (interprocess_exception &ex) {
@@ -124,6 +238,82 @@ void SubscribeToGesturesInFile(string file_name) {
   }
 }
 
+void CreateGestureContextQueue() {
+  try {
+    //Erase previous message queue
+    message_queue::remove("gesture_context");
+
+    message_queue mq(create_only, "gesture_context",
+                     MAX_NUM_MSG, MAX_DETECTED_GESTURE_MSG_SIZE);
+  } catch (interprocess_exception &ex) {
+    std::cerr << ex.what() << std::endl;
+  }
+}
+
+void MonitorActiveGestureContexts(ActiveGestureContexts* active_contexts) {
+  while (true) {
+    GestureContextMessage message = GetGestureContextMessage();
+
+    cout << "Active contexts for PID " << message.pid() << ":";
+    for (vector<string>::const_iterator it = message.active_contexts().begin();
+        it < message.active_contexts().end(); ++it) {
+      cout << " \"" << *it << "\"";
+    }
+    cout << endl;
+
+    active_contexts->SetProcessContexts(message.pid(),
+                                        message.active_contexts());
+  }
+}
+
+GestureContextMessage GetGestureContextMessage() {
+  GestureContextMessage message;
+
+  try {
+    string queue_name = "gesture_context";
+
+    message_queue mq(open_or_create, queue_name.c_str(),
+                     MAX_NUM_MSG, MAX_DETECTED_GESTURE_MSG_SIZE);
+
+    message_queue::size_type received_size;
+    unsigned int priority;
+
+    stringstream input_stringstream;
+    string serialized_string;
+    serialized_string.resize(MAX_DETECTED_GESTURE_MSG_SIZE);
+    mq.receive(&serialized_string[0], MAX_DETECTED_GESTURE_MSG_SIZE,
+               received_size, priority);
+    input_stringstream << serialized_string;
+
+    boost::archive::text_iarchive ia(input_stringstream);
+    ia >> message;
+
+  } catch (interprocess_exception &ex) {
+    std::cerr << ex.what() << endl;
+  }
+
+  return message;
+}
+
+void SendActiveGestureContextsMessage(const vector<string>& active_contexts) {
+  try {
+    GestureContextMessage message(getpid(), active_contexts);
+    string queue_name = "gesture_context";
+    stringstream output_stringstream;
+
+    message_queue mq(open_or_create, queue_name.c_str(),
+                     MAX_NUM_MSG, MAX_DETECTED_GESTURE_MSG_SIZE);
+
+    boost::archive::text_oarchive output_archive(output_stringstream);
+    output_archive << message;
+
+    std::string serialized_string(output_stringstream.str());
+    mq.send(serialized_string.data(), serialized_string.size(), 0);
+  } catch (interprocess_exception &ex) {
+    std::cerr << ex.what() << endl;
+  }
+}
+
 /* Code structure taken from http://stackoverflow.com/a/12349823 */
 DetectedGestureMessage GetDetectedGestureMessage() {
   DetectedGestureMessage message;
@@ -179,3 +369,115 @@ void SendDetectedGestureMessage(string gesture_name, pid_t destination_pid) {
     std::cerr << ex.what() << std::endl;
   }
 }
+
+void SendDetectedGestureMessages(const SubscribedGesture& detected_gesture,
+                                 const vector<string>& active_contexts) {
+  for (vector<GestureSubscriber>::const_iterator it =
+      detected_gesture.subscribers.begin();
+      it < detected_gesture.subscribers.end(); ++it) {
+    // Gestures read from a file have no process to notify
+    if (it->pid != 0 && IsGestureContextActive(it->context, active_contexts)) {
+      SendDetectedGestureMessage(it->name, it->pid);
+    }
+  }
+}
+
+int ConnectToRecognitionService(const string& socket_path) {
+  struct sockaddr_un address;
+  int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (connection < 0) {
+    return -1;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+  if (connect(connection, (struct sockaddr*) &address, sizeof(address)) < 0) {
+    close(connection);
+    return -1;
+  }
+
+  return connection;
+}
+
+bool RequestGestureScores(int connection, const vector<string>& lagers,
+                          const string& context, unsigned int max_results,
+                          vector<vector<GestureScore> >& scores) {
+  unsigned long request_id = __sync_add_and_fetch(
+      &g_last_recognition_request_id, 1);
+  ostringstream request;
+
+  if (lagers.empty() || max_results == 0) {
+    return false;
+  }
+
+  request << request_id << ' ' << (context.empty() ? "-" : context) << ' '
+          << max_results;
+  for (vector<string>::const_iterator it = lagers.begin(); it < lagers.end();
+      ++it) {
+    request << ' ' << *it;
+  }
+  request << '\n';
+
+  string request_string = request.str();
+  size_t num_bytes_sent = 0;
+  while (num_bytes_sent < request_string.length()) {
+    ssize_t num_bytes = write(connection,
+                              request_string.data() + num_bytes_sent,
+                              request_string.length() - num_bytes_sent);
+    if (num_bytes <= 0) {
+      return false;
+    }
+    num_bytes_sent += num_bytes;
+  }
+
+  scores.assign(lagers.size(), vector<GestureScore>());
+  size_t num_responses = 0;
+  string pending_input;
+  char buffer[4096];
+
+  while (num_responses < lagers.size()) {
+    size_t line_end = pending_input.find('\n');
+    if (line_end == string::npos) {
+      ssize_t num_bytes = read(connection, buffer, sizeof(buffer));
+      if (num_bytes <= 0) {
+        return false;
+      }
+      pending_input.append(buffer, num_bytes);
+      continue;
+    }
+
+    stringstream response(pending_input.substr(0, line_end));
+    pending_input.erase(0, line_end + 1);
+
+    unsigned long response_id;
+    string lager_index_field;
+    response >> response_id >> lager_index_field;
+
+    // Responses left over from an earlier request that failed are skipped
+    if (response_id != request_id) {
+      continue;
+    }
+    if (lager_index_field == "ERROR") {
+      return false;
+    }
+
+    size_t lager_index = atol(lager_index_field.c_str());
+    unsigned int num_results = 0;
+    response >> num_results;
+    if (lager_index >= lagers.size()) {
+      return false;
+    }
+
+    for (unsigned int i = 0; i < num_results; i++) {
+      GestureScore score;
+      response >> score.name >> score.distance_pct;
+      scores[lager_index].push_back(score);
+    }
+    num_responses++;
+  }
+
+  return true;
+}
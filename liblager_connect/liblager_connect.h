@@ -3,6 +3,10 @@
 
 #include <sys/types.h>
 #include <unistd.h>
+#include <atomic>
+#include <map>
+using std::map;
+#include <mutex>
 #include <string>
 using std::string;
 #include <vector>
@@ -10,10 +14,29 @@ using std::vector;
 
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 #include <boost/thread/thread.hpp>
 
 #define MAX_DETECTED_GESTURE_MSG_SIZE 1000
 
+/// Default path of the recognizer's request/response socket
+#define RECOGNITION_SOCKET_PATH "/tmp/lager_recognition.sock"
+/// Context name that asks the recognition service to score every gesture
+#define RECOGNITION_ALL_CONTEXTS "*"
+
+/**
+ * Describes a process subscribed to a gesture
+ */
+struct GestureSubscriber {
+  /// Name the process gave to the gesture
+  string name;
+  /// PID of the subscribing process
+  pid_t pid;
+  /// Context the gesture was subscribed under, or empty if always active
+  string context;
+};
+
 /**
  * Describes the structure of a subscribed gesture
  */
@@ -26,12 +49,25 @@ struct SubscribedGesture {
   string expanded_lager;
   /// PID of the subscribing process
   pid_t pid;
+  /// Every process subscribed to this LaGeR string, the first one included
+  vector<GestureSubscriber> subscribers;
   /// Distance between this gesture and the current input
   int distance;
   /// Distance as a percent of LaGeR string length
   float distance_pct;
 };
 
+/**
+ * Describes how close a subscribed gesture is to a LaGeR string sent to the
+ * recognition service
+ */
+struct GestureScore {
+  /// Name of the gesture
+  string name;
+  /// Distance as a percent of the gesture's LaGeR string length
+  float distance_pct;
+};
+
 /**
  * Encodes and serializes detected gesture messages going from the recognizer
  * to its subscribers.
@@ -75,16 +111,20 @@ class DetectedGestureMessage {
 class GestureSubscriptionMessage {
  public:
   /**
-   * Constructor which takes a PID, gesture name, and gesture lager
-   * representation for the subscription message.
+   * Constructor which takes a PID, gesture name, gesture lager representation
+   * and gesture context for the subscription message.
    *
-   * The PID identifies the process that is requesting the subscription.
+   * The PID identifies the process that is requesting the subscription. The
+   * gesture is only recognized while its context is active, unless the
+   * context is empty.
    */
   GestureSubscriptionMessage(pid_t pid = 0, string gesture_name = "",
-                             string gesture_lager = "")
+                             string gesture_lager = "",
+                             string gesture_context = "")
       : pid_(pid),
         gesture_name_(gesture_name),
-        gesture_lager_(gesture_lager) {
+        gesture_lager_(gesture_lager),
+        gesture_context_(gesture_context) {
   }
   ;
 
@@ -100,6 +140,12 @@ class GestureSubscriptionMessage {
   string gesture_lager() const {
     return gesture_lager_;
   }
+  /**
+   * Returns the context of the gesture in the subscription message.
+   */
+  string gesture_context() const {
+    return gesture_context_;
+  }
   /**
    * Returns the PID of the process that is requesting the subscription.
    */
@@ -115,12 +161,95 @@ class GestureSubscriptionMessage {
     ar & pid_;
     ar & gesture_name_;
     ar & gesture_lager_;
+    // Messages from subscribers built before contexts existed have none
+    if (version >= 1) {
+      ar & gesture_context_;
+    }
   }
 
   string gesture_name_;
   string gesture_lager_;
   pid_t pid_;
+  string gesture_context_;
+
+};
+
+BOOST_CLASS_VERSION(GestureSubscriptionMessage, 1)
+
+/**
+ * Encodes and serializes the list of gesture contexts a subscriber has
+ * activated, going from the subscribers to the recognizer.
+ */
+class GestureContextMessage {
+ public:
+  /**
+   * Constructor which takes a PID and the contexts that process has active.
+   * Each message replaces the contexts previously sent by the same process.
+   */
+  GestureContextMessage(pid_t pid = 0,
+                        vector<string> active_contexts = vector<string>())
+      : pid_(pid),
+        active_contexts_(active_contexts) {
+  }
+  ;
 
+  /**
+   * Returns the PID of the process that sent the message.
+   */
+  pid_t pid() const {
+    return pid_;
+  }
+  /**
+   * Returns the contexts the process has active.
+   */
+  const vector<string>& active_contexts() const {
+    return active_contexts_;
+  }
+
+ private:
+  friend class boost::serialization::access;
+
+  template<class Archive>
+  void serialize(Archive & ar, const unsigned int version) {
+    ar & pid_;
+    ar & active_contexts_;
+  }
+
+  pid_t pid_;
+  vector<string> active_contexts_;
+};
+
+/**
+ * Keeps track of the gesture contexts activated by each subscribed process.
+ */
+class ActiveGestureContexts {
+ public:
+  /**
+   * Takes a PID and replaces the contexts that process has active.
+   */
+  void SetProcessContexts(pid_t pid, const vector<string>& active_contexts);
+
+  /**
+   * Returns the contexts that are active in at least one process, and stores
+   * the current update count in generation.
+   */
+  vector<string> GetActiveContexts(unsigned int& generation);
+
+  /**
+   * Returns a number that changes every time the active contexts change.
+   */
+  unsigned int generation() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return generation_;
+  }
+
+ private:
+  /// Protects the contexts, which are updated from the monitoring thread
+  std::mutex mutex_;
+  /// Contexts activated by each process
+  map<pid_t, vector<string> > process_contexts_;
+  /// Number of updates received so far
+  unsigned int generation_ = 0;
 };
 
 /**
@@ -130,9 +259,34 @@ void CreateGestureSubscriptionQueue();
 
 /**
  * Constantly monitors the message queue and adds new subscriptions to a
- * vector.
+ * vector, holding a mutex while the vector is modified so that threads that
+ * read it under the same mutex never see it half updated. The generation is
+ * incremented under the mutex with every subscription, so readers can tell
+ * whether the vector changed without taking the mutex.
+ */
+void AddSubscribedGestures(
+    vector<SubscribedGesture>* subscribed_gestures,
+    std::mutex* subscribed_gestures_mutex,
+    std::atomic<unsigned int>* subscribed_gestures_generation);
+
+/**
+ * Takes a subscription and adds it to the gesture with the same LaGeR string,
+ * or appends a new gesture if there is none yet, so that each distinct
+ * gesture is only scored once no matter how many processes subscribe to it.
+ *
+ * Returns whether a new gesture was appended.
+ */
+bool AddGestureSubscriber(vector<SubscribedGesture>* subscribed_gestures,
+                          string gesture_name, string gesture_lager,
+                          pid_t pid, string gesture_context = "");
+
+/**
+ * Takes a gesture context and the active contexts, and returns whether
+ * gestures subscribed under that context can currently be recognized.
+ * Gestures subscribed without a context are always active.
  */
-void AddSubscribedGestures(vector<SubscribedGesture>* subscribed_gestures);
+bool IsGestureContextActive(const string& gesture_context,
+                            const vector<string>& active_contexts);
 
 /**
  * Blocking function that gets and returns a subscription message from the
@@ -144,14 +298,41 @@ GestureSubscriptionMessage GetGestureSubscriptionMessage();
 
 /**
  * Sends a gesture subscription message to the standard registration queue.
+ * The gesture is only recognized while the given context is active, unless
+ * the context is empty.
  */
-void SendGestureSubscriptionMessage(string gesture_name, string gesture_lager);
+void SendGestureSubscriptionMessage(string gesture_name, string gesture_lager,
+                                    string gesture_context = "");
 
 /**
  * Iterates through the gestures in a file and suscribes the calling process
- * to their detection events.
+ * to their detection events, under the given context if any.
+ */
+void SubscribeToGesturesInFile(string file_name, string gesture_context = "");
+
+/**
+ * Creates a message queue for publishing active gesture contexts.
  */
-void SubscribeToGesturesInFile(string file_name);
+void CreateGestureContextQueue();
+
+/**
+ * Constantly monitors the gesture context queue and updates the active
+ * contexts of each process.
+ */
+void MonitorActiveGestureContexts(ActiveGestureContexts* active_contexts);
+
+/**
+ * Blocking function that gets and returns a gesture context message from the
+ * queue.
+ */
+GestureContextMessage GetGestureContextMessage();
+
+/**
+ * Publishes the gesture contexts the calling process has active, replacing
+ * the ones it published before. Gestures subscribed under other contexts
+ * are not recognized for this process.
+ */
+void SendActiveGestureContextsMessage(const vector<string>& active_contexts);
 
 /**
  * Blocking function that returns the latest detected gesture message in the
@@ -164,4 +345,50 @@ DetectedGestureMessage GetDetectedGestureMessage();
  */
 void SendDetectedGestureMessage(string gesture_name, pid_t destination_pid);
 
+/**
+ * Sends a detected gesture message to every process subscribed to a gesture
+ * under an active context, using the name each of them gave it.
+ */
+void SendDetectedGestureMessages(const SubscribedGesture& detected_gesture,
+                                 const vector<string>& active_contexts);
+
+/*
+ * Recognition service
+ *
+ * The recognizer can answer requests on a UNIX domain stream socket, so that
+ * processes can score their own LaGeR strings. Each request and response is
+ * a line of space-separated fields:
+ *
+ *   request:  <id> <context> <max results> <lager> [<lager> ...]
+ *   response: <id> <lager index> <num results> [<name> <distance %> ...]
+ *   error:    <id> ERROR <reason>
+ *
+ * There is one response line per LaGeR string in the request, with results
+ * sorted from closest to farthest. Only gestures subscribed under the given
+ * context or without one are scored, or every gesture if the context is
+ * RECOGNITION_ALL_CONTEXTS. A context of "-" only scores gestures without
+ * one. Responses to different requests on the same connection may come back
+ * in any order. A client may shut down its side of the connection after its
+ * last request; the service answers every request it read, then closes.
+ */
+
+/**
+ * Connects to the recognition service and returns the socket descriptor, or
+ * -1 if the service is not available.
+ */
+int ConnectToRecognitionService(
+    const string& socket_path = RECOGNITION_SOCKET_PATH);
+
+/**
+ * Sends a batch of LaGeR strings over a connection to the recognition service
+ * and waits for the max_results closest gestures to each of them, which are
+ * stored in scores in the same order as the strings. A connection should
+ * only be used by one thread at a time.
+ *
+ * Returns false if the connection failed or the service returned an error.
+ */
+bool RequestGestureScores(int connection, const vector<string>& lagers,
+                          const string& context, unsigned int max_results,
+                          vector<vector<GestureScore> >& scores);
+
 #endif /* LAGER_LIBLAGER_CONNECT_LIBLAGER_CONNECT_H */
@@ -0,0 +1,118 @@
+/*
+ * lager_batch_convert.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "lager_batch_convert.h"
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::system_clock;
+using std::chrono::time_point;
+
+/*
+ * Takes the movements of the current gesture, its start and end times, and
+ * the gestures converted so far, then appends the gesture if it has more than
+ * one movement and clears it.
+ */
+static void FinishGesture(LagerMovementBuffer& movements,
+                          time_point<system_clock> start_time,
+                          time_point<system_clock> end_time,
+                          vector<LagerGesture>& gestures) {
+  if (movements.size() > 1) {
+    LagerGesture gesture;
+    movements.GetString(gesture.lager);
+    gesture.start_time = start_time;
+    gesture.end_time = end_time;
+    gesture.truncated = movements.IsTruncated();
+    gestures.push_back(std::move(gesture));
+  }
+
+  movements.Clear();
+}
+
+bool IsValidLagerRecording(const vector<LagerSensorRecording>& recordings) {
+  for (size_t sensor = 0; sensor < recordings.size(); sensor++) {
+    for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+      if (recordings[sensor].positions[axis].size()
+          != recordings[sensor].size()) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void MergeLagerSensorMovements(
+    const vector<LagerSensorRecording>& recordings,
+    const vector<LagerSensorMovements>& sensor_movements,
+    const LagerConversionSettings& settings, vector<LagerGesture>& gestures) {
+  size_t num_sensors = recordings.size();
+  if (num_sensors == 0) {
+    return;
+  }
+
+  // Replay the movements of every sensor in the order of their sensor times
+  LagerSensorState sensors;
+  LagerMovementBuffer movements(num_sensors, settings.max_gesture_movements);
+  time_point<system_clock> gesture_start_time;
+  time_point<system_clock> last_movement_time;
+  vector<size_t> next_movement(num_sensors, 0);
+
+  // No sensor has moved yet, so none can be grouped with the first movement
+  sensors.Reset(num_sensors, time_point<system_clock>::min());
+
+  while (true) {
+    size_t sensor_index = num_sensors;
+    int64_t timestamp_us = 0;
+    for (size_t sensor = 0; sensor < num_sensors; sensor++) {
+      const LagerSensorMovements& candidate = sensor_movements[sensor];
+      if (next_movement[sensor] == candidate.report_index.size()) {
+        continue;
+      }
+
+      int64_t candidate_timestamp_us = recordings[sensor].timestamps_us[
+          candidate.report_index[next_movement[sensor]]];
+      if (sensor_index == num_sensors || candidate_timestamp_us < timestamp_us) {
+        sensor_index = sensor;
+        timestamp_us = candidate_timestamp_us;
+      }
+    }
+
+    if (sensor_index == num_sensors) {
+      break;
+    }
+
+    time_point<system_clock> movement_time { microseconds(timestamp_us) };
+    if (!movements.empty()
+        && movement_time - last_movement_time
+            > milliseconds(settings.gesture_pause_ms)) {
+      FinishGesture(movements, gesture_start_time, last_movement_time,
+                    gestures);
+    }
+
+    if (movements.empty()) {
+      gesture_start_time = movement_time;
+    }
+
+    AddSensorLetter(
+        sensors, sensor_index,
+        sensor_movements[sensor_index].letter[next_movement[sensor_index]],
+        movement_time, movements);
+    last_movement_time = movement_time;
+    next_movement[sensor_index]++;
+  }
+
+  if (!movements.empty()) {
+    FinishGesture(movements, gesture_start_time, last_movement_time, gestures);
+  }
+}
+
+bool ConvertLagerRecording(const vector<LagerSensorRecording>& recordings,
+                           const LagerConversionSettings& settings,
+                           vector<LagerGesture>& gestures) {
+  LagerDefaultPipeline pipeline;
+  return ConvertLagerRecordingWith(recordings, settings, pipeline, gestures);
+}
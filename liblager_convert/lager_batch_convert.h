@@ -0,0 +1,161 @@
+/*
+ * lager_batch_convert.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_BATCH_CONVERT_H_
+#define LAGER_BATCH_CONVERT_H_
+
+#include <stdint.h>
+#include <vector>
+using std::vector;
+
+#include "lager_gesture_queue.h"
+#include "lager_movement_buffer.h"
+#include "lager_pipeline.h"
+#include "lager_sensor_state.h"
+
+/**
+ * Settings of an offline conversion, matching those of a live LagerConverter.
+ */
+struct LagerConversionSettings {
+  /// Whether sensor positions are already movement deltas
+  bool relative_tracking = false;
+  /// Squared distance a sensor has to move for it to count as a movement
+  double minimum_movement_distance = 0;
+  /// A gesture ends once no sensor has moved for this many milliseconds
+  int gesture_pause_ms = GESTURE_PAUSE_TIME_MILLISECONDS;
+  /// Maximum number of movements kept for a gesture; later ones are dropped
+  /// and the gesture is marked as truncated
+  size_t max_gesture_movements = LAGER_MOVEMENT_BUFFER_CAPACITY;
+  /// Jitter filtering applied before quantization, disabled by default
+  LagerFilterSettings filter;
+};
+
+/**
+ * Recorded position reports of one sensor, in structure-of-arrays form: the
+ * sensor time of every report in microseconds, in increasing order, and one
+ * array of positions per axis, in the axis order of OSVR position reports.
+ */
+struct LagerSensorRecording {
+  vector<int64_t> timestamps_us;
+  vector<double> positions[LAGER_SENSOR_AXES];
+
+  /**
+   * Returns the number of recorded reports.
+   */
+  size_t size() const {
+    return timestamps_us.size();
+  }
+};
+
+/**
+ * Movements found in the recording of one sensor, with the report each came
+ * from, its change in LaGeR X, Y and Z coordinates, and its LaGeR letter.
+ */
+struct LagerSensorMovements {
+  vector<size_t> report_index;
+  vector<double> delta_x;
+  vector<double> delta_y;
+  vector<double> delta_z;
+  vector<char> letter;
+};
+
+/**
+ * Takes the recordings of a number of sensors and returns whether the array
+ * sizes of every recording match.
+ */
+bool IsValidLagerRecording(const vector<LagerSensorRecording>& recordings);
+
+/**
+ * Takes the recordings of a number of sensors, the movements found in each,
+ * and conversion settings, then replays the movements of every sensor in
+ * the order of their sensor times and appends the resulting gestures.
+ */
+void MergeLagerSensorMovements(
+    const vector<LagerSensorRecording>& recordings,
+    const vector<LagerSensorMovements>& sensor_movements,
+    const LagerConversionSettings& settings, vector<LagerGesture>& gestures);
+
+/**
+ * Takes the recording of a sensor, its index and a pipeline reset for the
+ * recorded sensors, and fills movements with the reports the pipeline counts
+ * as movements, along with their deltas and letters.
+ *
+ * Whether a report counts depends on the last one that did, so finding the
+ * movements is sequential; quantization runs afterwards over whole arrays.
+ */
+template <class Pipeline>
+void FindLagerSensorMovements(const LagerSensorRecording& recording,
+                              size_t sensor_index, Pipeline& pipeline,
+                              LagerSensorMovements& movements) {
+  double position[LAGER_SENSOR_AXES];
+  double delta_x, delta_y, delta_z;
+
+  for (size_t i = 0; i < recording.size(); i++) {
+    for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+      position[axis] = recording.positions[axis][i];
+    }
+
+    if (pipeline.FindMovement(sensor_index, recording.timestamps_us[i] / 1e6,
+                              position, delta_x, delta_y, delta_z)) {
+      movements.report_index.push_back(i);
+      movements.delta_x.push_back(delta_x);
+      movements.delta_y.push_back(delta_y);
+      movements.delta_z.push_back(delta_z);
+    }
+  }
+
+  movements.letter.resize(movements.report_index.size());
+  pipeline.QuantizeMovements(sensor_index, movements.delta_x.data(),
+                             movements.delta_y.data(),
+                             movements.delta_z.data(),
+                             movements.report_index.size(),
+                             movements.letter.data());
+}
+
+/**
+ * Takes the recordings of a number of sensors, in the order their letters
+ * appear in LaGeR movements, conversion settings and a pipeline, then
+ * appends to gestures every gesture a live LagerConverter with the same
+ * pipeline would have handed over for the same reports. The sensor times of
+ * the reports become the gesture start and end times.
+ *
+ * Unlike a live conversion, gesture pauses are measured between sensor
+ * times, so the output does not depend on how fast the recordings are
+ * processed. Returns false without converting anything if the array sizes of
+ * a recording do not match.
+ */
+template <class Pipeline>
+bool ConvertLagerRecordingWith(const vector<LagerSensorRecording>& recordings,
+                               const LagerConversionSettings& settings,
+                               Pipeline& pipeline,
+                               vector<LagerGesture>& gestures) {
+  if (!IsValidLagerRecording(recordings)) {
+    return false;
+  }
+
+  pipeline.Configure(settings.relative_tracking,
+                     settings.minimum_movement_distance, settings.filter);
+  pipeline.Reset(recordings.size());
+
+  vector<LagerSensorMovements> sensor_movements(recordings.size());
+  for (size_t sensor = 0; sensor < recordings.size(); sensor++) {
+    FindLagerSensorMovements(recordings[sensor], sensor, pipeline,
+                             sensor_movements[sensor]);
+  }
+
+  MergeLagerSensorMovements(recordings, sensor_movements, settings, gestures);
+  return true;
+}
+
+/**
+ * Converts recordings like ConvertLagerRecordingWith(), through the pipeline
+ * used by LagerConverter.
+ */
+bool ConvertLagerRecording(const vector<LagerSensorRecording>& recordings,
+                           const LagerConversionSettings& settings,
+                           vector<LagerGesture>& gestures);
+
+#endif /* LAGER_BATCH_CONVERT_H_ */
@@ -0,0 +1,228 @@
+/*
+ * lager_gesture_queue.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_GESTURE_QUEUE_H_
+#define LAGER_GESTURE_QUEUE_H_
+
+#include <errno.h>
+#include <semaphore.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+using std::string;
+#include <thread>
+
+/// Default number of completed gestures that can wait for a consumer
+#define LAGER_GESTURE_QUEUE_CAPACITY 16
+
+/**
+ * What LagerGestureQueue::Push() does when the queue is full.
+ *
+ * drop_oldest discards the oldest waiting gesture to make room, drop_newest
+ * discards the gesture being pushed, and block waits for a consumer to make
+ * room.
+ */
+enum class LagerQueueOverflow { drop_oldest, drop_newest, block };
+
+/**
+ * A completed gesture, with the sensor times of its first and last
+ * movements.
+ */
+struct LagerGesture {
+  string lager;
+  std::chrono::time_point<std::chrono::system_clock> start_time;
+  std::chrono::time_point<std::chrono::system_clock> end_time;
+  /// Whether movements past the capacity of the movement buffer were dropped
+  bool truncated = false;
+};
+
+/**
+ * Bounded lock-free queue of completed gestures, safe for any number of
+ * producers and consumers.
+ *
+ * Each slot carries a sequence number that tells producers and consumers
+ * whether it is free or holds a gesture, so pushing and popping only take a
+ * compare-and-swap on the queue position. Consumers that want to wait for a
+ * gesture sleep on a semaphore that every push posts.
+ */
+class LagerGestureQueue {
+ public:
+  /**
+   * Takes the number of gestures the queue can hold, rounded up to a power
+   * of two, and what to do when it is full.
+   */
+  explicit LagerGestureQueue(
+      size_t capacity = LAGER_GESTURE_QUEUE_CAPACITY,
+      LagerQueueOverflow overflow = LagerQueueOverflow::drop_oldest)
+      : overflow_(overflow) {
+    size_t rounded_capacity = 2;
+    while (rounded_capacity < capacity) {
+      rounded_capacity *= 2;
+    }
+
+    mask_ = rounded_capacity - 1;
+    slots_.reset(new Slot[rounded_capacity]);
+    for (size_t i = 0; i < rounded_capacity; i++) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    sem_init(&gestures_available_, 0, 0);
+  }
+
+  ~LagerGestureQueue() {
+    sem_destroy(&gestures_available_);
+  }
+
+  LagerGestureQueue(const LagerGestureQueue&) = delete;
+  LagerGestureQueue& operator=(const LagerGestureQueue&) = delete;
+
+  /**
+   * Sets what Push() does when the queue is full.
+   */
+  void SetOverflow(LagerQueueOverflow overflow) {
+    overflow_.store(overflow, std::memory_order_relaxed);
+  }
+
+  /**
+   * Takes a completed gesture and moves it into the queue, applying the
+   * overflow policy if the queue is full. Returns false if the gesture was
+   * dropped.
+   */
+  bool Push(LagerGesture& gesture) {
+    while (!TryPush(gesture)) {
+      switch (overflow_.load(std::memory_order_relaxed)) {
+        case LagerQueueOverflow::drop_newest:
+          num_dropped_.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        case LagerQueueOverflow::drop_oldest: {
+          LagerGesture oldest_gesture;
+          if (TryPop(oldest_gesture)) {
+            num_dropped_.fetch_add(1, std::memory_order_relaxed);
+          }
+          break;
+        }
+        case LagerQueueOverflow::block:
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          break;
+      }
+    }
+
+    sem_post(&gestures_available_);
+    return true;
+  }
+
+  /**
+   * Takes a gesture and moves the oldest gesture in the queue into it.
+   * Returns false without waiting if the queue is empty.
+   */
+  bool TryPop(LagerGesture& gesture) {
+    size_t position = pop_position_.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    while (true) {
+      slot = &slots_[position & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t difference = static_cast<intptr_t>(sequence)
+          - static_cast<intptr_t>(position + 1);
+
+      if (difference == 0) {
+        if (pop_position_.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = pop_position_.load(std::memory_order_relaxed);
+      }
+    }
+
+    gesture = std::move(slot->gesture);
+    slot->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Takes a gesture and moves the oldest gesture in the queue into it,
+   * waiting for one to be pushed if the queue is empty.
+   */
+  void Pop(LagerGesture& gesture) {
+    // The semaphore may count gestures that were dropped, so it is only a
+    // hint to try again
+    while (!TryPop(gesture)) {
+      while (sem_wait(&gestures_available_) != 0 && errno == EINTR) {
+      }
+    }
+  }
+
+  /**
+   * Returns the number of gestures dropped because the queue was full.
+   */
+  uint64_t GetNumDropped() const {
+    return num_dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  /**
+   * A gesture and the sequence number that tells whether it is free to push
+   * into (sequence == position) or ready to pop (sequence == position + 1).
+   */
+  struct Slot {
+    std::atomic<size_t> sequence;
+    LagerGesture gesture;
+  };
+
+  /**
+   * Takes a gesture and moves it into the queue. Returns false if the queue
+   * is full.
+   */
+  bool TryPush(LagerGesture& gesture) {
+    size_t position = push_position_.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    while (true) {
+      slot = &slots_[position & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t difference = static_cast<intptr_t>(sequence)
+          - static_cast<intptr_t>(position);
+
+      if (difference == 0) {
+        if (push_position_.compare_exchange_weak(position, position + 1,
+                                                 std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = push_position_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->gesture = std::move(gesture);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Slots of the ring, a power of two of them
+  std::unique_ptr<Slot[]> slots_;
+  /// Number of slots minus one
+  size_t mask_;
+  /// Overflow policy
+  std::atomic<LagerQueueOverflow> overflow_;
+  /// Position of the next push
+  std::atomic<size_t> push_position_{0};
+  /// Position of the next pop
+  std::atomic<size_t> pop_position_{0};
+  /// Number of gestures dropped on overflow
+  std::atomic<uint64_t> num_dropped_{0};
+  /// Posted once for every gesture pushed
+  sem_t gestures_available_;
+};
+
+#endif /* LAGER_GESTURE_QUEUE_H_ */
@@ -0,0 +1,151 @@
+/*
+ * lager_jitter_filter.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <math.h>
+
+#include "lager_jitter_filter.h"
+#include "lager_quantizer.h"
+
+/// Half the width of the cone of directions that snap to the same angle
+#define LAGER_LETTER_HALF_CONE_DEGREES 22.5
+
+/*
+ * Takes a cutoff frequency and the time between two samples, and returns the
+ * smoothing factor of a first order low-pass filter.
+ */
+static inline double GetSmoothingFactor(double cutoff_hz,
+                                        double elapsed_seconds) {
+  double time_constant = 1.0 / (2.0 * M_PI * cutoff_hz);
+  return 1.0 / (1.0 + time_constant / elapsed_seconds);
+}
+
+/*
+ * Takes two angles in degrees and returns how far apart they are around the
+ * circle.
+ */
+static inline double GetCircularDistance(double angle, double other_angle) {
+  double distance = fmod(fabs(angle - other_angle), 360.0);
+  return (distance > 180.0) ? 360.0 - distance : distance;
+}
+
+void LagerOneEuroFilter::Reset(size_t num_sensors) {
+  for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+    position_[axis].assign(num_sensors, 0);
+    speed_[axis].assign(num_sensors, 0);
+  }
+  last_time_seconds_.assign(num_sensors, 0);
+  has_position_.assign(num_sensors, false);
+}
+
+void LagerOneEuroFilter::FilterPosition(size_t sensor_index,
+                                        double time_seconds,
+                                        double position[LAGER_SENSOR_AXES]) {
+  if (!settings_.smooth_positions) {
+    return;
+  }
+
+  double elapsed_seconds = time_seconds - last_time_seconds_[sensor_index];
+  if (!has_position_[sensor_index] || elapsed_seconds <= 0) {
+    // Nothing to smooth against, or a report from the same instant
+    for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+      if (has_position_[sensor_index]) {
+        position[axis] = position_[axis][sensor_index];
+      } else {
+        position_[axis][sensor_index] = position[axis];
+      }
+    }
+    last_time_seconds_[sensor_index] = time_seconds;
+    has_position_[sensor_index] = true;
+    return;
+  }
+
+  double speed_factor = GetSmoothingFactor(settings_.derivative_cutoff_hz,
+                                           elapsed_seconds);
+  for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+    double last_position = position_[axis][sensor_index];
+    double speed = (position[axis] - last_position) / elapsed_seconds;
+    speed = speed_[axis][sensor_index]
+        + speed_factor * (speed - speed_[axis][sensor_index]);
+
+    double cutoff_hz = settings_.min_cutoff_hz + settings_.beta * fabs(speed);
+    double position_factor = GetSmoothingFactor(cutoff_hz, elapsed_seconds);
+    position[axis] = last_position
+        + position_factor * (position[axis] - last_position);
+
+    speed_[axis][sensor_index] = speed;
+    position_[axis][sensor_index] = position[axis];
+  }
+  last_time_seconds_[sensor_index] = time_seconds;
+}
+
+void LagerAngleHysteresis::Reset(size_t num_sensors) {
+  last_snap_theta_.assign(num_sensors, -1);
+  last_snap_phi_.assign(num_sensors, 0);
+}
+
+void LagerAngleHysteresis::SnapMovementAngles(size_t sensor_index,
+                                              double delta_x, double delta_y,
+                                              double delta_z, int& snap_theta,
+                                              int& snap_phi) {
+  double theta = GetMovementThetaInDegrees(delta_x, delta_y, delta_z);
+  double keep_distance = LAGER_LETTER_HALF_CONE_DEGREES
+      + hysteresis_degrees_;
+  int last_snap_theta = last_snap_theta_[sensor_index];
+  int last_snap_phi = last_snap_phi_[sensor_index];
+
+  if (hysteresis_degrees_ <= 0 || last_snap_theta < 0) {
+    snap_theta = SnapAngle(theta);
+    snap_phi = SnapAngle(GetMovementPhiInDegrees(delta_x, delta_y, theta));
+  } else {
+    snap_theta = (fabs(theta - last_snap_theta) < keep_distance) ?
+        last_snap_theta : SnapAngle(theta);
+
+    if (snap_theta == 0 || snap_theta == 180) {
+      snap_phi = 0;  // Phi is meaningless at the poles
+    } else {
+      double phi = GetMovementAzimuthInDegrees(delta_x, delta_y);
+      bool last_at_pole = (last_snap_theta == 0 || last_snap_theta == 180);
+      snap_phi = (!last_at_pole
+          && GetCircularDistance(phi, last_snap_phi) < keep_distance) ?
+          last_snap_phi : SnapAngle(phi);
+    }
+  }
+
+  last_snap_theta_[sensor_index] = snap_theta;
+  last_snap_phi_[sensor_index] = snap_phi;
+}
+
+char LagerAngleHysteresis::QuantizeMovement(size_t sensor_index,
+                                            double delta_x, double delta_y,
+                                            double delta_z) {
+  if (hysteresis_degrees_ <= 0) {
+    return QuantizeLagerMovement(delta_x, delta_y, delta_z);
+  }
+
+  int snap_theta, snap_phi;
+  SnapMovementAngles(sensor_index, delta_x, delta_y, delta_z, snap_theta,
+                     snap_phi);
+  return GetLagerLetter(snap_theta, snap_phi);
+}
+
+void LagerAngleHysteresis::QuantizeMovements(size_t sensor_index,
+                                             const double* delta_x,
+                                             const double* delta_y,
+                                             const double* delta_z,
+                                             size_t num_movements,
+                                             char* letters) {
+  if (hysteresis_degrees_ <= 0) {
+    // Letters are independent, so they can be computed over whole arrays
+    QuantizeLagerMovements(delta_x, delta_y, delta_z, num_movements, letters);
+    return;
+  }
+
+  // Each letter depends on the previous one of the sensor
+  for (size_t i = 0; i < num_movements; i++) {
+    letters[i] = QuantizeMovement(sensor_index, delta_x[i], delta_y[i],
+                                  delta_z[i]);
+  }
+}
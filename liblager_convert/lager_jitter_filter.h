@@ -0,0 +1,140 @@
+/*
+ * lager_jitter_filter.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_JITTER_FILTER_H_
+#define LAGER_JITTER_FILTER_H_
+
+#include <stddef.h>
+#include <vector>
+using std::vector;
+
+#include "lager_sensor_state.h"
+
+/// Default cutoff frequency of position smoothing for still sensors, in Hz
+#define LAGER_FILTER_MIN_CUTOFF_HZ 1.0
+/// Default increase of the smoothing cutoff per unit of sensor speed
+#define LAGER_FILTER_BETA 20.0
+/// Default cutoff frequency used to smooth the sensor speed, in Hz
+#define LAGER_FILTER_DERIVATIVE_CUTOFF_HZ 1.0
+
+/**
+ * Settings of the filter stages that run before movements are quantized into
+ * LaGeR letters.
+ */
+struct LagerFilterSettings {
+  /// Whether sensor positions go through a One-Euro filter
+  bool smooth_positions = false;
+  /// Cutoff frequency of the position filter when sensors are still, in Hz
+  double min_cutoff_hz = LAGER_FILTER_MIN_CUTOFF_HZ;
+  /// How much the cutoff frequency rises with sensor speed
+  double beta = LAGER_FILTER_BETA;
+  /// Cutoff frequency of the sensor speed estimate, in Hz
+  double derivative_cutoff_hz = LAGER_FILTER_DERIVATIVE_CUTOFF_HZ;
+  /// How far past the edge of its cone a movement must point before its
+  /// letter changes, in degrees, or 0 to snap every movement independently.
+  /// Around 10 degrees removes most letter flicker on noisy sensors.
+  double angle_hysteresis_degrees = 0;
+};
+
+/**
+ * Position filter stage that smooths sensor positions with a One-Euro filter:
+ * a low-pass filter whose cutoff frequency rises with sensor speed, so slow
+ * jitter is smoothed out while fast movements keep little lag.
+ *
+ * State is kept per sensor in structure-of-arrays form, like
+ * LagerSensorState.
+ */
+class LagerOneEuroFilter {
+ public:
+  /**
+   * Takes the filter settings. Positions are left untouched unless
+   * smooth_positions is set. Takes effect on the next Reset().
+   */
+  void Configure(const LagerFilterSettings& settings) {
+    settings_ = settings;
+  }
+
+  /**
+   * Takes a number of sensors and forgets the filter state of every sensor.
+   */
+  void Reset(size_t num_sensors);
+
+  /**
+   * Takes the index of a sensor, the sensor time of a report in seconds and
+   * the reported position, then replaces the position with its filtered
+   * value.
+   */
+  void FilterPosition(size_t sensor_index, double time_seconds,
+                      double position[LAGER_SENSOR_AXES]);
+
+ private:
+  /// Filter settings
+  LagerFilterSettings settings_;
+  /// Filtered position of each sensor, one array per sensor axis
+  vector<double> position_[LAGER_SENSOR_AXES];
+  /// Filtered speed of each sensor, one array per sensor axis
+  vector<double> speed_[LAGER_SENSOR_AXES];
+  /// Sensor time of the last report of each sensor, in seconds
+  vector<double> last_time_seconds_;
+  /// Whether each sensor has reported a position since the last reset
+  vector<char> has_position_;
+};
+
+/**
+ * Quantizer stage that snaps movement angles with hysteresis, keeping the
+ * previous direction of a sensor until a movement clearly leaves its 45
+ * degree cone. Without hysteresis, every movement is snapped independently.
+ */
+class LagerAngleHysteresis {
+ public:
+  /**
+   * Takes the filter settings, of which the angle hysteresis is used. Takes
+   * effect on the next Reset().
+   */
+  void Configure(const LagerFilterSettings& settings) {
+    hysteresis_degrees_ = settings.angle_hysteresis_degrees;
+  }
+
+  /**
+   * Takes a number of sensors and forgets the last direction of every sensor.
+   */
+  void Reset(size_t num_sensors);
+
+  /**
+   * Takes the index of a sensor and the change in X, Y, and Z Cartesian
+   * coordinates of its movement, and returns the snapped theta and phi
+   * angles of the movement, keeping those of the previous movement of the
+   * sensor while within the hysteresis margin.
+   */
+  void SnapMovementAngles(size_t sensor_index, double delta_x,
+                          double delta_y, double delta_z, int& snap_theta,
+                          int& snap_phi);
+
+  /**
+   * Takes the index of a sensor and the change in X, Y, and Z Cartesian
+   * coordinates of its movement, and returns its LaGeR letter.
+   */
+  char QuantizeMovement(size_t sensor_index, double delta_x, double delta_y,
+                        double delta_z);
+
+  /**
+   * Takes the index of a sensor and arrays with the X, Y, and Z changes of
+   * its movements, in order, and fills an array with their LaGeR letters.
+   */
+  void QuantizeMovements(size_t sensor_index, const double* delta_x,
+                         const double* delta_y, const double* delta_z,
+                         size_t num_movements, char* letters);
+
+ private:
+  /// Margin past the edge of a letter cone, in degrees
+  double hysteresis_degrees_ = 0;
+  /// Snapped theta of the last movement of each sensor, or -1 if none
+  vector<int> last_snap_theta_;
+  /// Snapped phi of the last movement of each sensor
+  vector<int> last_snap_phi_;
+};
+
+#endif /* LAGER_JITTER_FILTER_H_ */
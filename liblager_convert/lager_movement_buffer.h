@@ -0,0 +1,147 @@
+/*
+ * lager_movement_buffer.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_MOVEMENT_BUFFER_H_
+#define LAGER_MOVEMENT_BUFFER_H_
+
+#include <stddef.h>
+#include <string.h>   // for memset
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+/// Default number of movements kept for the gesture being drawn
+#define LAGER_MOVEMENT_BUFFER_CAPACITY 4096
+
+/**
+ * Preallocated buffer of the movements of the gesture being drawn. Each
+ * movement is stored as one letter byte per sensor, without the trailing
+ * '.', so that appending a movement or rewriting the last one never
+ * allocates. Once full, new movements are dropped and the buffer is marked as
+ * truncated, so the start of the gesture is always kept.
+ */
+class LagerMovementBuffer {
+ public:
+  /**
+   * Takes the number of sensor letters per movement and the number of
+   * movements to keep.
+   */
+  explicit LagerMovementBuffer(
+      size_t letters_per_movement,
+      size_t capacity = LAGER_MOVEMENT_BUFFER_CAPACITY)
+      : letters_per_movement_(letters_per_movement),
+        capacity_(capacity),
+        letters_(letters_per_movement * capacity) {
+  }
+
+  /**
+   * Returns the number of movements in the buffer.
+   */
+  size_t size() const {
+    return size_;
+  }
+
+  /**
+   * Returns whether the buffer holds no movements.
+   */
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  /**
+   * Returns whether movements were dropped because the buffer was full.
+   */
+  bool IsTruncated() const {
+    return truncated_;
+  }
+
+  /**
+   * Returns the number of sensor letters in each movement.
+   */
+  size_t GetLettersPerMovement() const {
+    return letters_per_movement_;
+  }
+
+  /**
+   * Returns the length of the LaGeR string for the movements in the buffer.
+   */
+  size_t GetStringLength() const {
+    return size_ * (letters_per_movement_ + 1);
+  }
+
+  /**
+   * Returns the length of the LaGeR string for a full buffer, which is
+   * enough to reserve strings that GetString() never reallocates.
+   */
+  size_t GetMaxStringLength() const {
+    return capacity_ * (letters_per_movement_ + 1);
+  }
+
+  /**
+   * Adds a movement with every letter set to '_' and returns its letters.
+   * Returns NULL and marks the buffer as truncated if the buffer is full.
+   */
+  char* AppendMovement() {
+    if (size_ == capacity_) {
+      truncated_ = true;
+      return NULL;
+    }
+
+    char* letters = &letters_[size_ * letters_per_movement_];
+    memset(letters, '_', letters_per_movement_);
+    size_++;
+    return letters;
+  }
+
+  /**
+   * Returns the letters of the most recent movement so that they can be
+   * rewritten, or NULL if the buffer is empty.
+   */
+  char* GetLastMovement() {
+    if (size_ == 0) {
+      return NULL;
+    }
+
+    return &letters_[(size_ - 1) * letters_per_movement_];
+  }
+
+  /**
+   * Removes every movement and the truncated mark.
+   */
+  void Clear() {
+    size_ = 0;
+    truncated_ = false;
+  }
+
+  /**
+   * Takes a string and replaces its contents with the LaGeR string for the
+   * movements in the buffer. The string is only reallocated if its capacity
+   * is smaller than GetStringLength().
+   */
+  void GetString(string& lager_string) const {
+    lager_string.clear();
+    for (size_t i = 0; i < size_; i++) {
+      lager_string.append(&letters_[i * letters_per_movement_],
+                          letters_per_movement_);
+      lager_string.push_back('.');
+    }
+  }
+
+ private:
+  /// Sensor letters in each movement
+  size_t letters_per_movement_;
+  /// Maximum number of movements kept
+  size_t capacity_;
+  /// Letters of every movement, letters_per_movement_ bytes per movement
+  vector<char> letters_;
+  /// Number of movements in the buffer
+  size_t size_ = 0;
+  /// Whether movements were dropped because the buffer was full
+  bool truncated_ = false;
+};
+
+#endif /* LAGER_MOVEMENT_BUFFER_H_ */
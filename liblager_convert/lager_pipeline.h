@@ -0,0 +1,284 @@
+/*
+ * lager_pipeline.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_PIPELINE_H_
+#define LAGER_PIPELINE_H_
+
+#include <stddef.h>
+#include <vector>
+using std::vector;
+
+#include "lager_jitter_filter.h"
+#include "lager_quantizer.h"
+#include "lager_sensor_state.h"
+
+/**
+ * Axis mapping stage that takes positions in the axis order of OSVR position
+ * reports, where LaGeR X, Y and Z are the OSVR Z, X and Y axes.
+ */
+struct LagerOsvrAxisMapping {
+  static void MapPosition(const double position[LAGER_SENSOR_AXES],
+                          double& x, double& y, double& z) {
+    x = position[2];
+    y = position[0];
+    z = position[1];
+  }
+};
+
+/**
+ * Axis mapping stage that takes positions already in LaGeR X, Y, Z order.
+ */
+struct LagerIdentityAxisMapping {
+  static void MapPosition(const double position[LAGER_SENSOR_AXES],
+                          double& x, double& y, double& z) {
+    x = position[0];
+    y = position[1];
+    z = position[2];
+  }
+};
+
+/**
+ * Position filter stage that leaves positions untouched.
+ */
+struct LagerNoPositionFilter {
+  void Configure(const LagerFilterSettings&) {
+  }
+
+  void Reset(size_t) {
+  }
+
+  void FilterPosition(size_t, double, double[LAGER_SENSOR_AXES]) {
+  }
+};
+
+/**
+ * Quantizer stage that snaps every movement to the closest LaGeR letter,
+ * independently of the previous ones.
+ */
+struct LagerSphericalQuantizer {
+  void Configure(const LagerFilterSettings&) {
+  }
+
+  void Reset(size_t) {
+  }
+
+  char QuantizeMovement(size_t, double delta_x, double delta_y,
+                        double delta_z) {
+    return QuantizeLagerMovement(delta_x, delta_y, delta_z);
+  }
+
+  void QuantizeMovements(size_t, const double* delta_x, const double* delta_y,
+                         const double* delta_z, size_t num_movements,
+                         char* letters) {
+    QuantizeLagerMovements(delta_x, delta_y, delta_z, num_movements, letters);
+  }
+};
+
+/**
+ * Per-report conversion of sensor positions into LaGeR letters, composed at
+ * compile time from three stages:
+ *
+ * - AxisMapping maps a reported position to LaGeR X, Y and Z, with a static
+ *   MapPosition(position, x, y, z).
+ * - PositionFilter filters reported positions before anything else sees
+ *   them, with Configure(settings), Reset(num_sensors) and
+ *   FilterPosition(sensor_index, time_seconds, position).
+ * - Quantizer turns movement deltas into letters, with Configure(settings),
+ *   Reset(num_sensors), QuantizeMovement(sensor_index, dx, dy, dz) and
+ *   QuantizeMovements(sensor_index, dx[], dy[], dz[], n, letters[]).
+ *
+ * Between the filter and the quantizer, a report only counts as a movement
+ * if the sensor moved farther than the minimum movement distance since its
+ * last movement. Stages are called directly, so swapping one costs no
+ * virtual dispatch on the per-report path.
+ */
+template <class AxisMapping, class PositionFilter, class Quantizer>
+class LagerMovementPipeline {
+ public:
+  /**
+   * Takes whether positions are already movement deltas, the squared
+   * distance a sensor has to move for it to count as a movement, and the
+   * filter settings passed to the filter and quantizer stages. Takes effect
+   * on the next Reset().
+   */
+  void Configure(bool relative_tracking, double minimum_movement_distance,
+                 const LagerFilterSettings& filter_settings) {
+    relative_tracking_ = relative_tracking;
+    minimum_movement_distance_ = minimum_movement_distance;
+    filter_.Configure(filter_settings);
+    quantizer_.Configure(filter_settings);
+  }
+
+  /**
+   * Takes a number of sensors and resets their state, as if every sensor
+   * was at the origin.
+   */
+  void Reset(size_t num_sensors) {
+    for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+      last_position_[axis].assign(num_sensors, 0);
+    }
+    filter_.Reset(num_sensors);
+    quantizer_.Reset(num_sensors);
+  }
+
+  /**
+   * Takes the index of a sensor, the sensor time of a report in seconds and
+   * the reported position, and stores the filtered position as the last one
+   * of the sensor without producing a movement.
+   */
+  void TrackPosition(size_t sensor_index, double time_seconds,
+                     const double report_position[LAGER_SENSOR_AXES]) {
+    double position[LAGER_SENSOR_AXES];
+    FilterPosition(sensor_index, time_seconds, report_position, position);
+    StoreLastPosition(sensor_index, position);
+  }
+
+  /**
+   * Takes the index of a sensor, the sensor time of a report in seconds and
+   * the reported position, and returns whether the report is a movement. If
+   * it is, the position becomes the last one of the sensor and the change
+   * in LaGeR X, Y and Z coordinates is returned.
+   */
+  bool FindMovement(size_t sensor_index, double time_seconds,
+                    const double report_position[LAGER_SENSOR_AXES],
+                    double& delta_x, double& delta_y, double& delta_z) {
+    double position[LAGER_SENSOR_AXES];
+    FilterPosition(sensor_index, time_seconds, report_position, position);
+
+    double distance_squared = 0;
+    for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+      double delta = last_position_[axis][sensor_index] - position[axis];
+      distance_squared += delta * delta;
+    }
+    if (distance_squared <= minimum_movement_distance_) {
+      return false;
+    }
+
+    AxisMapping::MapPosition(position, delta_x, delta_y, delta_z);
+    if (!relative_tracking_) {
+      double last_position[LAGER_SENSOR_AXES];
+      double last_x, last_y, last_z;
+      for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+        last_position[axis] = last_position_[axis][sensor_index];
+      }
+      AxisMapping::MapPosition(last_position, last_x, last_y, last_z);
+      delta_x -= last_x;
+      delta_y -= last_y;
+      delta_z -= last_z;
+    }
+
+    StoreLastPosition(sensor_index, position);
+    return true;
+  }
+
+  /**
+   * Takes the index of a sensor and the change in LaGeR X, Y and Z
+   * coordinates of its movement, and returns its LaGeR letter.
+   */
+  char QuantizeMovement(size_t sensor_index, double delta_x, double delta_y,
+                        double delta_z) {
+    return quantizer_.QuantizeMovement(sensor_index, delta_x, delta_y,
+                                       delta_z);
+  }
+
+  /**
+   * Takes the index of a sensor and arrays with the changes of its
+   * movements, in order, and fills an array with their LaGeR letters.
+   */
+  void QuantizeMovements(size_t sensor_index, const double* delta_x,
+                         const double* delta_y, const double* delta_z,
+                         size_t num_movements, char* letters) {
+    quantizer_.QuantizeMovements(sensor_index, delta_x, delta_y, delta_z,
+                                 num_movements, letters);
+  }
+
+  /**
+   * Takes the index of a sensor, the sensor time of a report in seconds and
+   * the reported position, and returns whether the report is a movement,
+   * along with its LaGeR letter if it is.
+   */
+  bool ProcessReport(size_t sensor_index, double time_seconds,
+                     const double report_position[LAGER_SENSOR_AXES],
+                     char& letter) {
+    double delta_x, delta_y, delta_z;
+    if (!FindMovement(sensor_index, time_seconds, report_position, delta_x,
+                      delta_y, delta_z)) {
+      return false;
+    }
+
+    letter = QuantizeMovement(sensor_index, delta_x, delta_y, delta_z);
+    return true;
+  }
+
+  /**
+   * Takes an axis, in the order of reported positions, and the index of a
+   * sensor, and returns the position of the last movement of the sensor.
+   */
+  double GetLastPosition(int axis, size_t sensor_index) const {
+    return last_position_[axis][sensor_index];
+  }
+
+  PositionFilter& GetFilter() {
+    return filter_;
+  }
+
+  Quantizer& GetQuantizer() {
+    return quantizer_;
+  }
+
+ private:
+  /**
+   * Takes the index of a sensor, the sensor time of a report in seconds and
+   * the reported position, and returns the filtered position.
+   */
+  void FilterPosition(size_t sensor_index, double time_seconds,
+                      const double report_position[LAGER_SENSOR_AXES],
+                      double position[LAGER_SENSOR_AXES]) {
+    for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+      position[axis] = report_position[axis];
+    }
+    filter_.FilterPosition(sensor_index, time_seconds, position);
+  }
+
+  /**
+   * Takes the index of a sensor and a position, and stores it as the last
+   * position of the sensor.
+   */
+  void StoreLastPosition(size_t sensor_index,
+                         const double position[LAGER_SENSOR_AXES]) {
+    for (int axis = 0; axis < LAGER_SENSOR_AXES; axis++) {
+      last_position_[axis][sensor_index] = position[axis];
+    }
+  }
+
+  /// Whether positions are already movement deltas
+  bool relative_tracking_ = false;
+  /// Squared distance a sensor has to move for it to count as a movement
+  double minimum_movement_distance_ = 0;
+  /// Position of the last movement of each sensor, one array per axis
+  vector<double> last_position_[LAGER_SENSOR_AXES];
+  /// Position filter stage
+  PositionFilter filter_;
+  /// Quantizer stage
+  Quantizer quantizer_;
+};
+
+/**
+ * Pipeline used by LagerConverter and ConvertLagerRecording(): OSVR axes,
+ * with One-Euro smoothing and angle hysteresis that stay disabled unless
+ * configured.
+ */
+typedef LagerMovementPipeline<LagerOsvrAxisMapping, LagerOneEuroFilter,
+    LagerAngleHysteresis> LagerDefaultPipeline;
+
+/**
+ * Pipeline with OSVR axes and neither filtering nor hysteresis, for
+ * deployments that do not need them.
+ */
+typedef LagerMovementPipeline<LagerOsvrAxisMapping, LagerNoPositionFilter,
+    LagerSphericalQuantizer> LagerUnfilteredPipeline;
+
+#endif /* LAGER_PIPELINE_H_ */
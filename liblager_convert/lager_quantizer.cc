@@ -0,0 +1,147 @@
+/*
+ * lager_quantizer.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <math.h>
+#include <functional>
+#include <unordered_map>
+
+#include "spherical_coordinates.h"
+#include "coordinates_letter.h"
+
+#include "lager_quantizer.h"
+
+/// Square of tan(22.5 degrees), 3 - 2 * sqrt(2): the squared ratio between
+/// the off-axis and on-axis components of a direction on the edge of a cone
+#define LAGER_CONE_TAN_SQUARED 0.17157287525380990
+/// Relative distance to a cone edge under which the rounding of the angle
+/// functions decides the letter, so the letter is taken from the angles
+#define LAGER_CONE_EDGE_MARGIN 1e-12
+
+/*
+ * Letters of the 26 direction cones, by theta cone (0, 45, 90, 135 and 180
+ * degrees), then by whether Y is negative, close to 0 or positive, then by
+ * whether X is negative, close to 0 or positive, with X and Y close to 0
+ * when they are within the cone of the other axis. The layout follows
+ * coordinates_letter.h; X and Y are never both close to 0 outside the poles.
+ */
+static constexpr char cone_letters[5][3][3] = {
+  { { 'a', 'a', 'a' }, { 'a', 'a', 'a' }, { 'a', 'a', 'a' } },
+  { { 'g', 'h', 'i' }, { 'f', 'b', 'b' }, { 'e', 'd', 'c' } },
+  { { 'o', 'p', 'q' }, { 'n', 'j', 'j' }, { 'm', 'l', 'k' } },
+  { { 'w', 'x', 'y' }, { 'v', 'r', 'r' }, { 'u', 't', 's' } },
+  { { 'z', 'z', 'z' }, { 'z', 'z', 'z' }, { 'z', 'z', 'z' } }
+};
+
+/*
+ * Takes a component, and how far its square is past the edge of the cone of
+ * the other planar component, and returns 0 if the component is negative, 1
+ * if it is close to 0 and 2 if it is positive.
+ */
+static inline int GetPlanarClass(double component, double edge_distance) {
+  return (edge_distance < 0) ? 1 : (component > 0) ? 2 : 0;
+}
+
+/*
+ * Takes the change in X, Y, and Z Cartesian coordinates of a movement and
+ * returns its LaGeR letter from its snapped spherical angles.
+ */
+static char QuantizeLagerMovementAngles(double delta_x, double delta_y,
+                                        double delta_z) {
+  double theta = GetMovementThetaInDegrees(delta_x, delta_y, delta_z);
+  double phi = GetMovementPhiInDegrees(delta_x, delta_y, theta);
+  return GetLagerLetter(SnapAngle(theta), SnapAngle(phi));
+}
+
+double GetMovementThetaInDegrees(double delta_x, double delta_y,
+                                 double delta_z) {
+  double movementTheta = acos(
+      delta_z
+          / (sqrt(pow(delta_x, 2.0) + pow(delta_y, 2.0) + pow(delta_z, 2.0))))
+      * (180.0 / M_PI);
+  return fmod(movementTheta + 360.0, 360.0);  // Always returns a positive angle
+}
+
+double GetMovementAzimuthInDegrees(double delta_x, double delta_y) {
+  double movementPhi = atan2(delta_y, delta_x) * (180.0 / M_PI);
+  return fmod(movementPhi + 360.0, 360.0);  // Always returns a positive angle
+}
+
+double GetMovementPhiInDegrees(double delta_x, double delta_y, double theta) {
+  int snap_theta = SnapAngle(theta);
+  if (snap_theta == 0 || snap_theta == 180) {
+    return 0;  // Phi becomes meaningless at the north and south poles, so we default it to 0.
+  }
+
+  return GetMovementAzimuthInDegrees(delta_x, delta_y);
+}
+
+/* Snaps angle to 45 degree intervals */
+int SnapAngle(double angle) {
+  return 45 * (round(angle / 45.0));
+}
+
+char GetLagerLetter(int snap_theta, int snap_phi) {
+  struct SphericalCoordinates current_coordinates;
+  current_coordinates.theta = snap_theta;
+  current_coordinates.phi = snap_phi;
+
+  // find() rather than operator[], which would insert into the shared map
+  // when called from several converters at once
+  auto letter = coordinates_letter.find(current_coordinates);
+  return (letter != coordinates_letter.end()) ? letter->second : '\0';
+}
+
+char QuantizeLagerMovement(double delta_x, double delta_y, double delta_z) {
+  double x_squared = delta_x * delta_x;
+  double y_squared = delta_y * delta_y;
+  double planar_squared = x_squared + y_squared;
+  double vertical_squared = delta_z * delta_z;
+
+  if (!(planar_squared + vertical_squared > 0)) {
+    return '\0';  // No direction, like the angles of a zero (or NaN) delta
+  }
+
+  // Below 0 inside the polar cones, whose edges are at 22.5 and 157.5
+  // degrees, and inside the equator band, whose edges are at 67.5 and 112.5
+  double polar_edge_distance = planar_squared
+      - LAGER_CONE_TAN_SQUARED * vertical_squared;
+  double equator_edge_distance = vertical_squared
+      - LAGER_CONE_TAN_SQUARED * planar_squared;
+  double theta_margin = LAGER_CONE_EDGE_MARGIN
+      * (planar_squared + vertical_squared);
+  if (fabs(polar_edge_distance) <= theta_margin
+      || fabs(equator_edge_distance) <= theta_margin) {
+    return QuantizeLagerMovementAngles(delta_x, delta_y, delta_z);
+  }
+
+  // Count the theta cone edges the movement is past
+  bool up = delta_z > 0;
+  int theta_cone = (!up || polar_edge_distance > 0)
+      + (!up || equator_edge_distance < 0)
+      + (!up && equator_edge_distance > 0) + (!up && polar_edge_distance < 0);
+  if (theta_cone == 0 || theta_cone == 4) {
+    return cone_letters[theta_cone][0][0];
+  }
+
+  double x_edge_distance = x_squared - LAGER_CONE_TAN_SQUARED * y_squared;
+  double y_edge_distance = y_squared - LAGER_CONE_TAN_SQUARED * x_squared;
+  double phi_margin = LAGER_CONE_EDGE_MARGIN * planar_squared;
+  if (fabs(x_edge_distance) <= phi_margin
+      || fabs(y_edge_distance) <= phi_margin) {
+    return QuantizeLagerMovementAngles(delta_x, delta_y, delta_z);
+  }
+
+  return cone_letters[theta_cone][GetPlanarClass(delta_y, y_edge_distance)]
+                     [GetPlanarClass(delta_x, x_edge_distance)];
+}
+
+void QuantizeLagerMovements(const double* delta_x, const double* delta_y,
+                            const double* delta_z, size_t num_movements,
+                            char* letters) {
+  for (size_t i = 0; i < num_movements; i++) {
+    letters[i] = QuantizeLagerMovement(delta_x[i], delta_y[i], delta_z[i]);
+  }
+}
@@ -0,0 +1,61 @@
+/*
+ * lager_quantizer.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_QUANTIZER_H_
+#define LAGER_QUANTIZER_H_
+
+#include <stddef.h>
+
+/**
+ * Takes the change in X, Y, and Z Cartesian coordinates and returns the
+ * equivalent theta change in spherical coordinates.
+ */
+double GetMovementThetaInDegrees(double delta_x, double delta_y,
+                                 double delta_z);
+
+/**
+ * Takes the change in X and Y Cartesian coordinates of a movement and returns
+ * its azimuth in degrees, whatever its theta angle.
+ */
+double GetMovementAzimuthInDegrees(double delta_x, double delta_y);
+
+/**
+ * Takes the change in X and Y Cartesian coordinates and the theta angle of a
+ * movement, and returns the equivalent phi change in spherical coordinates.
+ */
+double GetMovementPhiInDegrees(double delta_x, double delta_y, double theta);
+
+/**
+ * Takes an angle and returns that closest angle in 45 degree increments.
+ */
+int SnapAngle(double angle);
+
+/**
+ * Takes snapped theta and phi spherical coordinates and returns the
+ * corresponding LaGeR letter.
+ */
+char GetLagerLetter(int snap_theta, int snap_phi);
+
+/**
+ * Takes the change in X, Y, and Z Cartesian coordinates of a movement and
+ * returns its LaGeR letter, or '\0' if there was no movement.
+ *
+ * The letter is the same as snapping the spherical angles of the movement
+ * with SnapAngle() and looking them up with GetLagerLetter(), but the
+ * direction cone of the movement is found by comparing the squared
+ * components against squared cone tangents, without trigonometry.
+ */
+char QuantizeLagerMovement(double delta_x, double delta_y, double delta_z);
+
+/**
+ * Takes arrays with the X, Y, and Z changes of a number of movements and
+ * fills an array with their LaGeR letters.
+ */
+void QuantizeLagerMovements(const double* delta_x, const double* delta_y,
+                            const double* delta_z, size_t num_movements,
+                            char* letters);
+
+#endif /* LAGER_QUANTIZER_H_ */
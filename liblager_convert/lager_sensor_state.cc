@@ -0,0 +1,70 @@
+/*
+ * lager_sensor_state.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "lager_sensor_state.h"
+
+using std::chrono::milliseconds;
+using std::chrono::system_clock;
+using std::chrono::time_point;
+
+/*
+ * Takes the state of the sensors, the index of a sensor and the time of a
+ * movement, and returns whether the sensor moved recently enough before it
+ * and has not been grouped since.
+ */
+static inline bool CanGroupMovement(const LagerSensorState& sensors,
+                                    size_t sensor_index,
+                                    time_point<system_clock> time) {
+  return sensors.last_grouped_movement_time[sensor_index]
+      != sensors.last_movement_time[sensor_index]
+      && time - sensors.last_movement_time[sensor_index]
+          < milliseconds(MOVEMENT_GROUPING_TIME_MILLISECONDS);
+}
+
+void AddSensorLetter(LagerSensorState& sensors, size_t sensor_index,
+                     char letter, time_point<system_clock> time,
+                     LagerMovementBuffer& movements) {
+  size_t num_sensors = sensors.size();
+  sensors.last_movement_time[sensor_index] = time;
+  sensors.last_letter[sensor_index] = letter;
+
+  bool grouped = false;
+  for (size_t i = 0; i < num_sensors; i++) {
+    grouped |= (i != sensor_index && CanGroupMovement(sensors, i, time));
+  }
+
+  if (!grouped) {
+    for (size_t i = 0; i < num_sensors; i++) {
+      if (i != sensor_index) {
+        sensors.last_letter[i] = '_';
+      }
+    }
+
+    char* movement = movements.AppendMovement();
+    if (movement != NULL) {
+      movement[sensor_index] = letter;
+    }
+    return;
+  }
+
+  // Grouped letters rewrite the last movement instead of adding a new one
+  char* movement = movements.GetLastMovement();
+  if (movement == NULL) {
+    movement = movements.AppendMovement();
+    if (movement == NULL) {
+      return;
+    }
+  }
+
+  sensors.last_grouped_movement_time[sensor_index] = time;
+  movement[sensor_index] = letter;
+  for (size_t i = 0; i < num_sensors; i++) {
+    if (i != sensor_index && CanGroupMovement(sensors, i, time)) {
+      sensors.last_grouped_movement_time[i] = sensors.last_movement_time[i];
+      movement[i] = sensors.last_letter[i];
+    }
+  }
+}
@@ -0,0 +1,75 @@
+/*
+ * lager_sensor_state.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_SENSOR_STATE_H_
+#define LAGER_SENSOR_STATE_H_
+
+#include <stddef.h>
+#include <chrono>
+#include <vector>
+using std::vector;
+
+#include "lager_movement_buffer.h"
+
+/// Sensor movements this close in time are grouped into one LaGeR movement
+#define MOVEMENT_GROUPING_TIME_MILLISECONDS 200
+/// A gesture ends once no sensor has moved for this long
+#define GESTURE_PAUSE_TIME_MILLISECONDS 500
+
+/// Number of position axes reported by each sensor
+#define LAGER_SENSOR_AXES 3
+
+/**
+ * State kept for every sensor converted to LaGeR, in structure-of-arrays
+ * form: each field holds one element per sensor, so the same field of every
+ * sensor is contiguous and loops over the sensors can be vectorized.
+ */
+struct LagerSensorState {
+  /// Letter of the most recent movement of each sensor
+  vector<char> last_letter;
+  /// Last time each sensor moved
+  vector<std::chrono::time_point<std::chrono::system_clock> >
+      last_movement_time;
+  /// Last time the movement of each sensor was grouped with another sensor
+  vector<std::chrono::time_point<std::chrono::system_clock> >
+      last_grouped_movement_time;
+
+  /**
+   * Returns the number of sensors.
+   */
+  size_t size() const {
+    return last_letter.size();
+  }
+
+  /**
+   * Takes a number of sensors and a time, and resets the state of that many
+   * sensors as if they last moved at that time.
+   */
+  void Reset(size_t num_sensors,
+             std::chrono::time_point<std::chrono::system_clock> time) {
+    last_letter.assign(num_sensors, '_');
+    last_movement_time.assign(num_sensors, time);
+    last_grouped_movement_time.assign(num_sensors, time);
+  }
+};
+
+/**
+ * Takes the state of the sensors, the index of a sensor that moved, the
+ * letter of its movement, the sensor time of the movement, and the movements
+ * of the current gesture, then adds the letter to the gesture.
+ *
+ * If other sensors moved less than MOVEMENT_GROUPING_TIME_MILLISECONDS
+ * earlier and have not been grouped since, the letter rewrites the last
+ * movement, grouped with their letters. Otherwise it starts a new movement in
+ * which every other sensor is idle ('_'). If the movements are full, a new
+ * movement is dropped and the movements are marked as truncated.
+ */
+void AddSensorLetter(
+    LagerSensorState& sensors, size_t sensor_index, char letter,
+    std::chrono::time_point<std::chrono::system_clock> time,
+    LagerMovementBuffer& movements);
+
+#endif /* LAGER_SENSOR_STATE_H_ */
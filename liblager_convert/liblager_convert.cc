@@ -8,10 +8,10 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <poll.h>
+#include <sys/timerfd.h>
 #include <time.h>     // for nanosleep
-
-#include "spherical_coordinates.h"
-#include "coordinates_letter.h"
+#include <unistd.h>
 
 #include "liblager_convert.h"
 
@@ -21,15 +21,18 @@ using std::string;
 using std::ifstream;
 
 using std::chrono::duration;
+using std::chrono::duration_cast;
 using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
 using std::chrono::seconds;
 using std::chrono::system_clock;
 using std::chrono::time_point;
 
 #define MAIN_SLEEP_INTERVAL_MICROSECONDS 10000 // 10ms
 #define MAIN_SLEEP_INTERVAL_MILLISECONDS MAIN_SLEEP_INTERVAL_MICROSECONDS/1000
-#define GESTURE_PAUSE_TIME_MILLISECONDS 500
-#define MOVEMENT_GROUPING_TIME_MILLISECONDS 200
+#define PAUSE_TIMER_ACTIVE_POLL_INTERVAL_MILLISECONDS 1
+#define PAUSE_TIMER_IDLE_POLL_INTERVAL_MILLISECONDS 20
 
 #define MIN_GRAB_VALUE 0.82
 
@@ -43,101 +46,78 @@ LagerConverter* LagerConverter::Instance() {
   return instance_;
 }
 
-void LagerConverter::LoadSensorScaleFactor() {
-  ifstream sensor_scale_file;
-  string current_line;
-
-  sensor_scale_file.open("/tmp/sensor_scale.cfg");
-  if (!sensor_scale_file.is_open()) {
-    cout << "Error opening sensor scale file!" << endl;
-    return;
-  }
+LagerConverter::LagerConverter()
+    : own_context_(new osvr::clientkit::ClientContext("LagerConverter")),
+      context_(own_context_.get()),
+      movements_(LAGER_CONVERTER_NUM_SENSORS) {
+  ReserveLagerStrings();
+}
 
-  getline(sensor_scale_file, current_line);
-  stringstream ss(current_line);
-  ss >> LagerConverter::Instance()->minimum_movement_distance_;
+LagerConverter::LagerConverter(LagerSensorContext* shared_context)
+    : context_(&shared_context->context_),
+      shared_context_(shared_context),
+      movements_(LAGER_CONVERTER_NUM_SENSORS) {
+  ReserveLagerStrings();
 }
 
-double LagerConverter::GetDeltaX(const OSVR_PositionReport* last_report,
-                                       const OSVR_PositionReport* cur_report) {
-  if (LagerConverter::Instance()->tracking_mode_ == LCTrackingMode::absolute) {
-    return (cur_report->xyz.data[2] - last_report->xyz.data[2]);
+void LagerConverter::Start() {
+  LoadSensorScaleFactor();
+
+  if (shared_context_ != NULL) {
+    shared_context_->AddConverter(this);
   } else {
-    return cur_report->xyz.data[2];
+    InitializeTrackers();
+    if (use_pause_timer_) {
+      CreatePauseTimer();
+    }
+    processing_thread_ = boost::thread(&LagerConverter::ProcessSensorEvents,
+                                       this);
   }
+
+  started_ = true;
 }
 
-double LagerConverter::GetDeltaY(const OSVR_PositionReport* last_report,
-                                       const OSVR_PositionReport* cur_report) {
-  if (LagerConverter::Instance()->tracking_mode_ == LCTrackingMode::absolute) {
-    return (cur_report->xyz.data[0] - last_report->xyz.data[0]);
-  } else {
-    return cur_report->xyz.data[0];
+void LagerConverter::Stop() {
+  if (!started_) {
+    return;
   }
-}
 
-double LagerConverter::GetDeltaZ(const OSVR_PositionReport* last_report,
-                                       const OSVR_PositionReport* cur_report) {
-  if (LagerConverter::Instance()->tracking_mode_ == LCTrackingMode::absolute) {
-    return (cur_report->xyz.data[1] - last_report->xyz.data[1]);
+  if (shared_context_ != NULL) {
+    shared_context_->RemoveConverter(this);
   } else {
-    return cur_report->xyz.data[1];
+    processing_thread_.interrupt();
+    processing_thread_.join();
+    ClosePauseTimer();
+    FreeTrackers();
   }
-}
 
-double LagerConverter::GetMovementThetaInDegrees(double delta_x,
-                                                 double delta_y,
-                                                 double delta_z) {
-  double movementTheta = acos(
-      delta_z
-          / (sqrt(pow(delta_x, 2.0) + pow(delta_y, 2.0) + pow(delta_z, 2.0))))
-      * (180.0 / M_PI);
-  return fmod(movementTheta + 360.0, 360.0);  // Always returns a positive angle
+  started_ = false;
 }
 
-double LagerConverter::GetMovementPhiInDegrees(double delta_x,
-                                               double delta_y,
-                                               double theta) {
-  int snap_theta = SnapAngle(theta);
-  if (snap_theta == 0 || snap_theta == 180) {
-    return 0;  // Phi becomes meaningless at the north and south poles, so we default it to 0.
-  }
-
-  double movementPhi = atan2(delta_y, delta_x) * (180.0 / M_PI);
-  return fmod(movementPhi + 360.0, 360.0);  // Always returns a positive angle
-}
+void LagerConverter::LoadSensorScaleFactor() {
+  ifstream sensor_scale_file;
+  string current_line;
 
-/* Snaps angle to 45 degree intervals */
-int LagerConverter::SnapAngle(double aAngle) {
-  return 45 * (round(aAngle / 45.0));
-}
+  sensor_scale_file.open("/tmp/sensor_scale.cfg");
+  if (!sensor_scale_file.is_open()) {
+    cout << "Error opening sensor scale file!" << endl;
+    return;
+  }
 
-double LagerConverter::GetDistanceSquared(
-    const OSVR_PositionReport* last_report, const OSVR_PositionReport* cur_report) {
-  return (last_report->xyz.data[0] - cur_report->xyz.data[0])
-      * (last_report->xyz.data[0] - cur_report->xyz.data[0])
-      + (last_report->xyz.data[1] - cur_report->xyz.data[1])
-          * (last_report->xyz.data[1] - cur_report->xyz.data[1])
-      + (last_report->xyz.data[2] - cur_report->xyz.data[2])
-          * (last_report->xyz.data[2] - cur_report->xyz.data[2]);
+  getline(sensor_scale_file, current_line);
+  stringstream ss(current_line);
+  ss >> minimum_movement_distance_;
 }
 
 #define abs(x) ((x)<0 ? -(x) : (x))
 
-void LagerConverter::PrintSensorCoordinates(const OSVR_PositionReport* last_report,
+void LagerConverter::PrintSensorCoordinates(const unsigned int sensor_index,
                                             const OSVR_PositionReport* cur_report) {
   printf("\nSensor %d is now at (%g,%g,%g)\n", cur_report->sensor, cur_report->xyz.data[0],
          cur_report->xyz.data[1], cur_report->xyz.data[2]);
-  printf("old/new X: %g, %g\n", last_report->xyz.data[1], cur_report->xyz.data[1]);
-  printf("old/new Y: %g, %g\n", last_report->xyz.data[0], cur_report->xyz.data[0]);
-  printf("old/new Z: %g, %g\n", last_report->xyz.data[2], cur_report->xyz.data[2]);
-}
-
-char LagerConverter::GetCurrentLetter(int snap_theta, int snap_phi) {
-  struct SphericalCoordinates current_coordinates;
-  current_coordinates.theta = snap_theta;
-  current_coordinates.phi = snap_phi;
-  return coordinates_letter[current_coordinates];
+  printf("old/new X: %g, %g\n", pipeline_.GetLastPosition(1, sensor_index), cur_report->xyz.data[1]);
+  printf("old/new Y: %g, %g\n", pipeline_.GetLastPosition(0, sensor_index), cur_report->xyz.data[0]);
+  printf("old/new Z: %g, %g\n", pipeline_.GetLastPosition(2, sensor_index), cur_report->xyz.data[2]);
 }
 
 int LagerConverter::GetMillisecondsUntilNow(
@@ -166,35 +146,7 @@ bool LagerConverter::GesturePaused() {
 }
 
 void LagerConverter::ResetLagerString() {
-  lager_string_.str("");
-}
-
-void LagerConverter::CalculateMovementDeltas(const OSVR_PositionReport* cur_report,
-                                             const OSVR_PositionReport* last_report,
-                                             double& delta_x,
-                                             double& delta_y,
-                                             double& delta_z) {
-  delta_x = GetDeltaX(last_report, cur_report);
-  delta_y = GetDeltaY(last_report, cur_report);
-  delta_z = GetDeltaZ(last_report, cur_report);
-  //printf("X delta: %g, Y delta: %g, Z delta: %g\n", deltaX, deltaY, deltaZ);
-}
-
-void LagerConverter::CalculateMovementAngles(double& theta, double& phi,
-                                             int& snap_theta, int& snap_phi,
-                                             double delta_x,
-                                             double delta_y,
-                                             double delta_z) {
-  theta = GetMovementThetaInDegrees(delta_x, delta_y, delta_z);
-  snap_theta = SnapAngle(theta);
-  phi = GetMovementPhiInDegrees(delta_x, delta_y, theta);
-  snap_phi = SnapAngle(phi);
-}
-
-void LagerConverter::MoveHeadToBeginningOfLetterPair() {
-  if (lager_string_.str().size() >= 3) {
-    lager_string_.seekp(-3, lager_string_.cur);
-  }
+  movements_.Clear();
 }
 
 time_point<system_clock> LagerConverter::GetCurrentMovementTime(
@@ -207,231 +159,301 @@ time_point<system_clock> LagerConverter::GetCurrentMovementTime(
 }
 
 void LagerConverter::UpdateLagerString(const unsigned int sensor_index,
-                                       const OSVR_PositionReport* cur_report,
                                        const OSVR_TimeValue* time_value,
-                                       const int snap_theta,
-                                       const int snap_phi) {
-  int time_since_sensor_0_last_movement = 0;
-  int time_since_sensor_1_last_movement = 0;
-  char currentLetter = GetCurrentLetter(snap_theta, snap_phi);
-
-  if (sensor_index == 0) {
-    last_sensor_0_letter_ = currentLetter;
-    time_since_sensor_1_last_movement = GetMillisecondsSinceTrackerTime(
-        time_value, sensor_1_last_movement_time_);
-
-    /*
-     * If sensor 1 reported new movements since the last time it was grouped,
-     * and if it moved not too long ago, group its letter with sensor 0's.
-     */
-    if ((sensor_1_last_grouped_movement_time_ != sensor_1_last_movement_time_)
-        && (time_since_sensor_1_last_movement
-            < MOVEMENT_GROUPING_TIME_MILLISECONDS)) {
-      //printf("S0: Grouping with previous S1. Current: %c, last: %c\n", currentLetter, last_sensor_1_letter);
-      sensor_0_last_grouped_movement_time_ = GetCurrentMovementTime(time_value);
-      sensor_1_last_grouped_movement_time_ = sensor_1_last_movement_time_;
-      MoveHeadToBeginningOfLetterPair();
-      lager_string_ << currentLetter << last_sensor_1_letter_;
-    } else {
-      //printf("S0 ELSE. GroupingT=MovementT?: %i, tSS1: %i\n", sensor_1_last_grouped_movement_time == sensor_1_last_movement_time, time_since_sensor_1);
-      last_sensor_1_letter_ = '_';
-      lager_string_ << currentLetter << last_sensor_1_letter_;
-    }
-  } else {
-    last_sensor_1_letter_ = currentLetter;
-    time_since_sensor_0_last_movement = GetMillisecondsSinceTrackerTime(
-        time_value, sensor_0_last_movement_time_);
+                                       const char letter) {
+  time_point<system_clock> current_movement_time = GetCurrentMovementTime(
+      time_value);
 
-    /*
-     * If sensor 0 reported new movements since the last time it was grouped,
-     * and if it moved not too long ago, group its letter with sensor 1's.
-     */
-    if ((sensor_0_last_grouped_movement_time_ != sensor_0_last_movement_time_)
-        && (time_since_sensor_0_last_movement
-            < MOVEMENT_GROUPING_TIME_MILLISECONDS)) {
-      //printf("S1: Grouping with previous S0. Current: %c, last: %c\n", currentLetter, last_sensor_0_letter);
-      sensor_0_last_grouped_movement_time_ = sensor_0_last_movement_time_;
-      sensor_1_last_grouped_movement_time_ = GetCurrentMovementTime(time_value);
-      MoveHeadToBeginningOfLetterPair();
-      lager_string_ << last_sensor_0_letter_ << currentLetter;
-    } else {
-      //printf("S1 ELSE. GroupingT=MovementT?: %i, tSS0: %i\n", sensor_0_last_grouped_movement_time == sensor_0_last_movement_time, time_since_sensor_0);
-      last_sensor_0_letter_ = '_';
-      lager_string_ << last_sensor_0_letter_ << currentLetter;
-    }
+  if (movements_.empty()) {
+    gesture_start_time_ = current_movement_time;
   }
-  lager_string_ << ".";
+
+  AddSensorLetter(sensors_, sensor_index, letter, current_movement_time,
+                  movements_);
 
   if (print_updates_) {
-    cout << "Gesture: " << lager_string_.str() << endl;
+    movements_.GetString(lager_update_string_);
+    cout << "Gesture: " << lager_update_string_ << endl;
     cout << endl;
   }
+
+  if (lager_update_callback_ != NULL && !gesture_recognized_early_) {
+    movements_.GetString(lager_update_string_);
+    gesture_recognized_early_ = lager_update_callback_(lager_update_string_,
+                                                       lager_update_user_data_);
+  }
 }
 
-void LagerConverter::UpdateTimers(const unsigned int sensor_index,
-                                  const OSVR_PositionReport* cur_report,
-                                  const OSVR_TimeValue* time_value) {
+void LagerConverter::UpdateTimers(const OSVR_TimeValue* time_value) {
   time_point < system_clock > current_movement_time = GetCurrentMovementTime(
       time_value);
   UpdateTimePoint(global_last_movement_time_, current_movement_time);
 
-  if (sensor_index == 0) {
-    UpdateTimePoint(sensor_0_last_movement_time_, current_movement_time);
-  } else {
-    UpdateTimePoint(sensor_1_last_movement_time_, current_movement_time);
+  if (pause_timer_fd_ >= 0) {
+    ArmPauseTimer();
   }
-
-  //printf("Updated. GLMT: %i, S0LMT: %i, S1LMT: %i\n", GetMillisecondsSinceTrackerTime(tracker, global_last_movement_time), GetMillisecondsSinceTrackerTime(tracker, sensor_0_last_movement_time), GetMillisecondsSinceTrackerTime(tracker, sensor_1_last_movement_time));
-}
-
-void LagerConverter::HandleTrackerChangeLeft(void *user_data,
-                        const OSVR_TimeValue *time_value,
-                        const OSVR_PositionReport *cur_report) {
-  HandleTrackerChange(0, time_value, cur_report);
 }
 
-void LagerConverter::HandleTrackerChangeRight(void *user_data,
+void LagerConverter::HandleTrackerChangeForSensor(void *user_data,
                         const OSVR_TimeValue *time_value,
                         const OSVR_PositionReport *cur_report) {
-  HandleTrackerChange(1, time_value, cur_report);
+  SensorCallbackData* callback_data =
+      static_cast<SensorCallbackData*>(user_data);
+  callback_data->converter->HandleTrackerChange(callback_data->sensor_index,
+                                                time_value, cur_report);
 }
 
 void LagerConverter::HandleTrackerChange(const unsigned int sensor_index,
                         const OSVR_TimeValue *time_value,
                         const OSVR_PositionReport *cur_report) {
-  LagerConverter* lager_converter = LagerConverter::Instance();
-  OSVR_PositionReport *last_report;
-  double deltaX, deltaY, deltaZ;
-  double theta, phi;
-  int snap_theta, snap_phi;
-
-  if (sensor_index == 0) {
-    last_report = &lager_converter->last_report_0_;
-  } else {
-    last_report = &lager_converter->last_report_1_;
-  }
+  double time_seconds = (time_value->seconds * 1000000.0
+      + time_value->microseconds) / 1e6;
+  char letter;
 
-  if (!lager_converter->draw_gestures_1_ && !lager_converter->draw_gestures_2_) {
-    *last_report = *cur_report;
+  if (!draw_gestures_1_ && !draw_gestures_2_) {
+    pipeline_.TrackPosition(sensor_index, time_seconds, cur_report->xyz.data);
     return;
   }
 
-  if (lager_converter->GetDistanceSquared(last_report, cur_report)
-      > lager_converter->minimum_movement_distance_) {
-    if (lager_converter->print_updates_) {
+  if (pipeline_.ProcessReport(sensor_index, time_seconds,
+                              cur_report->xyz.data, letter)) {
+    if (print_updates_) {
       printf("Update for sensor: %i at time: %ld.%06d\n", cur_report->sensor,
                time_value->seconds, time_value->microseconds);
-      //printf("GLMT: %i, S0LMT: %i, S1LMT: %i\n", GetMillisecondsSinceTrackerTime(tracker, global_last_movement_time), GetMillisecondsSinceTrackerTime(tracker, sensor_0_last_movement_time), GetMillisecondsSinceTrackerTime(tracker, sensor_1_last_movement_time));
-      //printSensorCoordinates(last_report, tracker);
+      //printSensorCoordinates(sensor_index, cur_report);
     }
 
-    lager_converter->UpdateTimers(sensor_index, cur_report, time_value);
-
-    lager_converter->CalculateMovementDeltas(cur_report, last_report, deltaX,
-                                             deltaY, deltaZ);
-    lager_converter->CalculateMovementAngles(theta, phi, snap_theta, snap_phi,
-                                             deltaX, deltaY, deltaZ);
-
-    lager_converter->UpdateLagerString(sensor_index, cur_report, time_value, snap_theta, snap_phi);
+    UpdateTimers(time_value);
 
-    *last_report = *cur_report;
+    UpdateLagerString(sensor_index, time_value, letter);
   }
 }
 
 void LagerConverter::HandleButtonChangeLeft(void *user_data, const OSVR_TimeValue *time_value,
                       const OSVR_ButtonReport *cur_report) {
-  LagerConverter* lager_converter = LagerConverter::Instance();
+  LagerConverter* lager_converter = static_cast<LagerConverter*>(user_data);
   lager_converter->draw_gestures_1_ = (cur_report->state == 1) ? true : false;
 }
 
 void LagerConverter::HandleButtonChangeRight(void *user_data, const OSVR_TimeValue *time_value,
                       const OSVR_ButtonReport *cur_report) {
-  LagerConverter* lager_converter = LagerConverter::Instance();
+  LagerConverter* lager_converter = static_cast<LagerConverter*>(user_data);
   lager_converter->draw_gestures_2_ = (cur_report->state == 1) ? true : false;
 }
 
 void LagerConverter::HandleGrabChangeLeft(void * user_data, const OSVR_TimeValue * time_value,
                       const OSVR_AnalogReport *cur_report) {
-    LagerConverter* lager_converter = LagerConverter::Instance();
+    LagerConverter* lager_converter = static_cast<LagerConverter*>(user_data);
     lager_converter->draw_gestures_1_ = (cur_report->state > MIN_GRAB_VALUE) ? true : false;
 }
 
 void LagerConverter::HandleGrabChangeRight(void * user_data, const OSVR_TimeValue * time_value,
                       const OSVR_AnalogReport *cur_report) {
-    LagerConverter* lager_converter = LagerConverter::Instance();
+    LagerConverter* lager_converter = static_cast<LagerConverter*>(user_data);
     lager_converter->draw_gestures_2_ = (cur_report->state > MIN_GRAB_VALUE) ? true : false;
 }
 
 void LagerConverter::InitializeTrackers() {
-  // Initialize the tracker handlers
-  left_tracker_ = context_.getInterface("/me/hands/left");
-  right_tracker_ = context_.getInterface("/me/hands/right");
-
-  left_tracker_.registerCallback(&HandleTrackerChangeLeft, NULL);
-  right_tracker_.registerCallback(&HandleTrackerChangeRight, NULL);
+  // Size the sensor state and the movements for the configured sensors
+  sensors_.Reset(sensor_paths_.size(), system_clock::now());
+  pipeline_.Configure(tracking_mode_ == LCTrackingMode::relative,
+                      minimum_movement_distance_, filter_settings_);
+  pipeline_.Reset(sensor_paths_.size());
+  movements_ = LagerMovementBuffer(sensor_paths_.size());
+  ReserveLagerStrings();
+
+  // Initialize the tracker handlers, passing each this converter and its
+  // sensor index
+  trackers_.resize(sensor_paths_.size());
+  sensor_callback_data_.resize(sensor_paths_.size());
+  for (size_t i = 0; i < sensor_paths_.size(); i++) {
+    sensor_callback_data_[i].converter = this;
+    sensor_callback_data_[i].sensor_index = i;
+    trackers_[i] = context_->getInterface(sensor_paths_[i]);
+    trackers_[i].registerCallback(&HandleTrackerChangeForSensor,
+                                  &sensor_callback_data_[i]);
+  }
 
   if (use_buttons_) {
     // Initialize the button and grab handlers
-    left_button_ = context_.getInterface("/controller/left/1");
-    right_button_ = context_.getInterface("/controller/right/1");
+    left_button_ = context_->getInterface("/controller/left/1");
+    right_button_ = context_->getInterface("/controller/right/1");
+
+    left_button_.registerCallback(&HandleButtonChangeLeft, this);
+    right_button_.registerCallback(&HandleButtonChangeRight, this);
+
+    left_grab_ = context_->getInterface("/controller/left/trigger");
+    right_grab_ = context_->getInterface("/controller/right/trigger");
+
+    left_grab_.registerCallback(&HandleGrabChangeLeft, this);
+    right_grab_.registerCallback(&HandleGrabChangeRight, this);
+  }
+}
+
+void LagerConverter::FreeTrackers() {
+  for (size_t i = 0; i < trackers_.size(); i++) {
+    trackers_[i].free();
+  }
+  trackers_.clear();
+
+  if (use_buttons_) {
+    left_button_.free();
+    right_button_.free();
+    left_grab_.free();
+    right_grab_.free();
+  }
+}
+
+void LagerConverter::HandOverLagerString() {
+  LagerGesture gesture;
+  movements_.GetString(gesture.lager);
+  gesture.start_time = gesture_start_time_;
+  gesture.end_time = global_last_movement_time_;
+  gesture.truncated = movements_.IsTruncated();
+
+  if (gesture.truncated) {
+    cout << "Gesture longer than " << movements_.size()
+         << " movements, the movements after that were dropped." << endl;
+  }
+
+  if (!gesture_queue_.Push(gesture)) {
+    cout << "Dropped a gesture, the gesture queue is full." << endl;
+  }
+}
+
+void LagerConverter::CreatePauseTimer() {
+  pause_timer_fd_ = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (pause_timer_fd_ < 0) {
+    cout << "Could not create the gesture pause timer, polling instead."
+         << endl;
+  }
+}
+
+void LagerConverter::ClosePauseTimer() {
+  if (pause_timer_fd_ >= 0) {
+    close(pause_timer_fd_);
+    pause_timer_fd_ = -1;
+  }
+}
 
-    left_button_.registerCallback(&HandleButtonChangeLeft, NULL);
-    right_button_.registerCallback(&HandleButtonChangeRight, NULL);
+void LagerConverter::ArmPauseTimer() {
+  // One millisecond later than the pause time, so that GesturePaused() agrees
+  // once the timer expires
+  nanoseconds pause_time = duration_cast<nanoseconds>(
+      (global_last_movement_time_
+          + milliseconds(GESTURE_PAUSE_TIME_MILLISECONDS + 1))
+          .time_since_epoch());
+
+  struct itimerspec deadline = {};
+  deadline.it_value.tv_sec = pause_time.count() / 1000000000;
+  deadline.it_value.tv_nsec = pause_time.count() % 1000000000;
+  timerfd_settime(pause_timer_fd_, TFD_TIMER_ABSTIME, &deadline, NULL);
+}
+
+void LagerConverter::WaitForSensorEvents() {
+  struct pollfd poll_fd;
+  poll_fd.fd = pause_timer_fd_;
+  poll_fd.events = POLLIN;
+
+  /*
+   * OSVR has no descriptor to wait on, so the timeout is what collects its
+   * reports. They are queued until the next update, so while no gesture is
+   * underway they can be collected less often without losing any.
+   */
+  int timeout_ms = movements_.empty() ?
+      PAUSE_TIMER_IDLE_POLL_INTERVAL_MILLISECONDS :
+      PAUSE_TIMER_ACTIVE_POLL_INTERVAL_MILLISECONDS;
+  if (poll(&poll_fd, 1, timeout_ms) > 0) {
+    // The pause itself is checked with GesturePaused() by the caller
+    uint64_t expirations;
+    if (read(pause_timer_fd_, &expirations, sizeof(expirations))
+        != sizeof(expirations)) {
+      cout << "Could not read the gesture pause timer." << endl;
+    }
+  }
 
-    left_grab_ = context_.getInterface("/controller/left/trigger");
-    right_grab_ = context_.getInterface("/controller/right/trigger");
+  boost::this_thread::interruption_point();
+}
 
-    left_grab_.registerCallback(&HandleGrabChangeLeft, NULL);
-    right_grab_.registerCallback(&HandleGrabChangeRight, NULL);
+void LagerConverter::ServiceCurrentGesture() {
+  // If the gesture was already recognized, hand it over without waiting
+  if (gesture_recognized_early_ && !gesture_handed_over_) {
+    HandOverLagerString();
+    gesture_handed_over_ = true;
+  }
+
+  // If gesture buildup pauses, finish converting it
+  if (GesturePaused() && !movements_.empty()) {
+    /*
+     * Only try to convert gestures with more than one movement.
+     * This reduces spurious conversions from inadvertent movements.
+     */
+    if (movements_.size() > 1 && !gesture_handed_over_) {
+      HandOverLagerString();
+    }
+
+    ResetLagerString();
+    gesture_recognized_early_ = false;
+    gesture_handed_over_ = false;
   }
 }
 
 void LagerConverter::ProcessSensorEvents() {
   while (true) {
     // Request an update from the sensor context
-    context_.update();
-
-    // If gesture buildup pauses, finish converting it
-    int lager_string_length = lager_string_.str().length();
-    if (GesturePaused() && lager_string_length > 0) {
-      /*
-       * Only try to convert gestures with more than one movement pair.
-       * This reduces spurious conversions from inadvertent movements.
-       */
-      if (lager_string_length > 4) {
-        {
-          std::lock_guard < std::mutex > lock(mutex_);
-          lager_read_complete_ = false;
-          lager_write_complete_ = true;
-          lager_rw_condition_.notify_one();
-        }
-
-        {
-          std::unique_lock < std::mutex > lock(mutex_);
-          lager_rw_condition_.wait(lock, [this] {return lager_read_complete_;});
-          lager_write_complete_ = false;
-        }
-      }
+    context_->update();
 
-      ResetLagerString();
-    }
+    ServiceCurrentGesture();
 
-    // Sleep so we don't take up 100% of CPU
-    boost::this_thread::sleep_for(boost::chrono::microseconds{MAIN_SLEEP_INTERVAL_MICROSECONDS});
+    if (pause_timer_fd_ >= 0) {
+      WaitForSensorEvents();
+    } else {
+      // Sleep so we don't take up 100% of CPU
+      boost::this_thread::sleep_for(boost::chrono::microseconds{MAIN_SLEEP_INTERVAL_MICROSECONDS});
+    }
   }
 }
 
 string LagerConverter::BlockingGetLagerString() {
-  static string temp_string("");
+  LagerGesture gesture;
+  gesture_queue_.Pop(gesture);
 
-  std::unique_lock < std::mutex > lock(mutex_);
-  lager_rw_condition_.wait(lock, [this] {return lager_write_complete_;});
-  lager_write_complete_ = false;
+  return gesture.lager;
+}
+
+void LagerSensorContext::AddConverter(LagerConverter* lager_converter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lager_converter->InitializeTrackers();
+  converters_.push_back(lager_converter);
+}
+
+void LagerSensorContext::RemoveConverter(LagerConverter* lager_converter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lager_converter->FreeTrackers();
+  for (vector<LagerConverter*>::iterator it = converters_.begin();
+      it < converters_.end(); ++it) {
+    if (*it == lager_converter) {
+      converters_.erase(it);
+      break;
+    }
+  }
+}
 
-  temp_string = lager_string_.str();
+void LagerSensorContext::UpdateConverters() {
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      // Runs the sensor callbacks of every converter
+      context_.update();
 
-  lager_read_complete_ = true;
-  lager_rw_condition_.notify_one();
+      for (vector<LagerConverter*>::iterator it = converters_.begin();
+          it < converters_.end(); ++it) {
+        (*it)->ServiceCurrentGesture();
+      }
+    }
 
-  return temp_string;
+    // Sleep so we don't take up 100% of CPU
+    boost::this_thread::sleep_for(boost::chrono::microseconds{MAIN_SLEEP_INTERVAL_MICROSECONDS});
+  }
 }
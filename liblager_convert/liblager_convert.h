@@ -9,33 +9,77 @@
 #define LIBLAGER_CONVERT_H_
 
 #include <string>
-#include <mutex>
-#include <condition_variable>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <boost/thread.hpp>
 
 #include <osvr/ClientKit/Context.h>
 #include <osvr/ClientKit/Interface.h>
 #include <osvr/ClientKit/Context_decl.h>
 
+#include "lager_gesture_queue.h"
+#include "lager_movement_buffer.h"
+#include "lager_pipeline.h"
+#include "lager_sensor_state.h"
+
 using std::string;
 using std::stringstream;
 using std::chrono::system_clock;
 using std::chrono::time_point;
+using std::vector;
 
 enum class LCTrackingMode { absolute, relative };
 
+/// Number of sensors converted by default, the left and right hands
+#define LAGER_CONVERTER_NUM_SENSORS 2
+
+/**
+ * Callback that receives the LaGeR string of the gesture being drawn after
+ * every update, along with the user data it was registered with.
+ *
+ * Returns true if the gesture has been recognized already. The string is then
+ * queued for BlockingGetLagerString() right away, and the rest of the
+ * gesture is discarded until the movements pause.
+ */
+typedef bool (*LagerUpdateCallback)(const string& lager_string,
+                                    void* user_data);
+
+class LagerSensorContext;
+
 /**
  * Converts the movement of input sensors into LaGeR strings.
+ *
+ * Several converters can run in one process, for instance one per user or
+ * station, each with its own sensors, settings and gesture queue.
  */
 class LagerConverter {
  public:
   /**
-   * Returns a pointer to an instance of the class.
-   * Instantiates the class if needed.
+   * Returns a pointer to an instance of the class shared by the whole
+   * process. Instantiates the class if needed.
    */
   static LagerConverter* Instance();
 
+  /**
+   * Constructor for this class.
+   * Creates an OSVR context of its own, which is updated by the converter's
+   * processing thread once started.
+   */
+  LagerConverter();
+
+  /**
+   * Constructor for this class, with a parameter taking a sensor context
+   * shared with other converters. The converter registers its sensors with
+   * the shared context, and is serviced by the context's update thread
+   * instead of a thread of its own.
+   */
+  explicit LagerConverter(LagerSensorContext* shared_context);
+
+  LagerConverter(const LagerConverter&) = delete;
+  LagerConverter& operator=(const LagerConverter&) = delete;
+
   /**
    * Sets the print_updates_ member variable.
    *
@@ -73,13 +117,66 @@ class LagerConverter {
     tracking_mode_ = tracking_mode;
   }
 
+  /**
+   * Sets the OSVR paths of the sensors to convert, one LaGeR letter per
+   * sensor in every movement, in the given order. Defaults to the left and
+   * right hands. Must be called before Start().
+   */
+  void SetSensorPaths(const vector<string>& sensor_paths) {
+    sensor_paths_ = sensor_paths;
+  }
+
+  /**
+   * Sets how sensor jitter is filtered out before movements are converted to
+   * LaGeR letters. Filtering is disabled by default. Must be called before
+   * Start().
+   */
+  void SetFilterSettings(const LagerFilterSettings& filter_settings) {
+    filter_settings_ = filter_settings;
+  }
+
+  /**
+   * Sets the use_pause_timer_ member variable.
+   *
+   * If true, the end of a gesture is detected by a timer that is armed again
+   * after every movement, instead of by checking the time every 10 ms.
+   *
+   * OSVR ClientKit exposes no file descriptor for its reports, so the context
+   * is still polled: every millisecond while a gesture is being drawn, and
+   * every 20 ms otherwise, when only the poll wakes the thread. Reports queue
+   * up in OSVR between updates, so none are lost. Must be called before
+   * Start(). Converters on a shared sensor context are serviced by its
+   * thread, and never use the timer.
+   */
+  void SetUsePauseTimer(bool use_pause_timer) {
+    use_pause_timer_ = use_pause_timer;
+  }
+
+  /**
+   * Sets what happens to a completed gesture when the queue of gestures
+   * waiting to be read is full. Defaults to dropping the oldest gesture, so
+   * the converter never waits for its consumer.
+   */
+  void SetGestureQueueOverflow(LagerQueueOverflow overflow) {
+    gesture_queue_.SetOverflow(overflow);
+  }
+
+  /**
+   * Sets the callback that receives LaGeR string updates while a gesture is
+   * being drawn. It is called from the sensor processing thread.
+   */
+  void SetLagerUpdateCallback(LagerUpdateCallback lager_update_callback,
+                              void* user_data) {
+    lager_update_callback_ = lager_update_callback;
+    lager_update_user_data_ = user_data;
+  }
+
   /**
    * Destructor for this class.
    * Takes care of joining threads and deleting dynamically allocated variables.
    */
   ~LagerConverter() {
-    processing_thread_.interrupt();
-    processing_thread_.join();
+    Stop();
   }
 
   /**
@@ -91,68 +188,63 @@ class LagerConverter {
    * Initializes the movement tracking callbacks and starts processing sensor
    * events.
    */
-  void Start() {
-    LoadSensorScaleFactor();
-    InitializeTrackers();
-    processing_thread_ = boost::thread(&LagerConverter::ProcessSensorEvents, this);
-  }
+  void Start();
 
   /**
-   * Stops processing sensor events and deletes the movement tracking objects.
+   * Stops processing sensor events and frees the movement tracking
+   * interfaces.
    */
-  void Stop() {
-    processing_thread_.interrupt();
-    processing_thread_.join();
-  }
+  void Stop();
 
   /**
-   * Returns the LaGeR string that corresponds to the latest sensor gesture.
-   * If a gesture is underway, this function blocks until the gesture has
-   * finished.
+   * Returns the LaGeR string of the oldest completed gesture that has not
+   * been read yet, blocking until a gesture completes if there is none.
    */
   string BlockingGetLagerString();
 
- private:
   /**
-   * Constructor for this class.
-   * Initializes the OSVR context.
+   * Takes a gesture and moves the oldest completed gesture that has not been
+   * read yet into it, along with its start and end times, blocking until a
+   * gesture completes if there is none.
    */
-  LagerConverter() : context_("LagerConverter") {
+  void BlockingGetGesture(LagerGesture& gesture) {
+    gesture_queue_.Pop(gesture);
   }
-  ;
 
   /**
-   * Constructor for this class, with a parameter taking a reference to
-   * a class instance.
-   * Initializes the OSVR context.
+   * Takes a gesture and moves the oldest completed gesture that has not been
+   * read yet into it. Returns false without blocking if there is none.
    */
-  LagerConverter(LagerConverter const&) : context_("LagerConverter") {
+  bool TryGetGesture(LagerGesture& gesture) {
+    return gesture_queue_.TryPop(gesture);
   }
-  ;
+
+ private:
+  friend class LagerSensorContext;
 
   /**
-   * Empty implementation of the operator= for this class.
+   * Identifies the converter and sensor that a tracker callback belongs to.
    */
-  LagerConverter& operator=(LagerConverter const&) {
-  }
-  ;
+  struct SensorCallbackData {
+    LagerConverter* converter;
+    unsigned int sensor_index;
+  };
 
-  /// OSVR context
-  osvr::clientkit::ClientContext context_;
+  /// OSVR context owned by this converter, if it does not share one
+  std::unique_ptr<osvr::clientkit::ClientContext> own_context_;
+  /// OSVR context the sensors are registered with
+  osvr::clientkit::ClientContext* context_;
+  /// Shared sensor context servicing this converter, or NULL if it has its
+  /// own
+  LagerSensorContext* shared_context_ = NULL;
+  /// Indicates that the converter has been started and not stopped since
+  bool started_ = false;
 
   /// Pointer to an instance of this class
   static LagerConverter* instance_;
 
-  /// Mutex variable use to protect access to other variables
-  std::mutex mutex_;
-  /// Condition variable used to synchronize threads reading and writing
-  /// the LaGeR string for the current gesture
-  std::condition_variable lager_rw_condition_;
-
-  /// Indicates that a thread has finished reading a LaGeR string
-  bool lager_read_complete_ = false;
-  /// Indicates that a thread has finished writing a LaGeR string
-  bool lager_write_complete_ = false;
+  /// Completed gestures waiting to be read
+  LagerGestureQueue gesture_queue_;
 
   /// The thread that is used for processing sensor events
   boost::thread processing_thread_;
@@ -161,10 +253,19 @@ class LagerConverter {
   /// Indicates whether sensor buttons are used to determine when to convert
   /// movements to LaGeR.
   bool use_buttons_ = false;
-
-  /// Pointer to the current tracker structures
-  osvr::clientkit::Interface left_tracker_;
-  osvr::clientkit::Interface right_tracker_;
+  /// Indicates whether gesture pauses are detected with a timer instead of
+  /// by checking the time after every update.
+  bool use_pause_timer_ = false;
+  /// timerfd that expires when the current gesture pauses, or -1 if the
+  /// pause timer is not used
+  int pause_timer_fd_ = -1;
+
+  /// OSVR paths of the converted sensors
+  vector<string> sensor_paths_ = {"/me/hands/left", "/me/hands/right"};
+  /// Tracker interface of each converted sensor
+  vector<osvr::clientkit::Interface> trackers_;
+  /// User data of the tracker callback of each converted sensor
+  vector<SensorCallbackData> sensor_callback_data_;
 
   /// Pointer to the current button structures
   osvr::clientkit::Interface left_button_;
@@ -174,10 +275,12 @@ class LagerConverter {
   osvr::clientkit::Interface left_grab_;
   osvr::clientkit::Interface right_grab_;
 
-  /// Last report for sensor 0
-  OSVR_PositionReport last_report_0_;
-  /// Last report for sensor 1
-  OSVR_PositionReport last_report_1_;
+  /// Letters and movement times of the converted sensors
+  LagerSensorState sensors_;
+  /// Stages that turn sensor reports into LaGeR letters
+  LagerDefaultPipeline pipeline_;
+  /// Jitter filtering configured into the pipeline on Start()
+  LagerFilterSettings filter_settings_;
 
   /// Whether to interpret sensor tracking with absolute or relative
   /// coordinates.
@@ -195,57 +298,94 @@ class LagerConverter {
   bool draw_gestures_1_ = false;
   bool draw_gestures_2_ = false;
 
-  /// The LaGeR string for the current sensor movements
-  std::stringstream lager_string_;
+  /// The movements of the current gesture
+  LagerMovementBuffer movements_;
+  /// LaGeR string passed to the update callback and printed out, rebuilt
+  /// after every movement without reallocating
+  string lager_update_string_;
 
-  /// The last time there was any movement
-  time_point<system_clock> global_last_movement_time_ = system_clock::now();
+  /// Callback that receives LaGeR string updates, if any
+  LagerUpdateCallback lager_update_callback_ = NULL;
+  /// User data passed to the LaGeR string update callback
+  void* lager_update_user_data_ = NULL;
+  /// Indicates that the update callback recognized the current gesture
+  bool gesture_recognized_early_ = false;
+  /// Indicates that the current gesture was handed over before it paused
+  bool gesture_handed_over_ = false;
 
-  /// The last time sensor 0 moved
-  time_point<system_clock> sensor_0_last_movement_time_ = system_clock::now();
-  /// The last time the movement of sensor 0 was grouped with sensor 1
-  time_point<system_clock> sensor_0_last_grouped_movement_time_ =
-      system_clock::now();
+  /// The time of the first movement of the current gesture
+  time_point<system_clock> gesture_start_time_ = system_clock::now();
 
-  /// The last time sensor 1 moved
-  time_point<system_clock> sensor_1_last_movement_time_ = system_clock::now();
-  /// The last time the movement of sensor 1 was grouped with sensor 0
-  time_point<system_clock> sensor_1_last_grouped_movement_time_ =
-      system_clock::now();
+  /// The last time there was any movement
+  time_point<system_clock> global_last_movement_time_ = system_clock::now();
 
-  /// The LaGeR symbol corresponding to the most recent sensor 0 movemennt
-  char last_sensor_0_letter_ = '_';
-  /// The LaGeR symbol corresponding to the most recent sensor 1 movement
-  char last_sensor_1_letter_ = '_';
+  /**
+   * Reserves the LaGeR strings built from the movement buffer, so that they
+   * are never reallocated while gestures are being drawn.
+   */
+  void ReserveLagerStrings() {
+    lager_update_string_.reserve(movements_.GetMaxStringLength());
+  }
 
   /**
-   * Registers and initializes the OSVR sensor handlers.
+   * Registers and initializes the OSVR sensor handlers, and sizes the sensor
+   * state and the movement buffer for the configured sensors.
    */
   void InitializeTrackers();
 
+  /**
+   * Frees the OSVR interfaces registered by InitializeTrackers(), so that no
+   * more callbacks reach this converter.
+   */
+  void FreeTrackers();
+
   /**
    * Main loop for processing sensor movement and button events.
    */
   void ProcessSensorEvents();
 
   /**
-   * Left side wrapper for callback that handles changes to the sensor positions.
+   * Hands over the current gesture if it was recognized early, and finishes
+   * it if it has paused. Called after every update of the OSVR context.
    */
-  static void HandleTrackerChangeLeft(void * /*userdata*/,
-                          const OSVR_TimeValue * time_value,
-                          const OSVR_PositionReport *cur_report);
+  void ServiceCurrentGesture();
+
+  /**
+   * Creates the timer used to detect gesture pauses. Falls back to checking
+   * the time after every update if it cannot be created.
+   */
+  void CreatePauseTimer();
+
+  /**
+   * Closes the gesture pause timer, if any.
+   */
+  void ClosePauseTimer();
+
+  /**
+   * Arms the gesture pause timer to expire once no movement has happened for
+   * the gesture pause time.
+   */
+  void ArmPauseTimer();
+
+  /**
+   * Waits for the gesture pause timer to expire, or until the OSVR context is
+   * due to be polled again, whichever comes first. Never blocks for longer
+   * than the poll interval, since OSVR has nothing else to wait on.
+   */
+  void WaitForSensorEvents();
 
   /**
-   * Right side wrapper for callback that handles changes to the sensor positions.
+   * Wrapper for callback that handles changes to the sensor positions. The
+   * user data points to the SensorCallbackData of the sensor.
    */
-  static void HandleTrackerChangeRight(void * /*userdata*/,
+  static void HandleTrackerChangeForSensor(void *user_data,
                           const OSVR_TimeValue * time_value,
                           const OSVR_PositionReport *cur_report);
 
   /**
    * Callback that handles changes to the sensor positions.
    */
-  static void HandleTrackerChange(const unsigned int sensor_index,
+  void HandleTrackerChange(const unsigned int sensor_index,
                           const OSVR_TimeValue * time_value,
                           const OSVR_PositionReport *cur_report);
 
@@ -274,53 +414,10 @@ class LagerConverter {
                         const OSVR_AnalogReport *cur_report);
 
   /**
-   * Takes the previous and current sensor data and returns the change in X
-   * axis position.
-   */
-  double GetDeltaX(const OSVR_PositionReport* last_report,
-                         const OSVR_PositionReport* cur_report);
-  /**
-   * Takes the previous and current sensor data and returns the change in Y
-   * axis position.
-   */
-  double GetDeltaY(const OSVR_PositionReport* last_report,
-                         const OSVR_PositionReport* cur_report);
-  /**
-   * Takes the previous and current sensor data and returns the change in Z
-   * axis position.
-   */
-  double GetDeltaZ(const OSVR_PositionReport* last_report,
-                         const OSVR_PositionReport* cur_report);
-
-  /**
-   * Takes the change in X, Y, and Z Cartesian coordinates and returns the
-   * equivalent theta change in spherical coordinates.
-   */
-  double GetMovementThetaInDegrees(double delta_x, double delta_y,
-                                   double delta_z);
-  /**
-   * Takes the change in X, Y, and Z Cartesian coordinates and returns the
-   * equivalent phi change in spherical coordinates.
-   */
-  double GetMovementPhiInDegrees(double delta_x, double delta_y,
-                                 double theta);
-
-  /**
-   * Takes an angle and returns that closest angle in 45 degree increments.
-   */
-  int SnapAngle(double aAngle);
-
-  /**
-   * Takes the previous and current sensor data and returns the sum of the
-   * square of each X, Y, and Z distance component in Cartesian coordinates.
+   * Takes a sensor index and its current sensor data and prints it along
+   * with its last position.
    */
-  double GetDistanceSquared(const OSVR_PositionReport* last_report,
-                                  const OSVR_PositionReport* cur_report);
-
-  /**
-   * Takes the previous and current sensor data and prints it.
-   */
-  void PrintSensorCoordinates(const OSVR_PositionReport* last_report,
+  void PrintSensorCoordinates(const unsigned int sensor_index,
                               const OSVR_PositionReport* cur_report);
 
   /**
@@ -344,62 +441,107 @@ class LagerConverter {
   time_point<system_clock> GetCurrentMovementTime(
         const OSVR_TimeValue* time_value);
 
+  /**
+   * Queues the current gesture for BlockingGetLagerString() without waiting
+   * for it to be read.
+   */
+  void HandOverLagerString();
+
   /**
    * Returns whether the current gesture has paused or not.
    */
   bool GesturePaused();
 
   /**
-   * Clears the global LaGeR gesture stringstream.
+   * Clears the movements of the current gesture.
    */
   void ResetLagerString();
 
   /**
-   * Takes the current and previous sensor data and calculates the position
-   * change in X, Y, and Z Cartesian coordinates.
+   * Takes a sensor index, the time of its current sensor data and the LaGeR
+   * letter of its movement, and updates the movements of the current gesture
+   * with it.
    */
-  void CalculateMovementDeltas(const OSVR_PositionReport* cur_report,
-                               const OSVR_PositionReport* last_report,
-                               double& delta_x, double& delta_y,
-                               double& delta_z);
+  void UpdateLagerString(const unsigned int sensor_index,
+                         const OSVR_TimeValue* time_value, const char letter);
+
   /**
-   * Takes the current and previous sensor data and calculates the movement
-   * angles in theta and phi spherical coordinates.
+   * Takes the time of the current sensor data and updates the global
+   * movement timers. Per-sensor times are kept by UpdateLagerString().
    */
-  void CalculateMovementAngles(double& theta, double& phi, int& snap_theta,
-                               int& snap_phi, double delta_x,
-                               double delta_y, double delta_z);
+  void UpdateTimers(const OSVR_TimeValue* time_value);
 
+};
+
+/**
+ * OSVR context shared by several converters, updated by a single thread.
+ *
+ * Converters created with a shared context register their sensors with it
+ * when started. Each update of the context runs the callbacks of every
+ * converter, then lets each of them finish its current gesture, all on the
+ * context's thread.
+ */
+class LagerSensorContext {
+ public:
   /**
-   * Moves the global LaGeR stringstream head back to the beginning of a
-   * letter pair.
+   * Takes the application name reported to OSVR and creates the context.
    */
-  void MoveHeadToBeginningOfLetterPair();
+  explicit LagerSensorContext(const char* app_name = "LagerConverter")
+      : context_(app_name) {
+  }
 
   /**
-   * Takes theta and phi spherical coordinates and returns the corresponding
-   * LaGeR symbol.
+   * Stops the update thread.
    */
-  char GetCurrentLetter(int snap_theta, int snap_phi);
+  ~LagerSensorContext() {
+    Stop();
+  }
+
+  LagerSensorContext(const LagerSensorContext&) = delete;
+  LagerSensorContext& operator=(const LagerSensorContext&) = delete;
 
   /**
-   * Takes the current sensor data and the theta and phi spherical coordinates
-   * corresponding to its movement, and update the global LaGeR string with
-   * the corresponding symbol.
+   * Starts the thread that updates the context and services the converters.
    */
-  void UpdateLagerString(const unsigned int sensor_index,
-                         const OSVR_PositionReport* cur_report,
-                         const OSVR_TimeValue* time_value, const int snap_theta,
-                         const int snap_phi);
+  void Start() {
+    update_thread_ = boost::thread(&LagerSensorContext::UpdateConverters, this);
+  }
 
   /**
-   * Takes the current sensor data structure and updates the global movement
-   * timers.
+   * Stops the update thread.
    */
-  void UpdateTimers(const unsigned int sensor_index,
-                    const OSVR_PositionReport* cur_report,
-                    const OSVR_TimeValue* time_value);
+  void Stop() {
+    update_thread_.interrupt();
+    update_thread_.join();
+  }
+
+ private:
+  friend class LagerConverter;
+
+  /**
+   * Takes a converter, registers its sensors with the context and starts
+   * servicing it.
+   */
+  void AddConverter(LagerConverter* lager_converter);
+
+  /**
+   * Takes a converter, frees its sensors and stops servicing it.
+   */
+  void RemoveConverter(LagerConverter* lager_converter);
+
+  /**
+   * Main loop of the update thread.
+   */
+  void UpdateConverters();
 
+  /// OSVR context
+  osvr::clientkit::ClientContext context_;
+  /// Protects the context and converters_ while converters come and go
+  std::mutex mutex_;
+  /// Converters serviced by the update thread
+  vector<LagerConverter*> converters_;
+  /// Thread that updates the context
+  boost::thread update_thread_;
 };
 
 #endif /* LIBLAGER_CONVERT_H_ */
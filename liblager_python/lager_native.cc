@@ -0,0 +1,467 @@
+/*
+ * lager_native.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdint.h>
+#include <string>
+using std::string;
+#include <thread>
+using std::thread;
+#include <vector>
+using std::vector;
+
+#include "lager_distance.h"
+#include "lager_ranking.h"
+#include "lager_run_length.h"
+
+/*
+ * CPython extension exposing the native LaGeR distance engines to the machine
+ * learning scripts. Distance matrices and nearest template searches are
+ * computed on several threads with the GIL released. Matrices are returned as
+ * NumPy arrays when NumPy is installed, and as shaped memoryviews otherwise,
+ * so the module does not need NumPy to build.
+ */
+
+/// Engines, matching lager_engine in lager_recognizer_api.h
+#define LAGER_NATIVE_DAMERAU_LEVENSHTEIN 0
+#define LAGER_NATIVE_RUN_LENGTH 1
+
+/*
+ * Takes a Python sequence of LaGeR strings, such as a list or a NumPy array
+ * of strings, and stores them in lagers. Returns false with a Python
+ * exception set if it is not a non-empty sequence of non-empty strings.
+ */
+static bool ParseLagerSequence(PyObject* sequence, vector<string>& lagers) {
+  PyObject* fast = PySequence_Fast(sequence, "expected a sequence of LaGeR "
+                                   "strings");
+  if (fast == NULL) {
+    return false;
+  }
+
+  Py_ssize_t size = PySequence_Fast_GET_SIZE(fast);
+  if (size == 0) {
+    Py_DECREF(fast);
+    PyErr_SetString(PyExc_ValueError, "expected at least one LaGeR string");
+    return false;
+  }
+
+  lagers.resize(size);
+  for (Py_ssize_t i = 0; i < size; i++) {
+    Py_ssize_t length;
+    const char* lager = PyUnicode_AsUTF8AndSize(
+        PySequence_Fast_GET_ITEM(fast, i), &length);
+    if (lager == NULL) {
+      Py_DECREF(fast);
+      return false;
+    }
+    if (length == 0) {
+      Py_DECREF(fast);
+      PyErr_SetString(PyExc_ValueError, "LaGeR strings must not be empty");
+      return false;
+    }
+    lagers[i].assign(lager, length);
+  }
+
+  Py_DECREF(fast);
+  return true;
+}
+
+/*
+ * Takes an engine number and returns whether it is valid, setting a Python
+ * exception if not.
+ */
+static bool CheckEngine(int engine) {
+  if (engine != LAGER_NATIVE_DAMERAU_LEVENSHTEIN
+      && engine != LAGER_NATIVE_RUN_LENGTH) {
+    PyErr_SetString(PyExc_ValueError, "unknown distance engine");
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Takes a number of threads requested by the caller, 0 for one per core, and
+ * a number of rows, and returns the number of threads to split the rows
+ * across.
+ */
+static unsigned int GetNumThreads(unsigned int num_threads, size_t num_rows) {
+  if (num_threads == 0) {
+    num_threads = thread::hardware_concurrency();
+  }
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  if (num_threads > num_rows) {
+    num_threads = (num_rows > 0) ? num_rows : 1;
+  }
+  return num_threads;
+}
+
+/*
+ * Takes a number of rows and columns and a buffer format, "f" for float32 or
+ * "i" for int32, and returns a new C-contiguous matrix. The matrix is a NumPy
+ * array if NumPy can be imported, and a memoryview over a bytearray
+ * otherwise. Its buffer is stored in view, which the caller must release.
+ */
+static PyObject* NewMatrix(Py_ssize_t rows, Py_ssize_t cols,
+                           const char* format, Py_buffer* view) {
+  PyObject* matrix = NULL;
+
+  PyObject* numpy = PyImport_ImportModule("numpy");
+  if (numpy != NULL) {
+    const char* dtype = (format[0] == 'f') ? "float32" : "int32";
+    matrix = PyObject_CallMethod(numpy, "empty", "((nn)s)", rows, cols,
+                                 dtype);
+    Py_DECREF(numpy);
+  } else {
+    PyErr_Clear();
+
+    PyObject* bytes = PyByteArray_FromStringAndSize(NULL, rows * cols * 4);
+    if (bytes == NULL) {
+      return NULL;
+    }
+    PyObject* flat = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);
+    if (flat == NULL) {
+      return NULL;
+    }
+    matrix = PyObject_CallMethod(flat, "cast", "s(nn)", format, rows, cols);
+    Py_DECREF(flat);
+  }
+
+  if (matrix == NULL) {
+    return NULL;
+  }
+
+  if (PyObject_GetBuffer(matrix, view, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE)
+      != 0) {
+    Py_DECREF(matrix);
+    return NULL;
+  }
+
+  return matrix;
+}
+
+/*
+ * Takes an object passed as the out argument and the expected matrix shape,
+ * and stores its buffer in view. Returns false with a Python exception set if
+ * it is not a writable C-contiguous float32 matrix of that shape.
+ */
+static bool GetOutputMatrix(PyObject* out, Py_ssize_t rows, Py_ssize_t cols,
+                            Py_buffer* view) {
+  if (PyObject_GetBuffer(out, view, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE
+                         | PyBUF_FORMAT | PyBUF_ND) != 0) {
+    return false;
+  }
+
+  if (view->ndim != 2 || view->shape[0] != rows || view->shape[1] != cols
+      || view->itemsize != 4 || string(view->format) != "f") {
+    PyBuffer_Release(view);
+    PyErr_Format(PyExc_ValueError, "out must be a float32 matrix of shape "
+                 "(%zd, %zd)", rows, cols);
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Takes the inputs and templates, the engine, the first row and the row step,
+ * and fills every step-th row of the distance matrix with the distance
+ * percentages between that input and each template.
+ */
+static void ComputeMatrixRows(const vector<string>* inputs,
+                              const vector<LagerTemplate>* templates,
+                              int engine, size_t first_row, size_t row_step,
+                              float* matrix) {
+  RunLengthLager run_length_input;
+  size_t num_templates = templates->size();
+
+  for (size_t i = first_row; i < inputs->size(); i += row_step) {
+    if (engine == LAGER_NATIVE_RUN_LENGTH) {
+      EncodeRunLengthLager((*inputs)[i], run_length_input);
+    }
+
+    for (size_t j = 0; j < num_templates; j++) {
+      float distance_pct;
+      if (engine == LAGER_NATIVE_RUN_LENGTH) {
+        RunLengthLagerDistance(run_length_input, (*templates)[j].run_length,
+                               distance_pct);
+      } else {
+        LagerDistance((*inputs)[i], (*templates)[j].lager, distance_pct);
+      }
+      matrix[i * num_templates + j] = distance_pct;
+    }
+  }
+}
+
+/*
+ * Takes the inputs and templates, the engine, the number of neighbors, the
+ * first row and the row step, and fills every step-th row of the index and
+ * distance matrices with the closest templates to that input.
+ */
+static void FindNearestRows(const vector<string>* inputs,
+                            const vector<LagerTemplate>* templates,
+                            int engine, size_t k, size_t first_row,
+                            size_t row_step, int32_t* indices,
+                            float* distances) {
+  vector<LagerTemplateScore> closest;
+
+  for (size_t i = first_row; i < inputs->size(); i += row_step) {
+    RankLagerTemplates(*templates, (*inputs)[i],
+                       engine == LAGER_NATIVE_RUN_LENGTH, k, false,
+                       [](const LagerTemplate&) { return true; }, closest);
+
+    for (size_t j = 0; j < k; j++) {
+      indices[i * k + j] = closest[j].gesture_index;
+      distances[i * k + j] = closest[j].distance_pct;
+    }
+  }
+}
+
+/*
+ * Takes a list of LaGeR strings and fills templates with their prepared
+ * representations.
+ */
+static void PrepareTemplates(const vector<string>& lagers,
+                             vector<LagerTemplate>& templates) {
+  templates.resize(lagers.size());
+  for (size_t i = 0; i < lagers.size(); i++) {
+    PrepareLagerTemplate(lagers[i], templates[i]);
+  }
+}
+
+static PyObject* LagerNativeDistance(PyObject* /* self */, PyObject* args,
+                                     PyObject* kwargs) {
+  static const char* keywords[] = {"input", "gesture", "engine", NULL};
+  const char* input;
+  const char* gesture;
+  int engine = LAGER_NATIVE_DAMERAU_LEVENSHTEIN;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|i",
+                                   const_cast<char**>(keywords), &input,
+                                   &gesture, &engine)
+      || !CheckEngine(engine)) {
+    return NULL;
+  }
+
+  if (input[0] == '\0' || gesture[0] == '\0') {
+    PyErr_SetString(PyExc_ValueError, "LaGeR strings must not be empty");
+    return NULL;
+  }
+
+  string input_lager(input);
+  string gesture_lager(gesture);
+  int distance;
+  float distance_pct;
+
+  Py_BEGIN_ALLOW_THREADS
+  if (engine == LAGER_NATIVE_RUN_LENGTH) {
+    RunLengthLager run_length_input, run_length_gesture;
+    EncodeRunLengthLager(input_lager, run_length_input);
+    EncodeRunLengthLager(gesture_lager, run_length_gesture);
+    distance = RunLengthLagerDistance(run_length_input, run_length_gesture,
+                                      distance_pct);
+  } else {
+    distance = LagerDistance(input_lager, gesture_lager, distance_pct);
+  }
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("(if)", distance, distance_pct);
+}
+
+static PyObject* LagerNativeThresholdPct(PyObject* /* self */, PyObject* args) {
+  const char* lager;
+
+  if (!PyArg_ParseTuple(args, "s", &lager)) {
+    return NULL;
+  }
+
+  return PyLong_FromLong(GetLagerDistanceThresholdPct(lager));
+}
+
+static PyObject* LagerNativeDistanceMatrix(PyObject* /* self */, PyObject* args,
+                                           PyObject* kwargs) {
+  static const char* keywords[] = {"inputs", "templates", "engine",
+                                   "threads", "out", NULL};
+  PyObject* input_sequence;
+  PyObject* template_sequence = Py_None;
+  int engine = LAGER_NATIVE_DAMERAU_LEVENSHTEIN;
+  unsigned int num_threads = 0;
+  PyObject* out = Py_None;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OiIO",
+                                   const_cast<char**>(keywords),
+                                   &input_sequence, &template_sequence,
+                                   &engine, &num_threads, &out)
+      || !CheckEngine(engine)) {
+    return NULL;
+  }
+
+  vector<string> inputs, template_lagers;
+  if (!ParseLagerSequence(input_sequence, inputs)) {
+    return NULL;
+  }
+  // Without templates, the inputs are compared with each other
+  if (template_sequence == Py_None) {
+    template_lagers = inputs;
+  } else if (!ParseLagerSequence(template_sequence, template_lagers)) {
+    return NULL;
+  }
+
+  Py_buffer view;
+  PyObject* matrix;
+  if (out == Py_None) {
+    matrix = NewMatrix(inputs.size(), template_lagers.size(), "f", &view);
+    if (matrix == NULL) {
+      return NULL;
+    }
+  } else {
+    if (!GetOutputMatrix(out, inputs.size(), template_lagers.size(), &view)) {
+      return NULL;
+    }
+    matrix = out;
+    Py_INCREF(matrix);
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  vector<LagerTemplate> templates;
+  PrepareTemplates(template_lagers, templates);
+
+  num_threads = GetNumThreads(num_threads, inputs.size());
+  vector<thread> threads;
+  for (unsigned int i = 0; i < num_threads; i++) {
+    threads.push_back(thread(ComputeMatrixRows, &inputs, &templates, engine,
+                             i, num_threads,
+                             static_cast<float*>(view.buf)));
+  }
+  for (vector<thread>::iterator it = threads.begin(); it < threads.end();
+      ++it) {
+    it->join();
+  }
+  Py_END_ALLOW_THREADS
+
+  PyBuffer_Release(&view);
+  return matrix;
+}
+
+static PyObject* LagerNativeNearestTemplates(PyObject* /* self */,
+                                             PyObject* args,
+                                             PyObject* kwargs) {
+  static const char* keywords[] = {"inputs", "templates", "k", "engine",
+                                   "threads", NULL};
+  PyObject* input_sequence;
+  PyObject* template_sequence;
+  unsigned int k = 1;
+  int engine = LAGER_NATIVE_DAMERAU_LEVENSHTEIN;
+  unsigned int num_threads = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|IiI",
+                                   const_cast<char**>(keywords),
+                                   &input_sequence, &template_sequence, &k,
+                                   &engine, &num_threads)
+      || !CheckEngine(engine)) {
+    return NULL;
+  }
+
+  vector<string> inputs, template_lagers;
+  if (!ParseLagerSequence(input_sequence, inputs)
+      || !ParseLagerSequence(template_sequence, template_lagers)) {
+    return NULL;
+  }
+  if (k > template_lagers.size()) {
+    k = template_lagers.size();
+  }
+
+  Py_buffer index_view, distance_view;
+  PyObject* indices = NewMatrix(inputs.size(), k, "i", &index_view);
+  if (indices == NULL) {
+    return NULL;
+  }
+  PyObject* distances = NewMatrix(inputs.size(), k, "f", &distance_view);
+  if (distances == NULL) {
+    PyBuffer_Release(&index_view);
+    Py_DECREF(indices);
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  vector<LagerTemplate> templates;
+  PrepareTemplates(template_lagers, templates);
+
+  num_threads = GetNumThreads(num_threads, inputs.size());
+  vector<thread> threads;
+  for (unsigned int i = 0; i < num_threads; i++) {
+    threads.push_back(thread(FindNearestRows, &inputs, &templates, engine,
+                             k, i, num_threads,
+                             static_cast<int32_t*>(index_view.buf),
+                             static_cast<float*>(distance_view.buf)));
+  }
+  for (vector<thread>::iterator it = threads.begin(); it < threads.end();
+      ++it) {
+    it->join();
+  }
+  Py_END_ALLOW_THREADS
+
+  PyBuffer_Release(&index_view);
+  PyBuffer_Release(&distance_view);
+  return Py_BuildValue("(NN)", indices, distances);
+}
+
+// Functions that take keywords are cast through void (*)(void), which any
+// function pointer converts to, as the Python documentation suggests
+static PyMethodDef lager_native_methods[] = {
+  {"distance", (PyCFunction) (void (*)(void)) LagerNativeDistance,
+   METH_VARARGS | METH_KEYWORDS,
+   "distance(input, gesture, engine=DAMERAU_LEVENSHTEIN)\n\n"
+   "Returns the (distance, distance_pct) between two LaGeR strings."},
+  {"threshold_pct", LagerNativeThresholdPct, METH_VARARGS,
+   "threshold_pct(lager)\n\n"
+   "Returns the distance percentage under which the LaGeR string is "
+   "recognized."},
+  {"distance_matrix", (PyCFunction) (void (*)(void)) LagerNativeDistanceMatrix,
+   METH_VARARGS | METH_KEYWORDS,
+   "distance_matrix(inputs, templates=None, engine=DAMERAU_LEVENSHTEIN, "
+   "threads=0, out=None)\n\n"
+   "Returns a float32 matrix with the distance percentage between each input "
+   "and each template, or between each pair of inputs if templates is None. "
+   "The result is written to out if given."},
+  {"nearest_templates",
+   (PyCFunction) (void (*)(void)) LagerNativeNearestTemplates,
+   METH_VARARGS | METH_KEYWORDS,
+   "nearest_templates(inputs, templates, k=1, engine=DAMERAU_LEVENSHTEIN, "
+   "threads=0)\n\n"
+   "Returns int32 indices and float32 distance percentages of the k closest "
+   "templates to each input, sorted from closest to farthest."},
+  {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef lager_native_module = {
+  PyModuleDef_HEAD_INIT,
+  "lager_native",
+  "Native LaGeR distance engines.",
+  -1,
+  lager_native_methods,
+  NULL,  // m_slots
+  NULL,  // m_traverse
+  NULL,  // m_clear
+  NULL   // m_free
+};
+
+PyMODINIT_FUNC PyInit_lager_native(void) {
+  PyObject* module = PyModule_Create(&lager_native_module);
+  if (module == NULL) {
+    return NULL;
+  }
+
+  PyModule_AddIntConstant(module, "DAMERAU_LEVENSHTEIN",
+                          LAGER_NATIVE_DAMERAU_LEVENSHTEIN);
+  PyModule_AddIntConstant(module, "RUN_LENGTH", LAGER_NATIVE_RUN_LENGTH);
+
+  return module;
+}
@@ -0,0 +1,195 @@
+/*
+ * lager_distance.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <stdlib.h>   // for abs
+#include <boost/math/common_factor.hpp>
+#include <vector>
+using std::vector;
+
+#include "lager_distance.h"
+#include "string_tokenizer.h"
+
+#define d(i,j) dd[(i) * (m+2) + (j) ]
+#define min(x,y) ((x) < (y) ? (x) : (y))
+#define min3(a,b,c) ((a)< (b) ? min((a),(c)) : min((b),(c)))
+#define min4(a,b,c,d) ((a)< (b) ? min3((a),(c),(d)) : min3((b),(c),(d)))
+
+/* Calculates the Damerau-Levenshtein distance between two strings.
+ * Based on implementation at: http://stackoverflow.com/a/10741694
+ */
+int DLDistance(const char *s, const char* t, int n, int m) {
+  // Reused between calls so that steady state recognition does not allocate
+  static thread_local vector<int> dd_buffer;
+  static thread_local vector<int> DA_buffer(256);
+  int *dd, *DA;
+  int i, j, cost, k, i1, j1, DB;
+  int infinity = n + m;
+
+  if (dd_buffer.size() < (size_t) ((n + 2) * (m + 2))) {
+    dd_buffer.resize((n + 2) * (m + 2));
+  }
+  DA = DA_buffer.data();
+  dd = dd_buffer.data();
+
+  d(0,0)= infinity;
+  for (i = 0; i < n + 1; i++) {
+    d(i+1,1)= i;
+    d(i+1,0) = infinity;
+  }
+  for (j = 0; j < m + 1; j++) {
+    d(1,j+1)= j;
+    d(0,j+1) = infinity;
+  }
+  for (k = 0; k < 256; k++)
+    DA[k] = 0;
+  for (i = 1; i < n + 1; i++) {
+    DB = 0;
+    for (j = 1; j < m + 1; j++) {
+      i1 = DA[t[j - 1]];
+      j1 = DB;
+      cost = ((s[i - 1] == t[j - 1]) ? 0 : 1);
+      if (cost == 0)
+        DB = j;
+      d(i+1,j+1)=
+      min4(d(i,j)+cost,
+          d(i+1,j) + 1,
+          d(i,j+1)+1,
+          d(i1,j1) + (i-i1-1) + 1 + (j-j1-1));
+    }
+    DA[s[i - 1]] = i;
+  }
+  cost = d(n + 1, m + 1);
+  return cost;
+}
+
+/* New size must be a multiple of the original string size.
+ * The output string is cleared and reused, so its capacity carries over.
+ */
+void ExpandString(const string& input_string, int new_size,
+                  string& output_string) {
+  int length_multiplier = new_size / input_string.length();
+  size_t movement_start = 0;
+
+  output_string.clear();
+
+  while (movement_start < input_string.length()) {
+    size_t movement_end = input_string.find('.', movement_start);
+    if (movement_end == string::npos) {
+      movement_end = input_string.length();
+    }
+
+    if (movement_end > movement_start) {
+      for (int i = 0; i < length_multiplier; i++) {
+        output_string.append(input_string, movement_start,
+                             movement_end - movement_start);
+        output_string.push_back('.');
+      }
+    }
+
+    movement_start = movement_end + 1;
+  }
+}
+
+int LagerDistance(const string& input_lager, const string& gesture_lager,
+                  float& distance_pct) {
+  static thread_local string expanded_input_lager;
+  static thread_local string expanded_gesture_lager;
+
+  int gesture_length_least_common_multiple = boost::math::lcm(
+      input_lager.length(), gesture_lager.length());
+
+  ExpandString(input_lager, gesture_length_least_common_multiple,
+               expanded_input_lager);
+  ExpandString(gesture_lager, gesture_length_least_common_multiple,
+               expanded_gesture_lager);
+
+  int distance = DLDistance(expanded_input_lager.c_str(),
+                            expanded_gesture_lager.c_str(),
+                            expanded_input_lager.length(),
+                            expanded_gesture_lager.length());
+
+  distance_pct = (distance * 100.0f) / expanded_gesture_lager.length();
+
+  return distance;
+}
+
+/*
+ * Returns the histogram bin that corresponds to a LaGeR character.
+ */
+int GetHistogramBin(char lager_character) {
+  if (lager_character >= 'a' && lager_character <= 'z') {
+    return lager_character - 'a';
+  } else if (lager_character == '_') {
+    return 26;
+  } else if (lager_character == '.') {
+    return 27;
+  }
+  return 28;
+}
+
+void ComputeLagerHistogram(const string& lager,
+                           struct LagerHistogram& histogram) {
+  for (int i = 0; i < LAGER_HISTOGRAM_BINS; i++) {
+    histogram.counts[i] = 0;
+  }
+  for (size_t i = 0; i < lager.length(); i++) {
+    histogram.counts[GetHistogramBin(lager[i])]++;
+  }
+  histogram.length = lager.length();
+}
+
+/*
+ * Every edit operation changes the L1 distance between the histograms of the
+ * expanded strings by at most twice its cost, so half of that distance can
+ * never exceed the edit distance itself.
+ */
+float GetHistogramLowerBoundPct(const struct LagerHistogram& input_histogram,
+                                const struct LagerHistogram& gesture_histogram) {
+  if (input_histogram.length == 0 || gesture_histogram.length == 0) {
+    return 0;
+  }
+
+  int least_common_multiple = boost::math::lcm(input_histogram.length,
+                                               gesture_histogram.length);
+  int input_factor = least_common_multiple / input_histogram.length;
+  int gesture_factor = least_common_multiple / gesture_histogram.length;
+  int histogram_distance = 0;
+
+  for (int i = 0; i < LAGER_HISTOGRAM_BINS; i++) {
+    histogram_distance += abs(
+        (int) (input_histogram.counts[i] * input_factor)
+            - (int) (gesture_histogram.counts[i] * gesture_factor));
+  }
+
+  return (((histogram_distance + 1) / 2) * 100.0f) / least_common_multiple;
+}
+
+bool IsSingleSensorLager(const string& lager) {
+  vector<string> movement_pairs;
+  TokenizeString(lager, movement_pairs, ".");
+  bool sensor_0_moved = false;
+  bool sensor_1_moved = false;
+
+  for (vector<string>::iterator it = movement_pairs.begin();
+      it < movement_pairs.end(); ++it) {
+    // Check if sensor 0 movement is present
+    if ((*it).c_str()[0] != '_') {
+      sensor_0_moved = true;
+    }
+
+    // Check if sensor 0 movement is present
+    if ((*it).c_str()[0] != '_') {
+      sensor_1_moved = true;
+    }
+
+    // If we already found movement on both sensors, there is no need to keep checking
+    if (sensor_0_moved && sensor_1_moved) {
+      break;
+    }
+  }
+
+  return (!sensor_0_moved || !sensor_1_moved);
+}
@@ -0,0 +1,90 @@
+/*
+ * lager_distance.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_DISTANCE_H_
+#define LAGER_DISTANCE_H_
+
+#include <string>
+using std::string;
+
+/*
+ * Damerau-Levenshtein distance between LaGeR strings, and cheap lower bounds
+ * on it. These functions do not depend on OSVR, Python or the subscription
+ * queues, so they are also built into liblager_distance for offline tools.
+ */
+
+#define SINGLE_SENSOR_GESTURE_DISTANCE_THRESHOLD_PCT 25
+#define DUAL_SENSOR_GESTURE_DISTANCE_THRESHOLD_PCT 35
+
+/// Histogram bins: one per letter, plus '_', '.' and anything else
+#define LAGER_HISTOGRAM_BINS 29
+
+/**
+ * Character histogram of a LaGeR string, used to compute a cheap lower bound
+ * on its distance to other gestures.
+ */
+struct LagerHistogram {
+  /// Number of occurrences of each character class
+  unsigned int counts[LAGER_HISTOGRAM_BINS];
+  /// Length of the LaGeR string
+  unsigned int length;
+};
+
+/**
+ * Takes two strings and their lengths, and returns the Damerau-Levenshtein
+ * distance between them.
+ */
+int DLDistance(const char *s, const char* t, int n, int m);
+
+/**
+ * Takes a LaGeR string and a new size, which must be a multiple of its length,
+ * and stores in output_string the string with each movement repeated to fill
+ * that size. The output string is cleared and reused, so its capacity carries
+ * over.
+ */
+void ExpandString(const string& input_string, int new_size,
+                  string& output_string);
+
+/**
+ * Takes an input and a gesture LaGeR string, expands both to the least common
+ * multiple of their lengths and returns the Damerau-Levenshtein distance
+ * between them. The distance as a percentage of the expanded gesture length
+ * is stored in distance_pct.
+ */
+int LagerDistance(const string& input_lager, const string& gesture_lager,
+                  float& distance_pct);
+
+/**
+ * Takes a LaGeR gesture string and returns whether or not it corresponds to
+ * the movement of a single sensor.
+ */
+bool IsSingleSensorLager(const string& lager);
+
+/**
+ * Takes a LaGeR gesture string and returns the distance threshold it is
+ * recognized with, which depends on how many sensors moved.
+ */
+inline int GetLagerDistanceThresholdPct(const string& lager) {
+  return IsSingleSensorLager(lager) ?
+      SINGLE_SENSOR_GESTURE_DISTANCE_THRESHOLD_PCT :
+      DUAL_SENSOR_GESTURE_DISTANCE_THRESHOLD_PCT;
+}
+
+/**
+ * Takes a LaGeR string and counts the occurrences of each character class.
+ */
+void ComputeLagerHistogram(const string& lager,
+                           struct LagerHistogram& histogram);
+
+/**
+ * Takes the histograms of two LaGeR strings and returns a lower bound on the
+ * distance percentage between them once both are expanded to the least common
+ * multiple of their lengths.
+ */
+float GetHistogramLowerBoundPct(const struct LagerHistogram& input_histogram,
+                                const struct LagerHistogram& gesture_histogram);
+
+#endif /* LAGER_DISTANCE_H_ */
@@ -0,0 +1,220 @@
+/*
+ * lager_early_commit.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>  // for std::find, std::max, std::min
+using std::find;
+using std::max;
+using std::min;
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <iomanip>
+using std::setprecision;
+using std::fixed;
+
+#include "lager_early_commit.h"
+
+bool EarlyCommitTracker::Update(const string& partial_lager) {
+  EncodeRunLengthLager(partial_lager, input_);
+
+  // Keep the rows for the runs that did not change and recompute the rest
+  size_t num_common_runs = 0;
+  while (num_common_runs < input_symbols_.size()
+      && num_common_runs < input_.runs.size()
+      && input_symbols_[num_common_runs]
+          == input_.runs[num_common_runs].symbol) {
+    num_common_runs++;
+  }
+
+  input_symbols_.resize(num_common_runs);
+  for (vector<EarlyCommitTemplate>::iterator it = templates_.begin();
+      it < templates_.end(); ++it) {
+    it->rows.resize((num_common_runs + 1) * (it->runs.size() + 1));
+  }
+
+  for (size_t i = num_common_runs; i < input_.runs.size(); i++) {
+    input_symbols_.push_back(input_.runs[i].symbol);
+    for (vector<EarlyCommitTemplate>::iterator it = templates_.begin();
+        it < templates_.end(); ++it) {
+      PushInputRun(*it, input_.runs[i].symbol, i + 1);
+    }
+  }
+
+  SynchronizeTemplates();
+
+  return DecideCommit(partial_lager);
+}
+
+bool EarlyCommitTracker::TakeCommittedGesture(const string& lager,
+                                              size_t& gesture_index) {
+  std::lock_guard<std::mutex> lock(commit_mutex_);
+
+  if (!commit_pending_ || lager != committed_lager_) {
+    return false;
+  }
+
+  commit_pending_ = false;
+  gesture_index = last_decision_.gesture_index;
+
+  // The contexts may have changed since the commit was made
+  return gesture_index < subscribed_gestures_->size()
+      && IsGestureActive(gesture_index);
+}
+
+void EarlyCommitTracker::Reset() {
+  templates_.clear();
+  input_symbols_.clear();
+
+  std::lock_guard<std::mutex> lock(commit_mutex_);
+  commit_pending_ = false;
+}
+
+void EarlyCommitTracker::SynchronizeTemplates() {
+  for (size_t i = templates_.size(); i < subscribed_gestures_->size(); i++) {
+    EarlyCommitTemplate new_template;
+    EncodeRunLengthLager((*subscribed_gestures_)[i].lager, encoded_template_);
+    new_template.runs = encoded_template_.runs;
+
+    // Row 0: transforming an empty input into each prefix of the gesture
+    size_t row_size = new_template.runs.size() + 1;
+    new_template.rows.resize(row_size);
+    for (size_t k = 0; k < row_size; k++) {
+      new_template.rows[k] = k;
+    }
+
+    for (size_t j = 0; j < input_symbols_.size(); j++) {
+      PushInputRun(new_template, input_symbols_[j], j + 1);
+    }
+
+    templates_.push_back(new_template);
+  }
+}
+
+void EarlyCommitTracker::PushInputRun(EarlyCommitTemplate& gesture_template,
+                                      LagerSymbol symbol, size_t input_run) {
+  size_t row_size = gesture_template.runs.size() + 1;
+
+  gesture_template.rows.resize((input_run + 1) * row_size);
+  const int* previous_row = &gesture_template.rows[(input_run - 1) * row_size];
+  int* current_row = &gesture_template.rows[input_run * row_size];
+
+  current_row[0] = previous_row[0] + 1;
+  for (size_t k = 1; k < row_size; k++) {
+    int substitution_cost = (symbol == gesture_template.runs[k - 1].symbol) ?
+        0 : 1;
+    current_row[k] = min(min(previous_row[k], current_row[k - 1]) + 1,
+                         previous_row[k - 1] + substitution_cost);
+  }
+}
+
+void EarlyCommitTracker::GetDistanceBounds(
+    const EarlyCommitTemplate& gesture_template, float& lower_bound_pct,
+    float& upper_bound_pct) {
+  size_t row_size = gesture_template.runs.size() + 1;
+  const int* current_row = &gesture_template.rows[input_symbols_.size()
+      * row_size];
+
+  // Any continuation of the input has to align with some gesture prefix
+  int lower_bound = current_row[0];
+  for (size_t k = 1; k < row_size; k++) {
+    lower_bound = min(lower_bound, current_row[k]);
+  }
+
+  float num_gesture_runs = max((size_t) 1, row_size - 1);
+  lower_bound_pct = (lower_bound * 100.0f) / num_gesture_runs;
+  upper_bound_pct = (current_row[row_size - 1] * 100.0f) / num_gesture_runs;
+}
+
+bool EarlyCommitTracker::IsGestureActive(size_t gesture_index) {
+  const vector<GestureSubscriber>& subscribers =
+      (*subscribed_gestures_)[gesture_index].subscribers;
+
+  // Gestures read from a file have no subscribers and are always active
+  if (subscribers.empty()) {
+    return true;
+  }
+
+  for (vector<GestureSubscriber>::const_iterator it = subscribers.begin();
+      it < subscribers.end(); ++it) {
+    if (it->context.empty()
+        || find(active_contexts_.begin(), active_contexts_.end(), it->context)
+            != active_contexts_.end()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool EarlyCommitTracker::DecideCommit(const string& partial_lager) {
+  if (input_.num_movements < EARLY_COMMIT_MIN_MOVEMENTS) {
+    return false;
+  }
+
+  bool possible_match_found = false;
+  EarlyCommitDecision decision = EarlyCommitDecision();
+
+  // Exemplars of the committed name are not rivals: the closest one is kept
+  for (size_t i = 0; i < templates_.size(); i++) {
+    float lower_bound_pct, upper_bound_pct;
+    GetDistanceBounds(templates_[i], lower_bound_pct, upper_bound_pct);
+
+    if (lower_bound_pct > distance_threshold_pct_ || !IsGestureActive(i)) {
+      continue;
+    }
+
+    if (!possible_match_found) {
+      possible_match_found = true;
+    } else if ((*subscribed_gestures_)[i].name
+        != (*subscribed_gestures_)[decision.gesture_index].name) {
+      return false;
+    } else if (upper_bound_pct >= decision.upper_bound_pct) {
+      continue;
+    }
+
+    decision.gesture_index = i;
+    decision.lower_bound_pct = lower_bound_pct;
+    decision.upper_bound_pct = upper_bound_pct;
+  }
+
+  if (!possible_match_found
+      || decision.upper_bound_pct > distance_threshold_pct_) {
+    return false;
+  }
+
+  // Run bounds ignore how long each movement is held, which the recognition
+  // engine does not, and the partial gesture is all that will be handed over
+  const string& gesture_lager =
+      (*subscribed_gestures_)[decision.gesture_index].lager;
+  if (use_run_length_distance_) {
+    EncodeRunLengthLager(gesture_lager, encoded_template_);
+    RunLengthLagerDistance(input_, encoded_template_, decision.distance_pct);
+  } else {
+    LagerDistance(partial_lager, gesture_lager, decision.distance_pct);
+  }
+  if (decision.distance_pct > GetLagerDistanceThresholdPct(partial_lager)) {
+    return false;
+  }
+
+  decision.prefix_movements = input_.num_movements;
+
+  {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    last_decision_ = decision;
+    committed_lager_ = partial_lager;
+    commit_pending_ = true;
+  }
+
+  cout << "Early commit: "
+       << (*subscribed_gestures_)[decision.gesture_index].name << " after "
+       << decision.prefix_movements << " movements ("
+       << setprecision(2) << fixed << decision.upper_bound_pct << " % of runs, "
+       << decision.distance_pct
+       << " % distance now, no other gesture name can get under "
+       << distance_threshold_pct_ << " %)" << endl;
+
+  return true;
+}
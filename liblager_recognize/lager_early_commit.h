@@ -0,0 +1,203 @@
+/*
+ * lager_early_commit.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_EARLY_COMMIT_H_
+#define LAGER_EARLY_COMMIT_H_
+
+#include <mutex>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "liblager_connect.h"
+#include "lager_distance.h"
+#include "lager_run_length.h"
+
+/// Distance threshold for committing to a gesture before it has finished,
+/// as a percentage of the runs in the subscribed gesture. It is stricter than
+/// the recognition thresholds since an early commit cannot be taken back.
+#define EARLY_COMMIT_DISTANCE_THRESHOLD_PCT 15
+/// Minimum number of movements in a partial gesture before committing
+#define EARLY_COMMIT_MIN_MOVEMENTS 2
+
+/**
+ * Describes the decision to commit to a gesture before it has finished.
+ */
+struct EarlyCommitDecision {
+  /// Index of the committed gesture in the subscribed gestures vector
+  size_t gesture_index;
+  /// Number of movements in the partial gesture when the decision was made
+  unsigned int prefix_movements;
+  /// Lowest distance the finished gesture can still reach
+  float lower_bound_pct;
+  /// Distance of the partial gesture if it stopped at this point
+  float upper_bound_pct;
+  /// Distance of the partial gesture under the recognition distance engine
+  float distance_pct;
+};
+
+/**
+ * Incremental distance state between the partial input gesture and a
+ * subscribed gesture.
+ */
+struct EarlyCommitTemplate {
+  /// Runs of the subscribed gesture
+  vector<LagerRun> runs;
+  /// One dynamic programming row per input run prefix, stored back to back
+  vector<int> rows;
+};
+
+/**
+ * Follows a gesture while it is being drawn and decides whether it can only
+ * end up matching a single subscribed gesture.
+ *
+ * Partial gestures are compared run by run, with unit edit costs, so a
+ * movement that is held for a longer or shorter time than in the subscribed
+ * gesture does not change the distance, which is expressed as a percentage of
+ * the number of runs in the subscribed gesture. For every subscribed gesture
+ * the tracker keeps one row of the edit distance table per input run. The
+ * minimum of the latest row is a lower bound on the distance of any
+ * continuation of the input, and its last cell is the distance if the input
+ * stopped right now. The tracker commits when the gestures that can still
+ * fall under the threshold all share one name, and the partial input is
+ * already under the threshold for the closest of them. Several exemplars of
+ * the same gesture therefore do not keep each other from committing.
+ *
+ * The committed LaGeR string is handed over in place of the finished gesture,
+ * so a commit is only made once the recognition distance engine also puts the
+ * partial gesture under the recognition threshold for that gesture. Until
+ * then the gesture keeps being drawn and is recognized once it finishes.
+ */
+class EarlyCommitTracker {
+ public:
+  /**
+   * Takes a pointer to the vector of subscribed gestures to compare against.
+   * New gestures can be appended to the vector at any time.
+   */
+  explicit EarlyCommitTracker(vector<SubscribedGesture>* subscribed_gestures)
+      : subscribed_gestures_(subscribed_gestures) {
+  }
+
+  /**
+   * Sets the distance threshold that partial gestures are held against.
+   */
+  void SetThreshold(float distance_threshold_pct) {
+    distance_threshold_pct_ = distance_threshold_pct;
+  }
+
+  /**
+   * Sets whether commits are confirmed with the run-length distance instead
+   * of the Damerau-Levenshtein distance, matching the recognizer.
+   */
+  void SetUseRunLengthDistance(bool use_run_length_distance) {
+    use_run_length_distance_ = use_run_length_distance;
+  }
+
+  /**
+   * Takes the names of the active gesture contexts. Gestures subscribed only
+   * under other contexts can neither be committed to nor keep another
+   * gesture from being committed to.
+   *
+   * By default no context is active, so only gestures without a context are.
+   */
+  void SetActiveContexts(const vector<string>& active_contexts) {
+    active_contexts_ = active_contexts;
+  }
+
+  /**
+   * Takes the LaGeR string of the gesture being drawn and updates the
+   * distance bounds. The string may extend the previous one, rewrite its last
+   * movement, or start a new gesture altogether.
+   *
+   * Returns true if the gesture can be committed to, in which case
+   * TakeCommittedGesture() returns it.
+   */
+  bool Update(const string& partial_lager);
+
+  /**
+   * Takes the LaGeR string handed over by the converter and, if the tracker
+   * committed to a gesture for that exact string, stores the index of the
+   * gesture in gesture_index, clears the commit and returns true.
+   *
+   * Returns false if the gesture is no longer in an active context.
+   */
+  bool TakeCommittedGesture(const string& lager, size_t& gesture_index);
+
+  /**
+   * Drops the state of every subscribed gesture and any pending commit, after
+   * the subscribed gestures have been replaced.
+   */
+  void Reset();
+
+  /**
+   * Returns the latest commit decision.
+   */
+  const EarlyCommitDecision& GetLastDecision() {
+    return last_decision_;
+  }
+
+ private:
+  /**
+   * Encodes subscribed gestures that were added since the last update and
+   * computes their rows for the current input.
+   */
+  void SynchronizeTemplates();
+
+  /**
+   * Takes a subscribed gesture and computes the row for the latest input run
+   * from the row before it.
+   */
+  void PushInputRun(EarlyCommitTemplate& gesture_template, LagerSymbol symbol,
+                    size_t input_run);
+
+  /**
+   * Takes a subscribed gesture and returns the lower and upper distance
+   * bounds for the current input, as percentages of its length.
+   */
+  void GetDistanceBounds(const EarlyCommitTemplate& gesture_template,
+                         float& lower_bound_pct, float& upper_bound_pct);
+
+  /**
+   * Takes the index of a subscribed gesture and returns whether it has no
+   * context or is subscribed under an active one.
+   */
+  bool IsGestureActive(size_t gesture_index);
+
+  /**
+   * Checks whether the current input can only match a single gesture name
+   * and records the decision if so.
+   */
+  bool DecideCommit(const string& partial_lager);
+
+  /// Pointer to the subscribed gestures
+  vector<SubscribedGesture>* subscribed_gestures_;
+  /// Incremental state for each subscribed gesture
+  vector<EarlyCommitTemplate> templates_;
+  /// Run-length representation of the latest partial gesture
+  RunLengthLager input_;
+  /// Scratch run-length representation used when adding gestures
+  RunLengthLager encoded_template_;
+  /// Run symbols of the input that the template rows were computed for
+  vector<LagerSymbol> input_symbols_;
+  /// Distance threshold for committing
+  float distance_threshold_pct_ = EARLY_COMMIT_DISTANCE_THRESHOLD_PCT;
+  /// Whether commits are confirmed with the run-length distance
+  bool use_run_length_distance_ = false;
+  /// Names of the active gesture contexts
+  vector<string> active_contexts_;
+
+  /// Protects the commit, which is taken from another thread
+  std::mutex commit_mutex_;
+  /// Whether a commit is waiting to be taken
+  bool commit_pending_ = false;
+  /// LaGeR string the pending commit was made for
+  string committed_lager_;
+  /// Latest commit decision
+  EarlyCommitDecision last_decision_ = EarlyCommitDecision();
+};
+
+#endif /* LAGER_EARLY_COMMIT_H_ */
@@ -0,0 +1,205 @@
+/*
+ * lager_exemplars.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <thread>
+using std::thread;
+
+#include "lager_distance.h"
+#include "lager_exemplars.h"
+#include "lager_run_length.h"
+
+/*
+ * Takes the gestures, along with their run-length representations if that is
+ * the engine in use, and fills the rows of the distance matrix that belong to
+ * one thread. Rows are interleaved between threads because the upper triangle
+ * makes the first rows the most expensive.
+ */
+static void ComputeDistanceMatrixRows(
+    const vector<string>* lagers, const vector<RunLengthLager>* encoded_lagers,
+    bool use_run_length_distance, unsigned int first_row,
+    unsigned int row_step, vector<float>* distance_matrix) {
+  size_t num_lagers = lagers->size();
+
+  for (size_t i = first_row; i < num_lagers; i += row_step) {
+    (*distance_matrix)[i * num_lagers + i] = 0;
+
+    // The distance is symmetric, so each pair is only computed once
+    for (size_t j = i + 1; j < num_lagers; j++) {
+      float distance_pct;
+      if (use_run_length_distance) {
+        RunLengthLagerDistance((*encoded_lagers)[i], (*encoded_lagers)[j],
+                               distance_pct);
+      } else {
+        LagerDistance((*lagers)[i], (*lagers)[j], distance_pct);
+      }
+      (*distance_matrix)[i * num_lagers + j] = distance_pct;
+      (*distance_matrix)[j * num_lagers + i] = distance_pct;
+    }
+  }
+}
+
+void ComputeLagerDistanceMatrix(const vector<string>& lagers,
+                                bool use_run_length_distance,
+                                unsigned int num_threads,
+                                vector<float>& distance_matrix) {
+  distance_matrix.assign(lagers.size() * lagers.size(), 0);
+  if (lagers.size() < 2) {
+    return;
+  }
+
+  vector<RunLengthLager> encoded_lagers;
+  if (use_run_length_distance) {
+    encoded_lagers.resize(lagers.size());
+    for (size_t i = 0; i < lagers.size(); i++) {
+      EncodeRunLengthLager(lagers[i], encoded_lagers[i]);
+    }
+  }
+
+  if (num_threads == 0) {
+    num_threads = thread::hardware_concurrency();
+  }
+  if (num_threads == 0 || num_threads > lagers.size()) {
+    num_threads = lagers.size();
+  }
+
+  vector<thread> threads;
+  for (unsigned int i = 0; i < num_threads; i++) {
+    threads.push_back(thread(ComputeDistanceMatrixRows, &lagers,
+                             &encoded_lagers, use_run_length_distance, i,
+                             num_threads, &distance_matrix));
+  }
+  for (vector<thread>::iterator it = threads.begin(); it < threads.end();
+      ++it) {
+    it->join();
+  }
+}
+
+void GroupGestureClasses(const vector<SubscribedGesture>& gestures,
+                         vector<GestureClass>& gesture_classes) {
+  gesture_classes.clear();
+
+  for (size_t i = 0; i < gestures.size(); i++) {
+    vector<GestureClass>::iterator it = gesture_classes.begin();
+    for (; it < gesture_classes.end(); ++it) {
+      if (it->name == gestures[i].name) {
+        break;
+      }
+    }
+
+    if (it == gesture_classes.end()) {
+      GestureClass new_class;
+      new_class.name = gestures[i].name;
+      new_class.medoid = i;
+      gesture_classes.push_back(new_class);
+      it = gesture_classes.end() - 1;
+    }
+
+    it->exemplars.push_back(i);
+  }
+}
+
+void SelectClassRepresentatives(const vector<float>& distance_matrix,
+                                size_t max_representatives,
+                                struct GestureClass& gesture_class) {
+  const vector<size_t>& exemplars = gesture_class.exemplars;
+  size_t num_exemplars = exemplars.size();
+  size_t medoid = 0;
+  float lowest_total_distance = -1;
+
+  for (size_t i = 0; i < num_exemplars; i++) {
+    float total_distance = 0;
+    for (size_t j = 0; j < num_exemplars; j++) {
+      total_distance += distance_matrix[i * num_exemplars + j];
+    }
+
+    if (lowest_total_distance < 0 || total_distance < lowest_total_distance) {
+      lowest_total_distance = total_distance;
+      medoid = i;
+    }
+  }
+
+  if (num_exemplars > 0) {
+    gesture_class.medoid = exemplars[medoid];
+  }
+  gesture_class.representatives.clear();
+  gesture_class.representatives.push_back(gesture_class.medoid);
+
+  // Distance from each exemplar to the closest representative chosen so far
+  vector<float> coverage_distances(num_exemplars);
+  for (size_t i = 0; i < num_exemplars; i++) {
+    coverage_distances[i] = distance_matrix[i * num_exemplars + medoid];
+  }
+
+  while (gesture_class.representatives.size() < max_representatives) {
+    size_t farthest = 0;
+    for (size_t i = 1; i < num_exemplars; i++) {
+      if (coverage_distances[i] > coverage_distances[farthest]) {
+        farthest = i;
+      }
+    }
+
+    // Every exemplar already has an identical representative
+    if (exemplars.empty() || coverage_distances[farthest] <= 0) {
+      break;
+    }
+
+    gesture_class.representatives.push_back(exemplars[farthest]);
+    for (size_t i = 0; i < num_exemplars; i++) {
+      float distance = distance_matrix[i * num_exemplars + farthest];
+      if (distance < coverage_distances[i]) {
+        coverage_distances[i] = distance;
+      }
+    }
+  }
+}
+
+void CompressGestureClasses(const vector<SubscribedGesture>& gestures,
+                            size_t max_representatives,
+                            bool use_run_length_distance,
+                            unsigned int num_threads,
+                            vector<SubscribedGesture>& representatives,
+                            vector<size_t>& representative_indexes) {
+  vector<string> lagers;
+  vector<float> distance_matrix;
+  vector<GestureClass> gesture_classes;
+
+  GroupGestureClasses(gestures, gesture_classes);
+
+  representatives.clear();
+  representative_indexes.assign(gestures.size(), 0);
+  for (vector<GestureClass>::iterator it = gesture_classes.begin();
+      it < gesture_classes.end(); ++it) {
+    // Representatives are chosen within a class, so no other distance counts
+    lagers.clear();
+    for (vector<size_t>::iterator exemplar = it->exemplars.begin();
+        exemplar < it->exemplars.end(); ++exemplar) {
+      lagers.push_back(gestures[*exemplar].lager);
+    }
+
+    ComputeLagerDistanceMatrix(lagers, use_run_length_distance, num_threads,
+                               distance_matrix);
+    SelectClassRepresentatives(distance_matrix, max_representatives, *it);
+
+    cout << "Class " << it->name << ": " << it->exemplars.size()
+         << " exemplars, " << it->representatives.size()
+         << " representatives" << endl;
+
+    // The medoid comes first, and stands for the whole class
+    for (vector<size_t>::iterator exemplar = it->exemplars.begin();
+        exemplar < it->exemplars.end(); ++exemplar) {
+      representative_indexes[*exemplar] = representatives.size();
+    }
+
+    for (vector<size_t>::iterator representative =
+        it->representatives.begin();
+        representative < it->representatives.end(); ++representative) {
+      representatives.push_back(gestures[*representative]);
+    }
+  }
+}
@@ -0,0 +1,85 @@
+/*
+ * lager_exemplars.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_EXEMPLARS_H_
+#define LAGER_EXEMPLARS_H_
+
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "liblager_connect.h"
+
+/// Default number of representatives kept for each gesture class
+#define DEFAULT_MAX_CLASS_REPRESENTATIVES 3
+/// Default number of closest representatives that vote for a gesture class
+#define DEFAULT_CLASS_VOTE_NEIGHBORS 3
+
+/**
+ * Describes a gesture class: all the recorded exemplars that share a name,
+ * and the ones chosen to stand for it at recognition time.
+ */
+struct GestureClass {
+  /// Name shared by the exemplars
+  string name;
+  /// Indexes of the exemplars in the gestures vector
+  vector<size_t> exemplars;
+  /// Index of the exemplar with the lowest total distance to the others
+  size_t medoid;
+  /// Indexes of the chosen representatives, starting with the medoid
+  vector<size_t> representatives;
+};
+
+/**
+ * Takes a list of LaGeR strings and fills a num_lagers x num_lagers matrix,
+ * stored by rows, with their distance percentages, computed with the
+ * run-length engine if use_run_length_distance is true and with the
+ * Damerau-Levenshtein engine otherwise. The rows are split among num_threads
+ * threads, or one per core if num_threads is 0.
+ */
+void ComputeLagerDistanceMatrix(const vector<string>& lagers,
+                                bool use_run_length_distance,
+                                unsigned int num_threads,
+                                vector<float>& distance_matrix);
+
+/**
+ * Takes a list of gestures and groups them into classes by name, in order of
+ * first appearance.
+ */
+void GroupGestureClasses(const vector<SubscribedGesture>& gestures,
+                         vector<GestureClass>& gesture_classes);
+
+/**
+ * Takes the distance matrix of the exemplars of a gesture class, in the order
+ * of its exemplars list, and chooses its medoid and up to max_representatives
+ * representatives. After the medoid, each representative is the exemplar
+ * farthest from the ones already chosen, so that the set covers the different
+ * ways the gesture is drawn.
+ */
+void SelectClassRepresentatives(const vector<float>& distance_matrix,
+                                size_t max_representatives,
+                                struct GestureClass& gesture_class);
+
+/**
+ * Takes a list of gestures where each name may have many exemplars, and
+ * stores in representatives only the medoid and the most diverse exemplars of
+ * each class, at most max_representatives per class. Only distances between
+ * exemplars of the same class are computed, with the engine the gestures are
+ * recognized with.
+ *
+ * representative_indexes gets, for each gesture, the index in representatives
+ * of the medoid of its class, so that results given in terms of the original
+ * list, such as those of the ML classifier, can still be mapped.
+ */
+void CompressGestureClasses(const vector<SubscribedGesture>& gestures,
+                            size_t max_representatives,
+                            bool use_run_length_distance,
+                            unsigned int num_threads,
+                            vector<SubscribedGesture>& representatives,
+                            vector<size_t>& representative_indexes);
+
+#endif /* LAGER_EXEMPLARS_H_ */
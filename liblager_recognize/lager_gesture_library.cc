@@ -0,0 +1,201 @@
+/*
+ * lager_gesture_library.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>   // for memset, strerror
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+using std::ofstream;
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <type_traits>
+
+#include "lager_gesture_library.h"
+
+// Runs are read straight from the mapping, so their layout must not change
+static_assert(std::is_standard_layout<LagerRun>::value
+              && sizeof(LagerRun) == 16, "unexpected LagerRun layout");
+
+/* Takes a size in bytes and returns it rounded up to a multiple of 8. */
+static uint64_t AlignSection(uint64_t size) {
+  return (size + 7) & ~static_cast<uint64_t>(7);
+}
+
+bool WriteLagerGestureLibrary(const string& path, const vector<string>& names,
+                              const vector<string>& lagers) {
+  vector<struct LagerLibraryGesture> gestures(names.size());
+  vector<LagerRun> runs;
+  string strings;
+  RunLengthLager run_length;
+
+  for (size_t i = 0; i < names.size(); i++) {
+    struct LagerLibraryGesture& gesture = gestures[i];
+
+    EncodeRunLengthLager(lagers[i], run_length);
+    gesture.first_run = runs.size();
+    gesture.num_runs = run_length.runs.size();
+    gesture.num_movements = run_length.num_movements;
+    gesture.symbol_width = run_length.symbol_width;
+    runs.insert(runs.end(), run_length.runs.begin(), run_length.runs.end());
+
+    ComputeLagerHistogram(lagers[i], gesture.histogram);
+
+    gesture.name_offset = strings.size();
+    strings.append(names[i]).push_back('\0');
+    gesture.lager_offset = strings.size();
+    strings.append(lagers[i]).push_back('\0');
+  }
+
+  struct LagerLibraryHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = LAGER_GESTURE_LIBRARY_MAGIC;
+  header.version = LAGER_GESTURE_LIBRARY_VERSION;
+  header.num_gestures = gestures.size();
+  header.num_runs = runs.size();
+  header.gestures_offset = AlignSection(sizeof(header));
+  header.runs_offset = header.gestures_offset
+      + AlignSection(gestures.size() * sizeof(struct LagerLibraryGesture));
+  header.strings_offset = header.runs_offset
+      + AlignSection(runs.size() * sizeof(LagerRun));
+  header.strings_size = strings.size();
+  header.index_type = LAGER_LIBRARY_INDEX_NONE;
+
+  ofstream library_file(path.c_str(), std::ios::binary | std::ios::trunc);
+  if (!library_file.is_open()) {
+    return false;
+  }
+
+  // Padding between sections, and inside LagerRun, is written as zeroes
+  string padding;
+  padding.resize(header.gestures_offset - sizeof(header));
+  library_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  library_file.write(padding.data(), padding.size());
+  library_file.write(reinterpret_cast<const char*>(gestures.data()),
+                     gestures.size() * sizeof(struct LagerLibraryGesture));
+  padding.assign(header.runs_offset - header.gestures_offset
+                 - gestures.size() * sizeof(struct LagerLibraryGesture), '\0');
+  library_file.write(padding.data(), padding.size());
+  for (size_t i = 0; i < runs.size(); i++) {
+    LagerRun run;
+    memset(&run, 0, sizeof(run));
+    run.symbol = runs[i].symbol;
+    run.count = runs[i].count;
+    library_file.write(reinterpret_cast<const char*>(&run), sizeof(run));
+  }
+  library_file.write(strings.data(), strings.size());
+
+  return library_file.good();
+}
+
+bool LagerGestureLibrary::Open(const string& path) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    cout << "Could not open " << path << ": " << strerror(errno) << endl;
+    return false;
+  }
+
+  struct stat file_status;
+  if (fstat(fd, &file_status) != 0
+      || static_cast<size_t>(file_status.st_size)
+          < sizeof(struct LagerLibraryHeader)) {
+    cout << path << " is not a gesture library." << endl;
+    close(fd);
+    return false;
+  }
+
+  size_t size = file_status.st_size;
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    cout << "Could not map " << path << ": " << strerror(errno) << endl;
+    return false;
+  }
+  mapping_ = static_cast<const char*>(mapping);
+  mapping_size_ = size;
+  path_ = path;
+
+  const struct LagerLibraryHeader* header =
+      reinterpret_cast<const struct LagerLibraryHeader*>(mapping_);
+  if (header->magic != LAGER_GESTURE_LIBRARY_MAGIC
+      || header->version != LAGER_GESTURE_LIBRARY_VERSION) {
+    cout << path << " is not a version " << LAGER_GESTURE_LIBRARY_VERSION
+         << " gesture library." << endl;
+    Close();
+    return false;
+  }
+
+  // Every section must lie within the file, aligned, and the strings section
+  // must end with a NUL so that no string runs past it
+  uint64_t gestures_size = static_cast<uint64_t>(header->num_gestures)
+      * sizeof(struct LagerLibraryGesture);
+  uint64_t runs_size = static_cast<uint64_t>(header->num_runs)
+      * sizeof(LagerRun);
+  if (header->gestures_offset % 8 != 0 || header->runs_offset % 8 != 0
+      || header->gestures_offset > size
+      || gestures_size > size - header->gestures_offset
+      || header->runs_offset > size || runs_size > size - header->runs_offset
+      || header->strings_offset > size
+      || header->strings_size > size - header->strings_offset
+      || header->strings_size == 0
+      || mapping_[header->strings_offset + header->strings_size - 1] != '\0') {
+    cout << path << " is truncated or corrupt." << endl;
+    Close();
+    return false;
+  }
+
+  const struct LagerLibraryGesture* gestures =
+      reinterpret_cast<const struct LagerLibraryGesture*>(
+          mapping_ + header->gestures_offset);
+  const LagerRun* runs = reinterpret_cast<const LagerRun*>(
+      mapping_ + header->runs_offset);
+  const char* strings = mapping_ + header->strings_offset;
+
+  gestures_.resize(header->num_gestures);
+  for (size_t i = 0; i < gestures_.size(); i++) {
+    const struct LagerLibraryGesture& gesture = gestures[i];
+
+    if (gesture.name_offset >= header->strings_size
+        || gesture.lager_offset >= header->strings_size
+        || gesture.first_run > header->num_runs
+        || gesture.num_runs > header->num_runs - gesture.first_run) {
+      cout << path << " is truncated or corrupt." << endl;
+      Close();
+      return false;
+    }
+
+    gestures_[i].name = strings + gesture.name_offset;
+    gestures_[i].lager = strings + gesture.lager_offset;
+    gestures_[i].runs = runs + gesture.first_run;
+    gestures_[i].num_runs = gesture.num_runs;
+    gestures_[i].num_movements = gesture.num_movements;
+    gestures_[i].symbol_width = gesture.symbol_width;
+    gestures_[i].histogram = gesture.histogram;
+  }
+
+  gesture_table_.version = LAGER_GESTURE_PLUGIN_VERSION;
+  gesture_table_.source_file = path_.c_str();
+  gesture_table_.num_gestures = gestures_.size();
+  gesture_table_.gestures = gestures_.data();
+
+  return true;
+}
+
+void LagerGestureLibrary::Close() {
+  if (mapping_ != NULL) {
+    munmap(const_cast<char*>(mapping_), mapping_size_);
+  }
+
+  mapping_ = NULL;
+  mapping_size_ = 0;
+  gestures_.clear();
+  gesture_table_ = LagerGesturePlugin();
+}
@@ -0,0 +1,139 @@
+/*
+ * lager_gesture_library.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_GESTURE_LIBRARY_H_
+#define LAGER_GESTURE_LIBRARY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "lager_distance.h"
+#include "lager_gesture_plugin.h"
+#include "lager_run_length.h"
+
+/*
+ * Gesture libraries (.lgb files) hold a gestures file already encoded: the
+ * names and LaGeR strings, the run-length runs and the histograms, laid out so
+ * that they can be read straight from a read-only memory mapping. Loading one
+ * does not parse or encode anything. The recognizer copies the gestures into
+ * its own vectors, so the library can be closed once they are added.
+ *
+ * Layout, with every section aligned to 8 bytes and integers in the byte
+ * order of the machine that wrote the file:
+ *
+ *   LagerLibraryHeader
+ *   LagerLibraryGesture[num_gestures]
+ *   LagerRun[num_runs]
+ *   strings: the NUL-terminated names and LaGeR strings
+ */
+
+/// "LGB" followed by a 0 byte, read as a little-endian integer
+#define LAGER_GESTURE_LIBRARY_MAGIC 0x0042474c
+/// Bumped whenever the layout of the structures below changes
+#define LAGER_GESTURE_LIBRARY_VERSION 1
+/// No index section; gestures are ranked with their histograms
+#define LAGER_LIBRARY_INDEX_NONE 0
+
+/**
+ * Header at the start of a gesture library. Offsets are in bytes from the
+ * start of the file.
+ */
+struct LagerLibraryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_gestures;
+  uint32_t num_runs;
+  uint64_t gestures_offset;
+  uint64_t runs_offset;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+  /// Kind of the optional index section, LAGER_LIBRARY_INDEX_NONE for now
+  uint32_t index_type;
+  uint32_t reserved;
+  uint64_t index_offset;
+  uint64_t index_size;
+};
+
+/**
+ * Gesture record of a gesture library. String offsets are relative to the
+ * strings section.
+ */
+struct LagerLibraryGesture {
+  uint32_t name_offset;
+  uint32_t lager_offset;
+  /// Index of the first run of the gesture in the runs section
+  uint32_t first_run;
+  uint32_t num_runs;
+  uint32_t num_movements;
+  uint32_t symbol_width;
+  struct LagerHistogram histogram;
+};
+
+/**
+ * Takes the path of a library to write and the names and LaGeR strings of
+ * its gestures, and writes the encoded library. Returns false if the file
+ * could not be written.
+ */
+bool WriteLagerGestureLibrary(const string& path, const vector<string>& names,
+                              const vector<string>& lagers);
+
+/**
+ * Read-only view of a memory-mapped gesture library.
+ */
+class LagerGestureLibrary {
+ public:
+  LagerGestureLibrary() {
+  }
+
+  /**
+   * Unmaps the library if it is open.
+   */
+  ~LagerGestureLibrary() {
+    Close();
+  }
+
+  LagerGestureLibrary(const LagerGestureLibrary&) = delete;
+  LagerGestureLibrary& operator=(const LagerGestureLibrary&) = delete;
+
+  /**
+   * Takes the path of a library, maps it and checks that every offset in it
+   * stays within the file. Returns false, printing the reason, if it cannot
+   * be used.
+   */
+  bool Open(const string& path);
+
+  /**
+   * Unmaps the library. Gesture tables returned before become invalid.
+   */
+  void Close();
+
+  /**
+   * Returns the gestures of the library, in the same form as the gestures of
+   * a plugin. The table points into the mapping, so it is valid until the
+   * library is closed.
+   */
+  const struct LagerGesturePlugin& GetGestureTable() const {
+    return gesture_table_;
+  }
+
+ private:
+  /// Start of the mapping, or NULL if no library is open
+  const char* mapping_ = NULL;
+  /// Size of the mapping in bytes
+  size_t mapping_size_ = 0;
+  /// Path of the open library
+  string path_;
+  /// Gestures pointing into the mapping
+  vector<struct LagerPluginGesture> gestures_;
+  /// Table over gestures_
+  struct LagerGesturePlugin gesture_table_ = LagerGesturePlugin();
+};
+
+#endif /* LAGER_GESTURE_LIBRARY_H_ */
@@ -0,0 +1,46 @@
+/*
+ * lager_gesture_plugin.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <dlfcn.h>
+#include <iostream>
+using std::cout;
+using std::endl;
+
+#include "lager_gesture_plugin.h"
+
+const struct LagerGesturePlugin* LoadLagerGesturePlugin(const string& path) {
+  // Plugins are never unloaded, since their gestures are used until exit
+  void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL) {
+    cout << "Could not load gesture plugin: " << dlerror() << endl;
+    return NULL;
+  }
+
+  LagerGesturePluginFunction get_plugin =
+      reinterpret_cast<LagerGesturePluginFunction>(
+          dlsym(handle, LAGER_GESTURE_PLUGIN_SYMBOL));
+  if (get_plugin == NULL) {
+    cout << path << " is not a gesture plugin." << endl;
+    dlclose(handle);
+    return NULL;
+  }
+
+  const struct LagerGesturePlugin* plugin = get_plugin();
+  if (plugin == NULL || plugin->version != LAGER_GESTURE_PLUGIN_VERSION) {
+    cout << path << " was generated for another plugin version." << endl;
+    dlclose(handle);
+    return NULL;
+  }
+
+  return plugin;
+}
+
+void DecodeLagerPluginGesture(const struct LagerPluginGesture& gesture,
+                              RunLengthLager& encoded) {
+  encoded.runs.assign(gesture.runs, gesture.runs + gesture.num_runs);
+  encoded.num_movements = gesture.num_movements;
+  encoded.symbol_width = gesture.symbol_width;
+}
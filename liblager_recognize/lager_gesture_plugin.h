@@ -0,0 +1,82 @@
+/*
+ * lager_gesture_plugin.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_GESTURE_PLUGIN_H_
+#define LAGER_GESTURE_PLUGIN_H_
+
+#include <stddef.h>
+#include <string>
+using std::string;
+
+#include "lager_distance.h"
+#include "lager_run_length.h"
+
+/*
+ * Gesture plugins are shared objects generated by lager_compile_gestures from
+ * a gestures file. They hold every gesture of the file along with its
+ * run-length representation and histogram as constant data, so a fixed
+ * vocabulary is loaded without reading, parsing or encoding anything.
+ */
+
+/// Bumped whenever the layout of the structures below changes
+#define LAGER_GESTURE_PLUGIN_VERSION 1
+/// Name of the function every plugin exports
+#define LAGER_GESTURE_PLUGIN_SYMBOL "lager_gesture_plugin"
+
+/**
+ * Gesture compiled into a plugin.
+ */
+struct LagerPluginGesture {
+  /// Name of the gesture
+  const char* name;
+  /// LaGeR string of the gesture
+  const char* lager;
+  /// Runs of the run-length representation
+  const struct LagerRun* runs;
+  /// Number of runs
+  unsigned int num_runs;
+  /// Number of movements in the expanded gesture
+  unsigned int num_movements;
+  /// Largest number of sensor letters found in a single movement
+  unsigned int symbol_width;
+  /// Character histogram of the LaGeR string
+  struct LagerHistogram histogram;
+};
+
+/**
+ * Table of gestures exported by a plugin.
+ */
+struct LagerGesturePlugin {
+  /// LAGER_GESTURE_PLUGIN_VERSION the plugin was generated for
+  unsigned int version;
+  /// Gestures file the plugin was generated from
+  const char* source_file;
+  /// Number of gestures
+  size_t num_gestures;
+  /// Gestures, in file order
+  const struct LagerPluginGesture* gestures;
+};
+
+/**
+ * Signature of the function exported by plugins.
+ */
+typedef const struct LagerGesturePlugin* (*LagerGesturePluginFunction)();
+
+/**
+ * Takes the path of a plugin, loads it and returns its gesture table, which
+ * stays valid for the rest of the program. Returns NULL if the plugin cannot
+ * be loaded or was generated for another version.
+ */
+const struct LagerGesturePlugin* LoadLagerGesturePlugin(const string& path);
+
+/**
+ * Takes a plugin gesture and stores its run-length representation in the
+ * encoded parameter.
+ */
+void DecodeLagerPluginGesture(const struct LagerPluginGesture& gesture,
+                              RunLengthLager& encoded);
+
+#endif /* LAGER_GESTURE_PLUGIN_H_ */
@@ -0,0 +1,283 @@
+/*
+ * lager_gesture_reloader.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>   // for strerror
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fstream>
+using std::ifstream;
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <sstream>
+using std::stringstream;
+
+#include "liblager_connect.h"
+#include "lager_exemplars.h"
+#include "lager_gesture_reloader.h"
+
+/*
+ * Takes a LaGeR string and returns whether it only holds sensor letters, '_'
+ * and '.'.
+ */
+static bool IsWellFormedLager(const string& lager) {
+  for (string::const_iterator it = lager.begin(); it < lager.end(); ++it) {
+    if ((*it < 'a' || *it > 'z') && *it != '_' && *it != '.') {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CompileGesturesFile(const string& file_path,
+                         unsigned int max_representatives,
+                         bool use_run_length_distance,
+                         CompiledGestureSet& gesture_set, string& error) {
+  ifstream gestures_file(file_path.c_str());
+  if (!gestures_file.is_open()) {
+    error = "could not open " + file_path;
+    return false;
+  }
+
+  vector<SubscribedGesture> gestures;
+  string current_line;
+  for (unsigned int line_number = 1; getline(gestures_file, current_line);
+      line_number++) {
+    stringstream ss(current_line);
+    SubscribedGesture new_gesture;
+
+    ss >> new_gesture.name >> new_gesture.lager;
+    if (new_gesture.name.empty()) {
+      continue;
+    }
+
+    if (new_gesture.lager.empty() || !IsWellFormedLager(new_gesture.lager)) {
+      error = "line " + std::to_string(line_number) + " of " + file_path
+          + " does not hold a gesture name and a LaGeR string";
+      return false;
+    }
+
+    new_gesture.pid = 0;
+    gestures.push_back(new_gesture);
+  }
+
+  if (gestures.empty()) {
+    error = file_path + " holds no gestures";
+    return false;
+  }
+
+  if (max_representatives > 0) {
+    vector<SubscribedGesture> representatives;
+    CompressGestureClasses(gestures, max_representatives,
+                           use_run_length_distance, 0, representatives,
+                           gesture_set.representative_indexes);
+    gestures.swap(representatives);
+  }
+
+  size_t num_gestures = gestures.size();
+  gesture_set.names.resize(num_gestures);
+  gesture_set.lagers.resize(num_gestures);
+  gesture_set.runs.resize(num_gestures);
+  gesture_set.gestures.resize(num_gestures);
+
+  RunLengthLager run_length;
+  for (size_t i = 0; i < num_gestures; i++) {
+    struct LagerPluginGesture& gesture = gesture_set.gestures[i];
+
+    gesture_set.names[i] = gestures[i].name;
+    gesture_set.lagers[i] = gestures[i].lager;
+    EncodeRunLengthLager(gestures[i].lager, run_length);
+    gesture_set.runs[i] = run_length.runs;
+
+    gesture.name = gesture_set.names[i].c_str();
+    gesture.lager = gesture_set.lagers[i].c_str();
+    gesture.runs = gesture_set.runs[i].data();
+    gesture.num_runs = run_length.runs.size();
+    gesture.num_movements = run_length.num_movements;
+    gesture.symbol_width = run_length.symbol_width;
+    ComputeLagerHistogram(gestures[i].lager, gesture.histogram);
+  }
+
+  gesture_set.table.version = LAGER_GESTURE_PLUGIN_VERSION;
+  gesture_set.file_path = file_path;
+  gesture_set.table.source_file = gesture_set.file_path.c_str();
+  gesture_set.table.num_gestures = num_gestures;
+  gesture_set.table.gestures = gesture_set.gestures.data();
+
+  return true;
+}
+
+GestureFileReloader::GestureFileReloader(const string& file_path)
+    : file_path_(file_path) {
+  size_t last_slash = file_path.find_last_of('/');
+  if (last_slash == string::npos) {
+    directory_ = ".";
+    file_name_ = file_path;
+  } else {
+    directory_ = (last_slash == 0) ? "/" : file_path.substr(0, last_slash);
+    file_name_ = file_path.substr(last_slash + 1);
+  }
+}
+
+GestureFileReloader::~GestureFileReloader() {
+  Stop();
+}
+
+bool GestureFileReloader::Start() {
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0) {
+    cout << "Could not watch " << file_path_ << ": " << strerror(errno)
+         << endl;
+    return false;
+  }
+
+  // The directory is watched, since editors often replace the file by
+  // renaming a new one over it
+  if (inotify_add_watch(inotify_fd_, directory_.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    cout << "Could not watch " << directory_ << ": " << strerror(errno)
+         << endl;
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+    return false;
+  }
+
+  stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (stop_fd_ < 0) {
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+    return false;
+  }
+
+  watcher_thread_ = std::thread(&GestureFileReloader::RunWatcher, this);
+
+  cout << "Reloading gestures when " << file_path_ << " changes." << endl;
+  return true;
+}
+
+void GestureFileReloader::Stop() {
+  if (watcher_thread_.joinable()) {
+    uint64_t value = 1;
+    if (write(stop_fd_, &value, sizeof(value)) != sizeof(value)) {
+      cout << "Could not stop the gestures file watcher." << endl;
+    }
+    watcher_thread_.join();
+  }
+
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+  }
+  if (stop_fd_ >= 0) {
+    close(stop_fd_);
+    stop_fd_ = -1;
+  }
+}
+
+shared_ptr<const CompiledGestureSet>
+GestureFileReloader::TakeReloadedGestures() {
+  std::lock_guard<std::mutex> lock(reload_mutex_);
+
+  shared_ptr<const CompiledGestureSet> reloaded_gestures;
+  reloaded_gestures.swap(reloaded_gestures_);
+
+  return reloaded_gestures;
+}
+
+void GestureFileReloader::RunWatcher() {
+  struct pollfd poll_fds[2];
+  poll_fds[0].fd = inotify_fd_;
+  poll_fds[0].events = POLLIN;
+  poll_fds[1].fd = stop_fd_;
+  poll_fds[1].events = POLLIN;
+
+  while (true) {
+    if (poll(poll_fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      cout << "Stopped watching " << file_path_ << ": " << strerror(errno)
+           << endl;
+      return;
+    }
+
+    if (poll_fds[1].revents != 0) {
+      return;
+    }
+
+    if (!ReadFileEvents()) {
+      continue;
+    }
+
+    if (!WaitForFileToSettle()) {
+      return;
+    }
+
+    shared_ptr<CompiledGestureSet> gesture_set(new CompiledGestureSet());
+    string error;
+    if (!CompileGesturesFile(file_path_, max_representatives_,
+                             use_run_length_distance_, *gesture_set, error)) {
+      cout << "Keeping the previous gestures: " << error << endl;
+      continue;
+    }
+
+    cout << "Compiled " << gesture_set->table.num_gestures
+         << " gestures from " << file_path_ << endl;
+
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    reloaded_gestures_ = gesture_set;
+  }
+}
+
+bool GestureFileReloader::WaitForFileToSettle() {
+  struct pollfd poll_fds[2];
+  poll_fds[0].fd = inotify_fd_;
+  poll_fds[0].events = POLLIN;
+  poll_fds[1].fd = stop_fd_;
+  poll_fds[1].events = POLLIN;
+
+  while (true) {
+    int num_ready = poll(poll_fds, 2, GESTURE_RELOAD_SETTLE_MS);
+    if (num_ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if (num_ready <= 0) {
+      return true;
+    }
+    if (poll_fds[1].revents != 0) {
+      return false;
+    }
+
+    ReadFileEvents();
+  }
+}
+
+bool GestureFileReloader::ReadFileEvents() {
+  // Aligned as required by struct inotify_event
+  char buffer[4096]
+      __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  bool file_changed = false;
+
+  while (true) {
+    ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+    if (length <= 0) {
+      return file_changed;
+    }
+
+    for (char* event_start = buffer; event_start < buffer + length;) {
+      const struct inotify_event* event =
+          reinterpret_cast<const struct inotify_event*>(event_start);
+      if (event->len > 0 && file_name_ == event->name) {
+        file_changed = true;
+      }
+      event_start += sizeof(struct inotify_event) + event->len;
+    }
+  }
+}
@@ -0,0 +1,151 @@
+/*
+ * lager_gesture_reloader.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_GESTURE_RELOADER_H_
+#define LAGER_GESTURE_RELOADER_H_
+
+#include <memory>
+using std::shared_ptr;
+#include <mutex>
+#include <string>
+using std::string;
+#include <thread>
+#include <vector>
+using std::vector;
+
+#include "lager_gesture_plugin.h"
+#include "lager_run_length.h"
+
+/// Time a changed gestures file must stay quiet before it is read again
+#define GESTURE_RELOAD_SETTLE_MS 200
+
+/**
+ * Gestures read from a gestures file and encoded, in the same form as the
+ * gestures of a plugin. The table points into the vectors of the set.
+ */
+struct CompiledGestureSet {
+  string file_path;
+  vector<string> names;
+  vector<string> lagers;
+  vector<vector<LagerRun> > runs;
+  vector<struct LagerPluginGesture> gestures;
+  struct LagerGesturePlugin table;
+  /// Index in the table of the gesture that stands for each gesture of the
+  /// file, or empty if every gesture of the file is in the table
+  vector<size_t> representative_indexes;
+};
+
+/**
+ * Takes the path of a gestures file, the number of representatives to keep
+ * per gesture name, or 0 to keep every exemplar, and whether representatives
+ * are chosen by run-length distance rather than Damerau-Levenshtein, then
+ * reads and encodes its gestures into gesture_set. Returns false and
+ * describes the first problem in error if the file cannot be read or has a
+ * malformed line.
+ */
+bool CompileGesturesFile(const string& file_path,
+                         unsigned int max_representatives,
+                         bool use_run_length_distance,
+                         CompiledGestureSet& gesture_set, string& error);
+
+/**
+ * Watches a gestures file with inotify and compiles it again on a background
+ * thread every time it is written or replaced. The recognizer takes the new
+ * gestures between recognitions, so a gestures file can be edited without
+ * restarting it. Files that fail to compile are reported and ignored, which
+ * keeps the previous gestures in use.
+ */
+class GestureFileReloader {
+ public:
+  /**
+   * Takes the path of the gestures file to watch.
+   */
+  explicit GestureFileReloader(const string& file_path);
+
+  /**
+   * Stops watching if the reloader is running.
+   */
+  ~GestureFileReloader();
+
+  /**
+   * Sets the number of representatives kept per gesture name when the file
+   * is compiled, 0 keeping every exemplar. Must be called before Start().
+   */
+  void SetMaxRepresentatives(unsigned int max_representatives) {
+    max_representatives_ = max_representatives;
+  }
+
+  /**
+   * Sets whether representatives are chosen by run-length distance rather
+   * than Damerau-Levenshtein, to match the recognizer's engine. Must be
+   * called before Start().
+   */
+  void SetUseRunLengthDistance(bool use_run_length_distance) {
+    use_run_length_distance_ = use_run_length_distance;
+  }
+
+  /**
+   * Starts watching the directory of the gestures file. Returns false if
+   * inotify is not available.
+   */
+  bool Start();
+
+  /**
+   * Stops the watcher thread.
+   */
+  void Stop();
+
+  /**
+   * Returns the gestures compiled since the last call, or NULL if the file
+   * has not changed successfully since then.
+   */
+  shared_ptr<const CompiledGestureSet> TakeReloadedGestures();
+
+ private:
+  /**
+   * Waits for changes to the gestures file and compiles it after each one,
+   * until the reloader stops.
+   */
+  void RunWatcher();
+
+  /**
+   * Waits until no inotify event has arrived for GESTURE_RELOAD_SETTLE_MS,
+   * so that a file being written in several steps is read once it is done.
+   * Returns false if the reloader is stopping.
+   */
+  bool WaitForFileToSettle();
+
+  /**
+   * Reads the pending inotify events and returns whether any of them is about
+   * the gestures file.
+   */
+  bool ReadFileEvents();
+
+  /// Path of the gestures file
+  string file_path_;
+  /// Directory watched for the gestures file
+  string directory_;
+  /// Name of the gestures file within the directory
+  string file_name_;
+  /// Representatives kept per gesture name, 0 for every exemplar
+  unsigned int max_representatives_ = 0;
+  /// Whether representatives are chosen by run-length distance
+  bool use_run_length_distance_ = false;
+
+  /// inotify instance watching the directory
+  int inotify_fd_ = -1;
+  /// eventfd signalled to stop the watcher thread
+  int stop_fd_ = -1;
+  /// Watcher thread
+  std::thread watcher_thread_;
+
+  /// Protects reloaded_gestures_
+  std::mutex reload_mutex_;
+  /// Gestures compiled but not taken yet
+  shared_ptr<const CompiledGestureSet> reloaded_gestures_;
+};
+
+#endif /* LAGER_GESTURE_RELOADER_H_ */
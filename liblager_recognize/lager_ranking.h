@@ -0,0 +1,266 @@
+/*
+ * lager_ranking.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_RANKING_H_
+#define LAGER_RANKING_H_
+
+#include <algorithm>  // for std::sort and heaps
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "lager_distance.h"
+#include "lager_run_length.h"
+
+/**
+ * Describes the position of a template in the scoring order.
+ */
+struct ScoringOrderEntry {
+  /// Lower bound on the distance percentage of the template
+  float lower_bound_pct;
+  /// Index of the template within its list
+  size_t gesture_index;
+};
+
+/**
+ * Orders scoring order entries by lower bound, breaking ties by template
+ * order.
+ */
+inline bool ScoringOrderLessThan(const struct ScoringOrderEntry& i,
+                                 const struct ScoringOrderEntry& j) {
+  if (i.lower_bound_pct != j.lower_bound_pct) {
+    return (i.lower_bound_pct < j.lower_bound_pct);
+  }
+  return (i.gesture_index < j.gesture_index);
+}
+
+/**
+ * Describes a ranked template: its index and how far it is from the input.
+ */
+struct LagerTemplateScore {
+  /// Index of the template within its list
+  size_t gesture_index;
+  /// Distance between the template and the input
+  int distance;
+  /// Distance as a percent of the expanded LaGeR string length
+  float distance_pct;
+};
+
+/**
+ * Orders ranked templates by distance percentage, breaking ties by template
+ * order so that the earliest template wins. Candidate can be any type with
+ * the gesture_index and distance_pct fields of LagerTemplateScore.
+ */
+template<typename Candidate>
+bool LagerCandidateLessThan(const Candidate& i, const Candidate& j) {
+  if (i.distance_pct != j.distance_pct) {
+    return (i.distance_pct < j.distance_pct);
+  }
+  return (i.gesture_index < j.gesture_index);
+}
+
+/**
+ * Gesture template with everything needed to rank it against input strings.
+ */
+struct LagerTemplate {
+  /// Name of the gesture
+  string name;
+  /// LaGeR string of the gesture
+  string lager;
+  /// Run-length representation of the LaGeR string
+  RunLengthLager run_length;
+  /// Character histogram of the LaGeR string
+  struct LagerHistogram histogram;
+};
+
+/**
+ * Takes a LaGeR string and fills the representations of a template that the
+ * ranking needs.
+ */
+template<typename Template>
+void PrepareLagerTemplate(const string& lager, Template& gesture_template) {
+  gesture_template.lager = lager;
+  EncodeRunLengthLager(lager, gesture_template.run_length);
+  ComputeLagerHistogram(lager, gesture_template.histogram);
+}
+
+/**
+ * Takes the histograms and run-length representations of an input and a
+ * template, and returns a lower bound on their distance percentage under the
+ * given engine.
+ */
+inline float GetLagerLowerBoundPct(
+    const struct LagerHistogram& input_histogram,
+    const RunLengthLager& run_length_input,
+    const struct LagerHistogram& template_histogram,
+    const RunLengthLager& template_run_length,
+    bool use_run_length_distance) {
+  // Movements of different widths are not costed character by character
+  if (use_run_length_distance
+      && template_run_length.symbol_width != run_length_input.symbol_width) {
+    return 0;
+  }
+
+  return GetHistogramLowerBoundPct(input_histogram, template_histogram);
+}
+
+/**
+ * Takes a scoring order sorted with ScoringOrderLessThan and fills a
+ * caller-provided array with the max_candidates closest templates, sorted
+ * from closest to farthest with LagerCandidateLessThan. Returns the number of
+ * candidates written.
+ *
+ * score_template(candidate) fills in the distance of the template whose
+ * gesture_index is set. When distinct_classes is true, only the closest
+ * template of each class is kept, as told by same_class(i, j), so the second
+ * candidate is the closest template of another class. out_of_time() is asked
+ * before each template once there is a candidate, and stops the ranking when
+ * it returns true; partial_result is then set.
+ *
+ * Templates whose lower bound cannot beat the farthest candidate kept are not
+ * scored. num_scored is set to the number of templates that were.
+ */
+template<typename Candidate, typename ScoreFunction, typename ClassFunction,
+    typename TimeFunction>
+size_t SelectClosestLagerTemplates(
+    const struct ScoringOrderEntry* scoring_order, size_t num_entries,
+    ScoreFunction score_template, bool distinct_classes,
+    ClassFunction same_class, TimeFunction out_of_time,
+    Candidate* candidates, size_t max_candidates, size_t& num_scored,
+    bool& partial_result) {
+  size_t num_candidates = 0;
+
+  partial_result = false;
+  num_scored = 0;
+  if (max_candidates == 0) {
+    return 0;
+  }
+
+  /*
+   * The caller's buffer holds a max-heap of the best candidates seen so far,
+   * so only the k best are ever kept and nothing else is copied.
+   */
+  for (; num_scored < num_entries; num_scored++) {
+    const struct ScoringOrderEntry& entry = scoring_order[num_scored];
+
+    // Templates are sorted by lower bound, so none of the rest can do better
+    if (num_candidates == max_candidates
+        && entry.lower_bound_pct > candidates[0].distance_pct) {
+      break;
+    }
+
+    if (num_candidates > 0 && out_of_time()) {
+      partial_result = true;
+      break;
+    }
+
+    Candidate candidate;
+    candidate.gesture_index = entry.gesture_index;
+    score_template(candidate);
+
+    // A closer template of a class already kept takes its place
+    size_t same_class_candidate = num_candidates;
+    for (size_t i = 0; distinct_classes && i < num_candidates; i++) {
+      if (same_class(candidates[i].gesture_index, entry.gesture_index)) {
+        same_class_candidate = i;
+        break;
+      }
+    }
+
+    if (same_class_candidate < num_candidates) {
+      if (LagerCandidateLessThan(candidate,
+                                 candidates[same_class_candidate])) {
+        candidates[same_class_candidate] = candidate;
+        std::make_heap(candidates, candidates + num_candidates,
+                       LagerCandidateLessThan<Candidate>);
+      }
+    } else if (num_candidates < max_candidates) {
+      candidates[num_candidates++] = candidate;
+      std::push_heap(candidates, candidates + num_candidates,
+                     LagerCandidateLessThan<Candidate>);
+    } else if (LagerCandidateLessThan(candidate, candidates[0])) {
+      std::pop_heap(candidates, candidates + num_candidates,
+                    LagerCandidateLessThan<Candidate>);
+      candidates[num_candidates - 1] = candidate;
+      std::push_heap(candidates, candidates + num_candidates,
+                     LagerCandidateLessThan<Candidate>);
+    }
+  }
+
+  std::sort_heap(candidates, candidates + num_candidates,
+                 LagerCandidateLessThan<Candidate>);
+
+  return num_candidates;
+}
+
+/**
+ * Takes a list of templates, which can be of any type with the fields of
+ * LagerTemplate, and a LaGeR string, and fills closest with the max_results
+ * templates closest to the string, sorted from closest to farthest. Only
+ * templates for which is_candidate returns true are ranked. When
+ * distinct_names is true, only the closest template of each name is kept.
+ *
+ * Templates are scored in order of increasing histogram lower bound, and
+ * scoring stops once no remaining template can beat the last result. This is
+ * safe to call from several threads at once.
+ */
+template<typename Template, typename Filter>
+void RankLagerTemplates(const vector<Template>& templates, const string& lager,
+                        bool use_run_length_distance, size_t max_results,
+                        bool distinct_names, Filter is_candidate,
+                        vector<LagerTemplateScore>& closest) {
+  // Reused between calls so that steady state ranking does not allocate
+  static thread_local RunLengthLager run_length_lager;
+  static thread_local struct LagerHistogram histogram;
+  static thread_local vector<struct ScoringOrderEntry> scoring_order;
+
+  if (use_run_length_distance) {
+    EncodeRunLengthLager(lager, run_length_lager);
+  }
+  ComputeLagerHistogram(lager, histogram);
+
+  scoring_order.clear();
+  for (size_t i = 0; i < templates.size(); i++) {
+    if (!is_candidate(templates[i])) {
+      continue;
+    }
+
+    struct ScoringOrderEntry entry;
+    entry.lower_bound_pct = GetLagerLowerBoundPct(histogram, run_length_lager,
+                                                  templates[i].histogram,
+                                                  templates[i].run_length,
+                                                  use_run_length_distance);
+    entry.gesture_index = i;
+    scoring_order.push_back(entry);
+  }
+  std::sort(scoring_order.begin(), scoring_order.end(), ScoringOrderLessThan);
+
+  size_t num_scored;
+  bool partial_result;
+  closest.resize(max_results);
+  closest.resize(SelectClosestLagerTemplates(
+      scoring_order.data(), scoring_order.size(),
+      [&](struct LagerTemplateScore& candidate) {
+        const Template& gesture_template = templates[candidate.gesture_index];
+        if (use_run_length_distance) {
+          candidate.distance = RunLengthLagerDistance(
+              run_length_lager, gesture_template.run_length,
+              candidate.distance_pct);
+        } else {
+          candidate.distance = LagerDistance(lager, gesture_template.lager,
+                                             candidate.distance_pct);
+        }
+      },
+      distinct_names,
+      [&templates](size_t i, size_t j) {
+        return templates[i].name == templates[j].name;
+      },
+      []() { return false; },
+      closest.data(), max_results, num_scored, partial_result));
+}
+
+#endif /* LAGER_RANKING_H_ */
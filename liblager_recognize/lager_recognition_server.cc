@@ -0,0 +1,555 @@
+/*
+ * lager_recognition_server.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>   // for atoi
+#include <string.h>   // for memset, strerror, strncpy
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <sstream>
+using std::ostringstream;
+using std::stringstream;
+
+#include "lager_recognition_server.h"
+
+/// Number of socket events handled per epoll_wait() call
+#define RECOGNITION_MAX_EVENTS 64
+/// Size of the buffer requests are read into
+#define RECOGNITION_READ_BUFFER_SIZE 65536
+
+LagerRecognitionServer::LagerRecognitionServer(
+    vector<SubscribedGesture>* subscribed_gestures, const string& socket_path,
+    unsigned int num_workers)
+    : subscribed_gestures_(subscribed_gestures),
+      socket_path_(socket_path),
+      num_workers_(num_workers),
+      running_(false),
+      templates_(new vector<RecognitionTemplate>()) {
+  if (num_workers_ == 0) {
+    num_workers_ = std::thread::hardware_concurrency();
+  }
+  if (num_workers_ == 0) {
+    num_workers_ = 1;
+  }
+}
+
+LagerRecognitionServer::~LagerRecognitionServer() {
+  Stop();
+}
+
+bool LagerRecognitionServer::Start() {
+  struct sockaddr_un address;
+  struct epoll_event event;
+
+  if (running_) {
+    return true;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socket_path_.c_str(),
+          sizeof(address.sun_path) - 1);
+  unlink(socket_path_.c_str());
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0
+      || bind(listen_fd_, (struct sockaddr*) &address, sizeof(address)) < 0
+      || listen(listen_fd_, SOMAXCONN) < 0) {
+    cout << "Could not listen on " << socket_path_ << ": " << strerror(errno)
+         << endl;
+    Stop();
+    return false;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || wake_fd_ < 0) {
+    Stop();
+    return false;
+  }
+
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = listen_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+  event.data.fd = wake_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+
+  SynchronizeTemplates();
+
+  running_ = true;
+  event_loop_thread_ = std::thread(&LagerRecognitionServer::RunEventLoop,
+                                   this);
+  for (unsigned int i = 0; i < num_workers_; i++) {
+    worker_threads_.push_back(std::thread(&LagerRecognitionServer::RunWorker,
+                                          this));
+  }
+
+  cout << "Answering recognition requests on " << socket_path_ << " with "
+       << num_workers_ << " workers." << endl;
+
+  return true;
+}
+
+void LagerRecognitionServer::Stop() {
+  if (running_) {
+    uint64_t wake_up = 1;
+
+    // Cleared under the lock so that no worker misses the notification
+    {
+      std::lock_guard<std::mutex> lock(jobs_mutex_);
+      running_ = false;
+    }
+    if (write(wake_fd_, &wake_up, sizeof(wake_up)) < 0) {
+      // The event loop still wakes up when its poll times out
+    }
+    jobs_available_.notify_all();
+
+    event_loop_thread_.join();
+    for (vector<std::thread>::iterator it = worker_threads_.begin();
+        it < worker_threads_.end(); ++it) {
+      it->join();
+    }
+    worker_threads_.clear();
+  }
+
+  while (!connections_.empty()) {
+    CloseConnection(connections_.begin()->second);
+  }
+  jobs_.clear();
+  connections_with_responses_.clear();
+
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+    listen_fd_ = -1;
+  }
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+  if (wake_fd_ >= 0) {
+    close(wake_fd_);
+    wake_fd_ = -1;
+  }
+}
+
+struct RecognitionServerStatistics LagerRecognitionServer::GetStatistics() {
+  std::lock_guard<std::mutex> lock(templates_mutex_);
+  return statistics_;
+}
+
+void LagerRecognitionServer::RunEventLoop() {
+  struct epoll_event events[RECOGNITION_MAX_EVENTS];
+
+  while (running_) {
+    int num_events = epoll_wait(epoll_fd_, events, RECOGNITION_MAX_EVENTS,
+                                RECOGNITION_POLL_TIMEOUT_MS);
+
+    SynchronizeTemplates();
+
+    for (int i = 0; i < num_events; i++) {
+      int fd = events[i].data.fd;
+
+      if (fd == listen_fd_) {
+        AcceptConnections();
+      } else if (fd == wake_fd_) {
+        uint64_t num_wake_ups;
+        vector<shared_ptr<RecognitionConnection> > ready_connections;
+
+        if (read(wake_fd_, &num_wake_ups, sizeof(num_wake_ups)) < 0) {
+          // Spurious wake-up: there is nothing to drain
+        }
+        {
+          std::lock_guard<std::mutex> lock(responses_mutex_);
+          ready_connections.swap(connections_with_responses_);
+        }
+
+        for (vector<shared_ptr<RecognitionConnection> >::iterator it =
+            ready_connections.begin(); it < ready_connections.end(); ++it) {
+          if (connections_.count((*it)->fd) > 0
+              && connections_[(*it)->fd] == *it) {
+            WriteResponses(*it);
+          }
+        }
+      } else {
+        map<int, shared_ptr<RecognitionConnection> >::iterator it =
+            connections_.find(fd);
+        if (it == connections_.end()) {
+          continue;
+        }
+
+        shared_ptr<RecognitionConnection> connection = it->second;
+
+        // Hang-ups after the end of input mean the client is gone entirely
+        if (connection->input_closed
+            && (events[i].events & (EPOLLHUP | EPOLLERR))) {
+          CloseConnection(connection);
+          continue;
+        }
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+          ReadRequests(connection);
+        }
+        if ((events[i].events & EPOLLOUT) && !connection->closed) {
+          WriteResponses(connection);
+        }
+      }
+    }
+  }
+}
+
+void LagerRecognitionServer::AcceptConnections() {
+  while (true) {
+    int fd = accept4(listen_fd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      break;
+    }
+
+    shared_ptr<RecognitionConnection> connection(new RecognitionConnection());
+    connection->fd = fd;
+    connection->closed = false;
+    connection->input_closed = false;
+    connection->watched_events = EPOLLIN;
+    connection->num_pending_requests = 0;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+
+    connections_[fd] = connection;
+
+    std::lock_guard<std::mutex> lock(templates_mutex_);
+    statistics_.num_connections++;
+  }
+}
+
+void LagerRecognitionServer::ReadRequests(
+    shared_ptr<RecognitionConnection> connection) {
+  char buffer[RECOGNITION_READ_BUFFER_SIZE];
+  vector<RecognitionJob> new_jobs;
+
+  while (true) {
+    ssize_t num_bytes = read(connection->fd, buffer, sizeof(buffer));
+
+    if (num_bytes > 0) {
+      connection->input.append(buffer, num_bytes);
+      continue;
+    }
+    if (num_bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    if (num_bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (num_bytes < 0) {
+      CloseConnection(connection);
+      return;
+    }
+
+    // End of file: the requests sent before it are still answered
+    shutdown(connection->fd, SHUT_RD);
+    connection->input_closed = true;
+    if (!connection->input.empty() && connection->input.back() != '\n') {
+      connection->input.push_back('\n');
+    }
+    break;
+  }
+
+  size_t line_start = 0;
+  size_t line_end;
+  while ((line_end = connection->input.find('\n', line_start))
+      != string::npos) {
+    if (line_end > line_start) {
+      RecognitionJob job;
+      job.connection = connection;
+      job.request = connection->input.substr(line_start,
+                                             line_end - line_start);
+      new_jobs.push_back(job);
+    }
+    line_start = line_end + 1;
+  }
+  connection->input.erase(0, line_start);
+
+  if (connection->input.length() > RECOGNITION_MAX_REQUEST_LENGTH) {
+    CloseConnection(connection);
+    return;
+  }
+
+  // Counted before the workers can answer, so none is missed
+  {
+    std::lock_guard<std::mutex> lock(connection->output_mutex);
+    connection->num_pending_requests += new_jobs.size();
+  }
+
+  if (!new_jobs.empty()) {
+    std::lock_guard<std::mutex> lock(jobs_mutex_);
+    jobs_.insert(jobs_.end(), new_jobs.begin(), new_jobs.end());
+  }
+  if (new_jobs.size() == 1) {
+    jobs_available_.notify_one();
+  } else if (new_jobs.size() > 1) {
+    jobs_available_.notify_all();
+  }
+
+  if (connection->input_closed) {
+    WriteResponses(connection);
+  }
+}
+
+void LagerRecognitionServer::WriteResponses(
+    shared_ptr<RecognitionConnection> connection) {
+  bool write_failed = false;
+  bool output_left;
+  bool requests_left;
+
+  {
+    std::lock_guard<std::mutex> lock(connection->output_mutex);
+    size_t num_bytes_written = 0;
+
+    while (num_bytes_written < connection->output.length()) {
+      ssize_t num_bytes = send(connection->fd,
+                               connection->output.data() + num_bytes_written,
+                               connection->output.length() - num_bytes_written,
+                               MSG_NOSIGNAL);
+      if (num_bytes > 0) {
+        num_bytes_written += num_bytes;
+      } else if (num_bytes < 0 && errno == EINTR) {
+        continue;
+      } else {
+        write_failed = (num_bytes == 0
+            || (errno != EAGAIN && errno != EWOULDBLOCK));
+        break;
+      }
+    }
+
+    connection->output.erase(0, num_bytes_written);
+    output_left = !connection->output.empty();
+    requests_left = connection->num_pending_requests > 0;
+  }
+
+  if (write_failed
+      || (connection->input_closed && !output_left && !requests_left)) {
+    CloseConnection(connection);
+    return;
+  }
+
+  // Only wait for the socket to become writable while output is pending,
+  // and only for requests until the client shuts down its side
+  uint32_t events = (connection->input_closed ? 0 : EPOLLIN)
+      | (output_left ? EPOLLOUT : 0);
+  if (events != connection->watched_events) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = connection->fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection->fd, &event);
+    connection->watched_events = events;
+  }
+}
+
+void LagerRecognitionServer::CloseConnection(
+    shared_ptr<RecognitionConnection> connection) {
+  {
+    std::lock_guard<std::mutex> lock(connection->output_mutex);
+    connection->closed = true;
+    connection->output.clear();
+  }
+
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->fd, NULL);
+  close(connection->fd);
+  connections_.erase(connection->fd);
+}
+
+void LagerRecognitionServer::SynchronizeTemplates() {
+  // Runs after every wake-up, so the mutex is only taken after a change
+  if (subscribed_gestures_generation_ != NULL && templates_synchronized_
+      && subscribed_gestures_generation_->load() == synchronized_generation_) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> gestures_lock;
+  if (subscribed_gestures_mutex_ != NULL) {
+    gestures_lock = std::unique_lock<std::mutex>(*subscribed_gestures_mutex_);
+  }
+
+  size_t num_subscribers = 0;
+  for (vector<SubscribedGesture>::iterator it = subscribed_gestures_->begin();
+      it < subscribed_gestures_->end(); ++it) {
+    num_subscribers += it->subscribers.size();
+  }
+
+  if (subscribed_gestures_generation_ == NULL && templates_synchronized_
+      && subscribed_gestures_->size() == num_synchronized_gestures_
+      && num_subscribers == num_synchronized_subscribers_) {
+    return;
+  }
+
+  shared_ptr<vector<RecognitionTemplate> > templates(
+      new vector<RecognitionTemplate>(subscribed_gestures_->size()));
+
+  for (size_t i = 0; i < subscribed_gestures_->size(); i++) {
+    const SubscribedGesture& gesture = (*subscribed_gestures_)[i];
+    RecognitionTemplate& gesture_template = (*templates)[i];
+
+    gesture_template.name = gesture.name;
+    PrepareLagerTemplate(gesture.lager, gesture_template);
+
+    // Gestures read from a file, or subscribed by any process without a
+    // context, are always active
+    for (vector<GestureSubscriber>::const_iterator it =
+        gesture.subscribers.begin(); it < gesture.subscribers.end(); ++it) {
+      if (it->context.empty()) {
+        gesture_template.contexts.clear();
+        break;
+      }
+      gesture_template.contexts.push_back(it->context);
+    }
+  }
+
+  templates_synchronized_ = true;
+  if (subscribed_gestures_generation_ != NULL) {
+    synchronized_generation_ = subscribed_gestures_generation_->load();
+  }
+
+  std::lock_guard<std::mutex> lock(templates_mutex_);
+  templates_ = templates;
+  num_synchronized_gestures_ = subscribed_gestures_->size();
+  num_synchronized_subscribers_ = num_subscribers;
+}
+
+void LagerRecognitionServer::RunWorker() {
+  while (true) {
+    RecognitionJob job;
+
+    {
+      std::unique_lock<std::mutex> lock(jobs_mutex_);
+      while (running_ && jobs_.empty()) {
+        jobs_available_.wait(lock);
+      }
+      if (!running_) {
+        return;
+      }
+      job = jobs_.front();
+      jobs_.pop_front();
+    }
+
+    string response = AnswerRequest(job.request);
+
+    {
+      std::lock_guard<std::mutex> lock(job.connection->output_mutex);
+      if (job.connection->closed) {
+        continue;
+      }
+      job.connection->output += response;
+      job.connection->num_pending_requests--;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(responses_mutex_);
+      connections_with_responses_.push_back(job.connection);
+    }
+
+    uint64_t wake_up = 1;
+    if (write(wake_fd_, &wake_up, sizeof(wake_up)) < 0) {
+      // The counter is already non-zero, so the event loop wakes up anyway
+    }
+  }
+}
+
+string LagerRecognitionServer::AnswerRequest(const string& request) {
+  stringstream request_stream(request);
+  ostringstream response;
+  string request_id, context, max_results_field, lager;
+  vector<string> lagers;
+  vector<GestureScore> results;
+
+  request_stream >> request_id >> context >> max_results_field;
+  while (request_stream >> lager) {
+    lagers.push_back(lager);
+  }
+
+  int max_results = atoi(max_results_field.c_str());
+  if (lagers.empty() || max_results <= 0) {
+    std::lock_guard<std::mutex> lock(templates_mutex_);
+    statistics_.num_errors++;
+    response << request_id << " ERROR malformed request\n";
+    return response.str();
+  }
+  if (max_results > RECOGNITION_MAX_RESULTS) {
+    max_results = RECOGNITION_MAX_RESULTS;
+  }
+
+  shared_ptr<const vector<RecognitionTemplate> > templates;
+  {
+    std::lock_guard<std::mutex> lock(templates_mutex_);
+    templates = templates_;
+    statistics_.num_requests++;
+    statistics_.num_lagers += lagers.size();
+  }
+
+  for (size_t i = 0; i < lagers.size(); i++) {
+    ScoreLager(*templates, lagers[i], context, max_results, results);
+
+    response << request_id << ' ' << i << ' ' << results.size();
+    for (vector<GestureScore>::iterator it = results.begin();
+        it < results.end(); ++it) {
+      response << ' ' << it->name << ' ' << it->distance_pct;
+    }
+    response << '\n';
+  }
+
+  return response.str();
+}
+
+/*
+ * Takes a template and a requested context, and returns whether the template
+ * is scored for it.
+ */
+static bool IsTemplateInContext(const RecognitionTemplate& gesture_template,
+                                const string& context) {
+  if (context == RECOGNITION_ALL_CONTEXTS
+      || gesture_template.contexts.empty()) {
+    return true;
+  }
+
+  for (vector<string>::const_iterator it = gesture_template.contexts.begin();
+      it < gesture_template.contexts.end(); ++it) {
+    if (*it == context) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void LagerRecognitionServer::ScoreLager(
+    const vector<RecognitionTemplate>& templates, const string& lager,
+    const string& context, unsigned int max_results,
+    vector<GestureScore>& results) {
+  // Reused between requests so that steady state scoring does not allocate
+  static thread_local vector<LagerTemplateScore> closest;
+
+  RankLagerTemplates(templates, lager, use_run_length_distance_, max_results,
+                     false,
+                     [&context](const RecognitionTemplate& gesture_template) {
+                       return IsTemplateInContext(gesture_template, context);
+                     }, closest);
+
+  results.resize(closest.size());
+  for (size_t i = 0; i < closest.size(); i++) {
+    results[i].name = templates[closest[i].gesture_index].name;
+    results[i].distance_pct = closest[i].distance_pct;
+  }
+}
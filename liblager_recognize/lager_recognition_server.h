@@ -0,0 +1,285 @@
+/*
+ * lager_recognition_server.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_RECOGNITION_SERVER_H_
+#define LAGER_RECOGNITION_SERVER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+using std::deque;
+#include <map>
+using std::map;
+#include <memory>
+using std::shared_ptr;
+#include <mutex>
+#include <string>
+using std::string;
+#include <thread>
+#include <vector>
+using std::vector;
+
+#include "liblager_connect.h"
+#include "lager_distance.h"
+#include "lager_ranking.h"
+#include "lager_run_length.h"
+
+/// Largest request line accepted before the connection is closed
+#define RECOGNITION_MAX_REQUEST_LENGTH (1 << 20)
+/// Largest number of results returned for each LaGeR string
+#define RECOGNITION_MAX_RESULTS 64
+/// Time the event loop waits before checking for new subscribed gestures
+#define RECOGNITION_POLL_TIMEOUT_MS 500
+
+/**
+ * Subscribed gesture as seen by the recognition service workers.
+ */
+struct RecognitionTemplate {
+  /// Name of the gesture
+  string name;
+  /// LaGeR string of the gesture
+  string lager;
+  /// Contexts the gesture was subscribed under; empty if always active
+  vector<string> contexts;
+  /// Run-length representation of the LaGeR string
+  RunLengthLager run_length;
+  /// Character histogram of the LaGeR string
+  struct LagerHistogram histogram;
+};
+
+/**
+ * Counters for the requests answered by the recognition service.
+ */
+struct RecognitionServerStatistics {
+  /// Number of connections accepted
+  unsigned long num_connections;
+  /// Number of request lines answered
+  unsigned long num_requests;
+  /// Number of LaGeR strings scored across all requests
+  unsigned long num_lagers;
+  /// Number of requests that were rejected
+  unsigned long num_errors;
+};
+
+/**
+ * Client connection to the recognition service.
+ */
+struct RecognitionConnection {
+  /// Socket descriptor, owned by the event loop
+  int fd;
+  /// Bytes received that do not form a complete request yet
+  string input;
+  /// Whether the client shut down its side. The connection is closed once
+  /// the requests read before are answered.
+  bool input_closed;
+  /// Events the event loop watches the socket for
+  uint32_t watched_events;
+  /// Protects the fields below, which workers write to
+  std::mutex output_mutex;
+  /// Responses waiting to be written to the socket
+  string output;
+  /// Requests queued for the workers that have not been answered yet
+  size_t num_pending_requests;
+  /// Whether the connection was closed; responses for it are dropped
+  bool closed;
+};
+
+/**
+ * Request line waiting for a worker.
+ */
+struct RecognitionJob {
+  shared_ptr<RecognitionConnection> connection;
+  string request;
+};
+
+/**
+ * Answers recognition requests from other processes on a UNIX domain socket,
+ * using the protocol described in liblager_connect.h.
+ *
+ * A single event loop thread accepts connections and reads requests with
+ * epoll, and a pool of worker threads scores them. Workers hand their
+ * responses back to the event loop through an eventfd, so that only the
+ * event loop touches the sockets. The workers share an immutable snapshot of
+ * the subscribed gestures, which the event loop replaces when gestures are
+ * added.
+ *
+ * Nearly all of the time goes into distance computations, one ranking per
+ * LaGeR string, so throughput grows with the number of workers up to one per
+ * core. Asking for fewer results lets the ranking prune more templates: with
+ * a single result most requests score one or two templates.
+ */
+class LagerRecognitionServer {
+ public:
+  /**
+   * Takes a pointer to the vector of subscribed gestures to score against,
+   * the path of the socket to listen on and the number of worker threads, or
+   * 0 for one per core.
+   */
+  LagerRecognitionServer(vector<SubscribedGesture>* subscribed_gestures,
+                         const string& socket_path, unsigned int num_workers);
+
+  /**
+   * Stops the service if it is running.
+   */
+  ~LagerRecognitionServer();
+
+  /**
+   * Sets whether LaGeR strings are compared with the run-length distance
+   * instead of the Damerau-Levenshtein distance. Must be called before
+   * Start().
+   */
+  void SetUseRunLengthDistance(bool use_run_length_distance) {
+    use_run_length_distance_ = use_run_length_distance;
+  }
+
+  /**
+   * Takes a mutex that other threads hold while they change the subscribed
+   * gestures, and a generation that they increment under the mutex with every
+   * change. The service only takes the mutex to read the gestures again once
+   * the generation has changed, so its event loop never waits for them
+   * otherwise. Must be called before Start().
+   */
+  void SetSubscribedGesturesMutex(
+      std::mutex* subscribed_gestures_mutex,
+      const std::atomic<unsigned int>* subscribed_gestures_generation) {
+    subscribed_gestures_mutex_ = subscribed_gestures_mutex;
+    subscribed_gestures_generation_ = subscribed_gestures_generation;
+  }
+
+  /**
+   * Creates the socket and starts the event loop and worker threads.
+   * Returns false if the socket could not be created.
+   */
+  bool Start();
+
+  /**
+   * Stops every thread and removes the socket.
+   */
+  void Stop();
+
+  /**
+   * Returns the request counters.
+   */
+  struct RecognitionServerStatistics GetStatistics();
+
+ private:
+  /**
+   * Waits for socket events and dispatches them until the service stops.
+   */
+  void RunEventLoop();
+
+  /**
+   * Accepts every pending connection.
+   */
+  void AcceptConnections();
+
+  /**
+   * Takes a connection with data to read, and queues each complete request
+   * line for the workers. On end of file, a last unterminated line is queued
+   * too, and the connection is closed once every request is answered. Closes
+   * the connection right away on error.
+   */
+  void ReadRequests(shared_ptr<RecognitionConnection> connection);
+
+  /**
+   * Takes a connection and writes as much of its pending output as the socket
+   * accepts, waiting for the socket to become writable if some is left.
+   * Closes the connection if the client shut down its side and nothing is
+   * left to answer.
+   */
+  void WriteResponses(shared_ptr<RecognitionConnection> connection);
+
+  /**
+   * Takes a connection, stops watching it and closes its socket.
+   */
+  void CloseConnection(shared_ptr<RecognitionConnection> connection);
+
+  /**
+   * Replaces the template snapshot if the subscribed gestures changed, as
+   * told by their generation, or else by their number and the number of
+   * subscribers.
+   */
+  void SynchronizeTemplates();
+
+  /**
+   * Takes jobs from the queue and answers them until the service stops.
+   */
+  void RunWorker();
+
+  /**
+   * Takes a request line and returns the response lines for it.
+   */
+  string AnswerRequest(const string& request);
+
+  /**
+   * Takes a template snapshot, a LaGeR string, a context and a number of
+   * results, and fills results with the closest templates to the string,
+   * sorted from closest to farthest.
+   */
+  void ScoreLager(const vector<RecognitionTemplate>& templates,
+                  const string& lager, const string& context,
+                  unsigned int max_results, vector<GestureScore>& results);
+
+  /// Pointer to the subscribed gestures
+  vector<SubscribedGesture>* subscribed_gestures_;
+  /// Path of the listening socket
+  string socket_path_;
+  /// Number of worker threads
+  unsigned int num_workers_;
+  /// Whether the run-length distance is used
+  bool use_run_length_distance_ = false;
+  /// Held while the subscribed gestures are read, if set
+  std::mutex* subscribed_gestures_mutex_ = NULL;
+  /// Generation of the subscribed gestures, if set
+  const std::atomic<unsigned int>* subscribed_gestures_generation_ = NULL;
+
+  /// Listening socket
+  int listen_fd_ = -1;
+  /// epoll instance of the event loop
+  int epoll_fd_ = -1;
+  /// eventfd that workers signal when they have responses to write
+  int wake_fd_ = -1;
+  /// Whether the threads should keep running
+  std::atomic<bool> running_;
+  /// Event loop thread
+  std::thread event_loop_thread_;
+  /// Worker threads
+  vector<std::thread> worker_threads_;
+
+  /// Open connections by socket descriptor, only used by the event loop
+  map<int, shared_ptr<RecognitionConnection> > connections_;
+
+  /// Protects the job queue
+  std::mutex jobs_mutex_;
+  /// Signals workers that jobs are waiting
+  std::condition_variable jobs_available_;
+  /// Requests waiting for a worker
+  deque<RecognitionJob> jobs_;
+
+  /// Protects the list of connections with responses
+  std::mutex responses_mutex_;
+  /// Connections with responses waiting to be written
+  vector<shared_ptr<RecognitionConnection> > connections_with_responses_;
+
+  /// Protects the template snapshot and the statistics
+  std::mutex templates_mutex_;
+  /// Current template snapshot
+  shared_ptr<const vector<RecognitionTemplate> > templates_;
+  /// Whether a snapshot was taken yet, only used by the event loop
+  bool templates_synchronized_ = false;
+  /// Generation of the subscribed gestures in the current snapshot
+  unsigned int synchronized_generation_ = 0;
+  /// Number of subscribed gestures in the current snapshot
+  size_t num_synchronized_gestures_ = 0;
+  /// Number of subscribers in the current snapshot
+  size_t num_synchronized_subscribers_ = 0;
+  /// Request counters
+  struct RecognitionServerStatistics statistics_ =
+      RecognitionServerStatistics();
+};
+
+#endif /* LAGER_RECOGNITION_SERVER_H_ */
@@ -0,0 +1,138 @@
+/*
+ * lager_recognizer_api.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <deque>
+using std::deque;
+#include <memory>
+using std::shared_ptr;
+#include <mutex>
+#include <new>        // for std::nothrow
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include "lager_distance.h"
+#include "lager_ranking.h"
+#include "lager_recognizer_api.h"
+#include "lager_run_length.h"
+
+/*
+ * Template as ranked by the C interface. The name points into the names of
+ * the recognizer, which never move, so results can refer to it after the
+ * snapshot they came from is replaced.
+ */
+struct ApiTemplate {
+  const char* name;
+  string lager;
+  RunLengthLager run_length;
+  struct LagerHistogram histogram;
+};
+
+struct lager_recognizer {
+  /// Distance used to compare LaGeR strings
+  lager_engine engine;
+  /// Protects the fields below
+  std::mutex mutex;
+  /// Names of the templates, in the order they were added
+  deque<string> names;
+  /// Every template added so far
+  vector<ApiTemplate> templates;
+  /// Immutable copy of the templates that recognitions rank against
+  shared_ptr<const vector<ApiTemplate> > snapshot;
+};
+
+/*
+ * Takes a recognizer and returns a snapshot of its templates, copying them if
+ * some were added since the last snapshot. Batches of templates added before
+ * recognizing are thus only copied once.
+ */
+static shared_ptr<const vector<ApiTemplate> > GetTemplateSnapshot(
+    lager_recognizer* recognizer) {
+  std::lock_guard<std::mutex> lock(recognizer->mutex);
+
+  if (!recognizer->snapshot
+      || recognizer->snapshot->size() != recognizer->templates.size()) {
+    recognizer->snapshot.reset(
+        new vector<ApiTemplate>(recognizer->templates));
+  }
+
+  return recognizer->snapshot;
+}
+
+lager_recognizer* lager_recognizer_create(lager_engine engine) {
+  if (engine != LAGER_ENGINE_DAMERAU_LEVENSHTEIN
+      && engine != LAGER_ENGINE_RUN_LENGTH) {
+    return NULL;
+  }
+
+  lager_recognizer* recognizer = new (std::nothrow) lager_recognizer();
+  if (recognizer != NULL) {
+    recognizer->engine = engine;
+  }
+
+  return recognizer;
+}
+
+int lager_recognizer_add_template(lager_recognizer* recognizer,
+                                  const char* name, const char* lager) {
+  if (recognizer == NULL || name == NULL || lager == NULL || name[0] == '\0'
+      || lager[0] == '\0') {
+    return -1;
+  }
+
+  // Encoded outside the lock, which recognitions also take
+  ApiTemplate gesture_template;
+  PrepareLagerTemplate(string(lager), gesture_template);
+
+  std::lock_guard<std::mutex> lock(recognizer->mutex);
+  recognizer->names.push_back(name);
+  gesture_template.name = recognizer->names.back().c_str();
+  recognizer->templates.push_back(gesture_template);
+
+  return recognizer->templates.size() - 1;
+}
+
+int lager_recognizer_recognize(lager_recognizer* recognizer,
+                               const char* lager, lager_result* results,
+                               int max_results) {
+  if (recognizer == NULL || lager == NULL || lager[0] == '\0') {
+    return -1;
+  }
+
+  if (results == NULL || max_results <= 0) {
+    return 0;
+  }
+
+  // Reused between recognitions so that steady state ranking does not
+  // allocate
+  static thread_local string input_lager;
+  static thread_local vector<LagerTemplateScore> closest;
+
+  shared_ptr<const vector<ApiTemplate> > templates =
+      GetTemplateSnapshot(recognizer);
+
+  input_lager.assign(lager);
+  RankLagerTemplates(*templates, input_lager,
+                     recognizer->engine == LAGER_ENGINE_RUN_LENGTH,
+                     max_results, false,
+                     [](const ApiTemplate&) { return true; },
+                     closest);
+
+  int threshold_pct = GetLagerDistanceThresholdPct(input_lager);
+  for (size_t i = 0; i < closest.size(); i++) {
+    results[i].template_id = closest[i].gesture_index;
+    results[i].name = (*templates)[closest[i].gesture_index].name;
+    results[i].distance_pct = closest[i].distance_pct;
+    results[i].match = closest[i].distance_pct <= threshold_pct;
+  }
+
+  return closest.size();
+}
+
+void lager_recognizer_destroy(lager_recognizer* recognizer) {
+  delete recognizer;
+}
@@ -0,0 +1,81 @@
+/*
+ * lager_recognizer_api.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_RECOGNIZER_API_H_
+#define LAGER_RECOGNIZER_API_H_
+
+/*
+ * C interface to the LaGeR recognition core, for applications that want to
+ * recognize gestures in process instead of going through lager_recognizer.
+ * It does not depend on OSVR, Python or the subscription queues, and is built
+ * into liblager_distance.
+ *
+ * Every function can be called from several threads at once on the same
+ * recognizer, except lager_recognizer_destroy(), which must not overlap any
+ * other call on that recognizer.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Opaque recognizer handle */
+typedef struct lager_recognizer lager_recognizer;
+
+/** Distance used to compare LaGeR strings */
+typedef enum {
+  /** Damerau-Levenshtein distance over strings expanded to the same length */
+  LAGER_ENGINE_DAMERAU_LEVENSHTEIN = 0,
+  /** Run-length distance, much faster on long gestures */
+  LAGER_ENGINE_RUN_LENGTH = 1
+} lager_engine;
+
+/** Template matched by lager_recognizer_recognize() */
+typedef struct {
+  /** Identifier returned by lager_recognizer_add_template() */
+  int template_id;
+  /** Name of the template, valid until the recognizer is destroyed */
+  const char* name;
+  /** Distance to the input as a percentage of the template length */
+  float distance_pct;
+  /** Whether the distance is within the threshold for the input */
+  int match;
+} lager_result;
+
+/**
+ * Takes the distance to use and returns a new recognizer without templates,
+ * or NULL if it could not be created.
+ */
+lager_recognizer* lager_recognizer_create(lager_engine engine);
+
+/**
+ * Takes a recognizer, a gesture name and its LaGeR string, and adds it as a
+ * template. Returns the identifier of the template, or -1 if the name or
+ * string are empty.
+ */
+int lager_recognizer_add_template(lager_recognizer* recognizer,
+                                  const char* name, const char* lager);
+
+/**
+ * Takes a recognizer, a LaGeR string and an array of max_results results,
+ * and fills it with the templates closest to the string, sorted from closest
+ * to farthest. Returns the number of results filled, or -1 if the string is
+ * empty.
+ */
+int lager_recognizer_recognize(lager_recognizer* recognizer,
+                               const char* lager, lager_result* results,
+                               int max_results);
+
+/**
+ * Takes a recognizer and frees it along with its templates.
+ */
+void lager_recognizer_destroy(lager_recognizer* recognizer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LAGER_RECOGNIZER_API_H_ */
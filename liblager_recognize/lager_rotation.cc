@@ -0,0 +1,59 @@
+/*
+ * lager_rotation.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <stdlib.h>  // for abs
+
+#include "lager_rotation.h"
+
+void RotateLagerString(const string& lager, unsigned int rotation,
+                       string& rotated_lager) {
+  const LagerRotation& letter_rotation =
+      lager_rotation_table.rotations[rotation];
+
+  rotated_lager.resize(lager.length());
+  for (size_t i = 0; i < lager.length(); i++) {
+    unsigned int letter = GetLagerLetterIndex(lager[i]);
+    rotated_lager[i] = (letter < NUM_LAGER_LETTERS) ?
+        letter_rotation.letters[letter] : lager[i];
+  }
+}
+
+void ComputeRotatedHistogramLanes(const unsigned int* counts, size_t num_bins,
+                                  int* lanes) {
+  for (size_t bin = 0; bin < num_bins; bin++) {
+    for (unsigned int rotation = 0; rotation < NUM_LAGER_ROTATIONS;
+        rotation++) {
+      size_t rotated_bin = bin;
+      if (bin < NUM_LAGER_LETTERS) {
+        rotated_bin = GetLagerLetterIndex(
+            lager_rotation_table.rotations[rotation].letters[bin]);
+      }
+      lanes[rotated_bin * NUM_LAGER_ROTATIONS + rotation] = counts[bin];
+    }
+  }
+}
+
+void GetRotatedHistogramDistances(const int* input_lanes, int input_factor,
+                                  const unsigned int* gesture_counts,
+                                  int gesture_factor, size_t num_bins,
+                                  int* distances) {
+  int lane_distances[NUM_LAGER_ROTATIONS] = { 0 };
+
+  for (size_t bin = 0; bin < num_bins; bin++) {
+    const int* bin_lanes = &input_lanes[bin * NUM_LAGER_ROTATIONS];
+    int gesture_count = gesture_counts[bin] * gesture_factor;
+
+    for (unsigned int rotation = 0; rotation < NUM_LAGER_ROTATIONS;
+        rotation++) {
+      lane_distances[rotation] += abs(bin_lanes[rotation] * input_factor
+          - gesture_count);
+    }
+  }
+
+  for (unsigned int rotation = 0; rotation < NUM_LAGER_ROTATIONS; rotation++) {
+    distances[rotation] = lane_distances[rotation];
+  }
+}
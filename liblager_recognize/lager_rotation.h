@@ -0,0 +1,269 @@
+/*
+ * lager_rotation.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_ROTATION_H_
+#define LAGER_ROTATION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+using std::string;
+
+/// Number of axis-aligned rotations of a cube, the identity included
+#define NUM_LAGER_ROTATIONS 24
+/// Number of LaGeR direction letters, plus '_' for a sensor that did not move
+#define NUM_LAGER_LETTERS 27
+/// Index of '_' in the rotation tables; 'a' to 'z' take indexes 0 to 25
+#define LAGER_NO_MOVEMENT_INDEX 26
+
+/// Rotation set that only contains the identity
+#define LAGER_ROTATIONS_IDENTITY 0x1u
+/// Rotation set that contains every axis-aligned rotation
+#define LAGER_ROTATIONS_ALL ((1u << NUM_LAGER_ROTATIONS) - 1)
+
+/*
+ * The LaGeR alphabet names the 26 directions from the center of a cube to its
+ * faces, edges and corners, using the same theta and phi layout as
+ * letter_coordinates.h: 'a' is the top pole, 'b' to 'i' the upper ring, 'j' to
+ * 'q' the equator, 'r' to 'y' the lower ring and 'z' the bottom pole, each
+ * ring starting at phi 0 and going around in 45 degree steps. The alphabet is
+ * closed under the 24 rotations that map the cube onto itself, so each of them
+ * is a permutation of the letters.
+ *
+ * The functions below derive those permutations from the letter angles so that
+ * the tables are built by the compiler.
+ */
+
+/**
+ * Takes a letter index and returns its polar angle in degrees.
+ */
+constexpr int GetLagerLetterTheta(unsigned int letter) {
+  return (letter == 0) ? 0 :
+         (letter <= 8) ? 45 :
+         (letter <= 16) ? 90 :
+         (letter <= 24) ? 135 : 180;
+}
+
+/**
+ * Takes a letter index and returns its azimuthal angle in degrees.
+ */
+constexpr int GetLagerLetterPhi(unsigned int letter) {
+  return (letter == 0 || letter >= 25) ? 0 : ((letter - 1) % 8) * 45;
+}
+
+/**
+ * Takes an angle in degrees, multiple of 45, and returns the sign of its
+ * cosine.
+ */
+constexpr int GetCosineSign(int degrees) {
+  return (degrees % 360 < 90 || degrees % 360 > 270) ? 1 :
+         (degrees % 360 == 90 || degrees % 360 == 270) ? 0 : -1;
+}
+
+/**
+ * Takes an angle in degrees, multiple of 45, and returns the sign of its sine.
+ */
+constexpr int GetSineSign(int degrees) {
+  return GetCosineSign(degrees + 270);
+}
+
+/**
+ * Takes a letter index and an axis (0 for X, 1 for Y, 2 for Z), and returns
+ * the component of the letter's direction along that axis, in {-1, 0, 1}.
+ */
+constexpr int GetLagerLetterComponent(unsigned int letter, unsigned int axis) {
+  return (letter == LAGER_NO_MOVEMENT_INDEX) ? 0 :
+         (axis == 2) ? GetCosineSign(GetLagerLetterTheta(letter)) :
+         (axis == 0) ?
+             GetSineSign(GetLagerLetterTheta(letter))
+                 * GetCosineSign(GetLagerLetterPhi(letter)) :
+             GetSineSign(GetLagerLetterTheta(letter))
+                 * GetSineSign(GetLagerLetterPhi(letter));
+}
+
+/**
+ * Takes a rotation index and a rotated axis, and returns the original axis it
+ * takes its component from. Rotation r uses axis permutation r / 4.
+ */
+constexpr unsigned int GetRotationSourceAxis(unsigned int rotation,
+                                             unsigned int axis) {
+  return ((rotation / 4 == 0) ? 0x210u :
+          (rotation / 4 == 1) ? 0x120u :
+          (rotation / 4 == 2) ? 0x201u :
+          (rotation / 4 == 3) ? 0x021u :
+          (rotation / 4 == 4) ? 0x102u : 0x012u) >> (4 * axis) & 0xF;
+}
+
+/**
+ * Takes a rotation index and a rotated axis, and returns the sign applied to
+ * that component. The third sign follows from the other two and the parity of
+ * the axis permutation, so that every rotation has determinant +1.
+ */
+constexpr int GetRotationAxisSign(unsigned int rotation, unsigned int axis) {
+  return (axis == 0) ? ((rotation & 1) ? -1 : 1) :
+         (axis == 1) ? ((rotation & 2) ? -1 : 1) :
+         GetRotationAxisSign(rotation, 0) * GetRotationAxisSign(rotation, 1)
+             * ((rotation / 4 == 1 || rotation / 4 == 2 || rotation / 4 == 5) ?
+                 -1 : 1);
+}
+
+/**
+ * Takes a rotation index, a letter index and an axis, and returns the
+ * component of the rotated letter's direction along that axis.
+ */
+constexpr int GetRotatedComponent(unsigned int rotation, unsigned int letter,
+                                  unsigned int axis) {
+  return GetRotationAxisSign(rotation, axis)
+      * GetLagerLetterComponent(letter, GetRotationSourceAxis(rotation, axis));
+}
+
+/**
+ * Takes a direction and returns the index of the letter that names it,
+ * searching from a given letter index onwards.
+ */
+constexpr unsigned int FindLagerLetter(int x, int y, int z,
+                                       unsigned int letter = 0) {
+  return (letter >= NUM_LAGER_LETTERS) ? LAGER_NO_MOVEMENT_INDEX :
+         (GetLagerLetterComponent(letter, 0) == x
+             && GetLagerLetterComponent(letter, 1) == y
+             && GetLagerLetterComponent(letter, 2) == z) ?
+             letter : FindLagerLetter(x, y, z, letter + 1);
+}
+
+/**
+ * Takes a letter index and returns the character it stands for.
+ */
+constexpr char GetLagerLetterCharacter(unsigned int letter) {
+  return (letter == LAGER_NO_MOVEMENT_INDEX) ? '_' : (char) ('a' + letter);
+}
+
+/**
+ * Takes a rotation index and a letter index, and returns the character of the
+ * rotated letter.
+ */
+constexpr char GetRotatedLetter(unsigned int rotation, unsigned int letter) {
+  return GetLagerLetterCharacter(
+      FindLagerLetter(GetRotatedComponent(rotation, letter, 0),
+                      GetRotatedComponent(rotation, letter, 1),
+                      GetRotatedComponent(rotation, letter, 2)));
+}
+
+/**
+ * Compile-time sequence of indexes, used to expand the tables below.
+ */
+template<unsigned int... Indexes>
+struct LagerIndexSequence {
+};
+
+/**
+ * Builds a LagerIndexSequence from 0 to N - 1.
+ */
+template<unsigned int N, unsigned int... Indexes>
+struct MakeLagerIndexSequence : MakeLagerIndexSequence<N - 1, N - 1,
+    Indexes...> {
+};
+
+template<unsigned int... Indexes>
+struct MakeLagerIndexSequence<0, Indexes...> {
+  typedef LagerIndexSequence<Indexes...> type;
+};
+
+/**
+ * Letter permutation for a single rotation.
+ */
+struct LagerRotation {
+  /// Rotated character for each letter index
+  char letters[NUM_LAGER_LETTERS];
+};
+
+/**
+ * Letter permutations for every rotation.
+ */
+struct LagerRotationTable {
+  /// Permutation for each rotation index; rotation 0 is the identity
+  LagerRotation rotations[NUM_LAGER_ROTATIONS];
+};
+
+template<unsigned int... Letters>
+constexpr LagerRotation MakeLagerRotation(unsigned int rotation,
+                                          LagerIndexSequence<Letters...>) {
+  return LagerRotation { { GetRotatedLetter(rotation, Letters)... } };
+}
+
+template<unsigned int... Rotations>
+constexpr LagerRotationTable MakeLagerRotationTable(
+    LagerIndexSequence<Rotations...>) {
+  return LagerRotationTable { { MakeLagerRotation(
+      Rotations, MakeLagerIndexSequence<NUM_LAGER_LETTERS>::type())... } };
+}
+
+/**
+ * Letter permutations for the 24 axis-aligned rotations, built at compile
+ * time.
+ */
+constexpr LagerRotationTable lager_rotation_table = MakeLagerRotationTable(
+    MakeLagerIndexSequence<NUM_LAGER_ROTATIONS>::type());
+
+/**
+ * Takes a letter character and returns the mask of the rotations that leave
+ * it in place, starting from a given rotation index.
+ */
+constexpr uint32_t GetLagerRotationsKeeping(char letter,
+                                            unsigned int rotation = 0) {
+  return (rotation >= NUM_LAGER_ROTATIONS) ? 0 :
+      ((lager_rotation_table.rotations[rotation].letters[letter - 'a']
+          == letter) ? (1u << rotation) : 0)
+          | GetLagerRotationsKeeping(letter, rotation + 1);
+}
+
+/// Rotation set about the vertical axis, for sensors held facing another way
+#define LAGER_ROTATIONS_VERTICAL_AXIS GetLagerRotationsKeeping('a')
+
+static_assert(GetRotatedLetter(0, 2) == 'c', "Rotation 0 must be the identity");
+static_assert(GetLagerRotationsKeeping('a') != LAGER_ROTATIONS_IDENTITY,
+              "Rotations about the vertical axis must keep the top pole");
+
+/**
+ * Takes a LaGeR character and returns its index in the rotation tables, or
+ * NUM_LAGER_LETTERS for characters that are not rotated, such as '.'.
+ */
+inline unsigned int GetLagerLetterIndex(char lager_character) {
+  if (lager_character >= 'a' && lager_character <= 'z') {
+    return lager_character - 'a';
+  } else if (lager_character == '_') {
+    return LAGER_NO_MOVEMENT_INDEX;
+  }
+  return NUM_LAGER_LETTERS;
+}
+
+/**
+ * Takes a LaGeR string and a rotation index, and stores the rotated string in
+ * the output parameter, reusing its buffer.
+ */
+void RotateLagerString(const string& lager, unsigned int rotation,
+                       string& rotated_lager);
+
+/**
+ * Takes a histogram with one bin per letter index followed by bins that are
+ * not rotated, and fills lanes with num_bins rows of NUM_LAGER_ROTATIONS
+ * counts each: row b holds, for every rotation, the count that lands on bin b
+ * once the string is rotated.
+ */
+void ComputeRotatedHistogramLanes(const unsigned int* counts, size_t num_bins,
+                                  int* lanes);
+
+/**
+ * Takes the rotated histogram lanes of the input and a gesture histogram,
+ * scaled by their expansion factors, and stores the L1 distance between them
+ * for every rotation at once. The inner loop runs across rotations so that
+ * the compiler can vectorize it.
+ */
+void GetRotatedHistogramDistances(const int* input_lanes, int input_factor,
+                                  const unsigned int* gesture_counts,
+                                  int gesture_factor, size_t num_bins,
+                                  int* distances);
+
+#endif /* LAGER_ROTATION_H_ */
@@ -0,0 +1,310 @@
+/*
+ * lager_run_length.cc
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>  // for std::max, std::min
+using std::max;
+using std::min;
+#include <sstream>
+using std::stringstream;
+
+#include "lager_run_length.h"
+
+#define LAGER_MOVEMENT_SEPARATOR '.'
+
+LagerSymbol EncodeLagerSymbol(const char* letters, size_t num_letters) {
+  LagerSymbol symbol = 0;
+
+  for (size_t i = 0; i < num_letters; i++) {
+    LagerSymbol letter = (unsigned char) letters[i];
+    if (i < MAX_LAGER_SYMBOL_LETTERS) {
+      symbol |= letter << (8 * i);
+    } else {
+      // Fold extra letters in so that distinct movements stay distinct
+      symbol = (symbol ^ letter) * 0x100000001b3ULL;
+    }
+  }
+
+  return symbol;
+}
+
+unsigned int GetSymbolDistance(LagerSymbol a, LagerSymbol b) {
+  LagerSymbol difference = a ^ b;
+  unsigned int distance = 0;
+
+  while (difference != 0) {
+    if ((difference & 0xFF) != 0) {
+      distance++;
+    }
+    difference >>= 8;
+  }
+
+  return distance;
+}
+
+void EncodeRunLengthLager(const string& lager, RunLengthLager& encoded) {
+  encoded.runs.clear();
+  encoded.num_movements = 0;
+  encoded.symbol_width = 0;
+
+  size_t movement_start = 0;
+  while (movement_start < lager.length()) {
+    size_t movement_end = lager.find(LAGER_MOVEMENT_SEPARATOR, movement_start);
+    if (movement_end == string::npos) {
+      movement_end = lager.length();
+    }
+
+    size_t num_letters = movement_end - movement_start;
+    if (num_letters > 0) {
+      LagerSymbol symbol = EncodeLagerSymbol(&lager[movement_start],
+                                             num_letters);
+      if (!encoded.runs.empty() && encoded.runs.back().symbol == symbol) {
+        encoded.runs.back().count++;
+      } else {
+        LagerRun run = { symbol, 1 };
+        encoded.runs.push_back(run);
+      }
+      encoded.num_movements++;
+      encoded.symbol_width = max(encoded.symbol_width,
+                                 (unsigned int) num_letters);
+    }
+
+    movement_start = movement_end + 1;
+  }
+}
+
+string DecodeRunLengthLager(const RunLengthLager& encoded) {
+  stringstream lager;
+
+  for (vector<LagerRun>::const_iterator it = encoded.runs.begin();
+      it < encoded.runs.end(); ++it) {
+    for (unsigned int i = 0; i < it->count; i++) {
+      for (unsigned int j = 0;
+          j < MAX_LAGER_SYMBOL_LETTERS && (it->symbol >> (8 * j)) != 0; j++) {
+        lager << (char) ((it->symbol >> (8 * j)) & 0xFF);
+      }
+      lager << LAGER_MOVEMENT_SEPARATOR;
+    }
+  }
+
+  return lager.str();
+}
+
+/* Scratch buffers reused across calls so that steady state scoring does not
+ * allocate. They are thread-local so that several threads can score at once.
+ */
+static thread_local vector<int> t_boundary_row;
+static thread_local vector<int> t_left_column;
+static thread_local vector<int> t_right_column;
+static thread_local vector<int> t_top_row;
+static thread_local vector<int> t_bottom_row;
+static thread_local vector<int> t_shifted_top;
+static thread_local vector<int> t_shifted_left;
+static thread_local vector<int> t_suffix_min;
+static thread_local vector<int> t_window;
+
+/*
+ * Takes a vector and fills suffix_min with min(values[i..size-1]) for every i.
+ */
+static void ComputeSuffixMinimums(const vector<int>& values, int size,
+                                  vector<int>& suffix_min) {
+  suffix_min[size - 1] = values[size - 1];
+  for (int i = size - 2; i >= 0; i--) {
+    suffix_min[i] = min(values[i], suffix_min[i + 1]);
+  }
+}
+
+/*
+ * Computes the bottom (or right) boundary of a block where a run of p
+ * movements meets a run of q different movements.
+ *
+ * Inside such a block, reaching cell (i, j) from boundary cell (i0, j0) costs
+ * substitution_cost * min(di, dj) + indel_cost * |di - dj|. Because adjacent
+ * cells of the table never differ by more than indel_cost, only a window of
+ * width p + 1 of the opposite boundary and a suffix of the adjacent boundary
+ * can hold the minimum, which keeps the work linear in p + q.
+ */
+static void ComputeMismatchBoundary(const vector<int>& shifted_opposite,
+                                    const vector<int>& adjacent_suffix_min,
+                                    int p, int q, int substitution_cost,
+                                    int indel_cost, vector<int>& output) {
+  int slope = indel_cost - substitution_cost;
+  int window_head = 0;
+  int window_tail = 0;
+
+  for (int j = 0; j <= q; j++) {
+    // Slide a monotone window over shifted_opposite[max(0, j - p) .. j]
+    while (window_tail > window_head
+        && shifted_opposite[t_window[window_tail - 1]] >= shifted_opposite[j]) {
+      window_tail--;
+    }
+    t_window[window_tail++] = j;
+    while (t_window[window_head] < j - p) {
+      window_head++;
+    }
+
+    int from_opposite = shifted_opposite[t_window[window_head]]
+        + indel_cost * p - slope * j;
+    int from_adjacent = adjacent_suffix_min[max(0, p - j)]
+        + indel_cost * (j - p) + substitution_cost * p;
+    output[j] = min(from_opposite, from_adjacent);
+  }
+}
+
+/*
+ * Takes the top row and left column of a block where a run of p source
+ * movements meets a run of q target movements, and computes its bottom row and
+ * right column.
+ */
+static void ComputeBlockBoundaries(int p, int q, int substitution_cost,
+                                   int indel_cost) {
+  if (substitution_cost == 0) {
+    // Matching runs: the optimal path always follows the diagonal
+    for (int j = 0; j <= q; j++) {
+      t_bottom_row[j] = (j >= p) ? t_top_row[j - p] : t_left_column[p - j];
+    }
+    for (int i = 0; i <= p; i++) {
+      t_right_column[i] = (i >= q) ? t_left_column[i - q] : t_top_row[q - i];
+    }
+    return;
+  }
+
+  int slope = indel_cost - substitution_cost;
+  for (int j = 0; j <= q; j++) {
+    t_shifted_top[j] = t_top_row[j] + slope * j;
+  }
+  for (int i = 0; i <= p; i++) {
+    t_shifted_left[i] = t_left_column[i] + slope * i;
+  }
+
+  ComputeSuffixMinimums(t_shifted_left, p + 1, t_suffix_min);
+  ComputeMismatchBoundary(t_shifted_top, t_suffix_min, p, q,
+                          substitution_cost, indel_cost, t_bottom_row);
+
+  ComputeSuffixMinimums(t_shifted_top, q + 1, t_suffix_min);
+  ComputeMismatchBoundary(t_shifted_left, t_suffix_min, q, p,
+                          substitution_cost, indel_cost, t_right_column);
+}
+
+int RunLengthEditDistance(const RunLengthLager& source,
+                          unsigned int source_factor,
+                          const RunLengthLager& target,
+                          unsigned int target_factor, int indel_cost) {
+  int source_length = source.num_movements * source_factor;
+  int target_length = target.num_movements * target_factor;
+
+  if (source_length == 0 || target_length == 0) {
+    return (source_length + target_length) * indel_cost;
+  }
+
+  int longest_run = 0;
+  for (vector<LagerRun>::const_iterator it = source.runs.begin();
+      it < source.runs.end(); ++it) {
+    longest_run = max(longest_run, (int) (it->count * source_factor));
+  }
+  for (vector<LagerRun>::const_iterator it = target.runs.begin();
+      it < target.runs.end(); ++it) {
+    longest_run = max(longest_run, (int) (it->count * target_factor));
+  }
+
+  size_t row_size = target_length + 1;
+  size_t block_size = longest_run + 1;
+  if (t_boundary_row.size() < row_size) {
+    t_boundary_row.resize(row_size);
+  }
+  if (t_top_row.size() < block_size) {
+    t_left_column.resize(block_size);
+    t_right_column.resize(block_size);
+    t_top_row.resize(block_size);
+    t_bottom_row.resize(block_size);
+    t_shifted_top.resize(block_size);
+    t_shifted_left.resize(block_size);
+    t_suffix_min.resize(block_size);
+    t_window.resize(block_size);
+  }
+
+  // Row 0 of the table: transforming an empty source into the target prefix
+  for (int j = 0; j <= target_length; j++) {
+    t_boundary_row[j] = j * indel_cost;
+  }
+
+  int row_offset = 0;
+  for (vector<LagerRun>::const_iterator source_run = source.runs.begin();
+      source_run < source.runs.end(); ++source_run) {
+    int p = source_run->count * source_factor;
+
+    // Column 0 of the table: deleting the whole source prefix
+    for (int i = 0; i <= p; i++) {
+      t_left_column[i] = (row_offset + i) * indel_cost;
+    }
+
+    int column_offset = 0;
+    for (vector<LagerRun>::const_iterator target_run = target.runs.begin();
+        target_run < target.runs.end(); ++target_run) {
+      int q = target_run->count * target_factor;
+      int substitution_cost = min(
+          (int) GetSymbolDistance(source_run->symbol, target_run->symbol),
+          2 * indel_cost);
+
+      // The shared corner was already overwritten by the previous block
+      t_top_row[0] = t_left_column[0];
+      for (int j = 1; j <= q; j++) {
+        t_top_row[j] = t_boundary_row[column_offset + j];
+      }
+
+      ComputeBlockBoundaries(p, q, substitution_cost, indel_cost);
+
+      for (int j = 1; j <= q; j++) {
+        t_boundary_row[column_offset + j] = t_bottom_row[j];
+      }
+      t_left_column.swap(t_right_column);
+      column_offset += q;
+    }
+
+    row_offset += p;
+  }
+
+  return t_boundary_row[target_length];
+}
+
+/*
+ * Returns the greatest common divisor of two numbers.
+ */
+static unsigned int GreatestCommonDivisor(unsigned int a, unsigned int b) {
+  while (b != 0) {
+    unsigned int remainder = a % b;
+    a = b;
+    b = remainder;
+  }
+  return a;
+}
+
+int RunLengthLagerDistance(const RunLengthLager& input_gesture,
+                           const RunLengthLager& subscribed_gesture,
+                           float& distance_pct) {
+  unsigned int input_length = input_gesture.num_movements;
+  unsigned int subscribed_length = subscribed_gesture.num_movements;
+
+  if (input_length == 0 || subscribed_length == 0) {
+    distance_pct = (input_length == subscribed_length) ? 0.0f : 100.0f;
+    return max(input_length, subscribed_length);
+  }
+
+  unsigned int least_common_multiple = input_length
+      / GreatestCommonDivisor(input_length, subscribed_length)
+      * subscribed_length;
+
+  // A movement and its dot are inserted or deleted as a whole
+  int indel_cost = max(input_gesture.symbol_width,
+                       subscribed_gesture.symbol_width) + 1;
+
+  int distance = RunLengthEditDistance(
+      input_gesture, least_common_multiple / input_length, subscribed_gesture,
+      least_common_multiple / subscribed_length, indel_cost);
+
+  distance_pct = (distance * 100.0f) / (least_common_multiple * indel_cost);
+
+  return distance;
+}
@@ -0,0 +1,106 @@
+/*
+ * lager_run_length.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LAGER_RUN_LENGTH_H_
+#define LAGER_RUN_LENGTH_H_
+
+#include <stdint.h>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+/// Maximum number of sensor letters that are packed exactly into a symbol
+#define MAX_LAGER_SYMBOL_LETTERS 8
+
+/**
+ * A single LaGeR movement (the sensor letters between two dots) packed into
+ * an integer, one byte per sensor letter. The first sensor's letter is stored
+ * in the lowest byte.
+ */
+typedef uint64_t LagerSymbol;
+
+/**
+ * Describes a run of identical consecutive LaGeR movements.
+ */
+struct LagerRun {
+  /// Movement that is repeated
+  LagerSymbol symbol;
+  /// Number of consecutive repetitions of the movement
+  unsigned int count;
+};
+
+/**
+ * Run-length representation of a LaGeR string.
+ *
+ * For example, "_x._x._x._a._a." is stored as {("_x", 3), ("_a", 2)}.
+ */
+struct RunLengthLager {
+  /// Runs of identical movements, in gesture order
+  vector<LagerRun> runs;
+  /// Number of movements in the expanded gesture
+  unsigned int num_movements = 0;
+  /// Largest number of sensor letters found in a single movement
+  unsigned int symbol_width = 0;
+};
+
+/**
+ * Takes the sensor letters of a single movement and packs them into a
+ * LagerSymbol. Letters beyond MAX_LAGER_SYMBOL_LETTERS are folded into the
+ * symbol by hashing, so they still take part in equality comparisons.
+ */
+LagerSymbol EncodeLagerSymbol(const char* letters, size_t num_letters);
+
+/**
+ * Takes two symbols and returns the number of sensor letters in which they
+ * differ.
+ */
+unsigned int GetSymbolDistance(LagerSymbol a, LagerSymbol b);
+
+/**
+ * Takes a LaGeR string and stores its run-length representation in the
+ * encoded parameter. The runs vector is reused, so encoding into the same
+ * structure repeatedly does not allocate once its capacity is large enough.
+ */
+void EncodeRunLengthLager(const string& lager, RunLengthLager& encoded);
+
+/**
+ * Takes a run-length representation and returns the equivalent LaGeR string.
+ */
+string DecodeRunLengthLager(const RunLengthLager& encoded);
+
+/**
+ * Calculates the edit distance between two run-length gestures whose run
+ * counts are multiplied by the given expansion factors, without expanding
+ * them.
+ *
+ * Inserting or deleting a movement costs indel_cost, and substituting a
+ * movement costs the number of sensor letters that differ. The result is the
+ * same as running the full dynamic programming table over the expanded
+ * movement sequences, but only the boundaries between pairs of runs are
+ * computed, so the work is proportional to
+ * (source runs * target length + target runs * source length) instead of
+ * (source length * target length).
+ */
+int RunLengthEditDistance(const RunLengthLager& source,
+                          unsigned int source_factor,
+                          const RunLengthLager& target,
+                          unsigned int target_factor, int indel_cost);
+
+/**
+ * Takes an input gesture and a subscribed gesture, expands both to the least
+ * common multiple of their movement counts and returns their edit distance.
+ *
+ * The distance is expressed in character operations over the expanded LaGeR
+ * strings (a whole movement, including its dot, costs as much as its length
+ * to insert or delete), so distance_pct is comparable to the percentages
+ * computed by the Damerau-Levenshtein recognizer.
+ */
+int RunLengthLagerDistance(const RunLengthLager& input_gesture,
+                           const RunLengthLager& subscribed_gesture,
+                           float& distance_pct);
+
+#endif /* LAGER_RUN_LENGTH_H_ */
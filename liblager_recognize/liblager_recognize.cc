@@ -5,8 +5,9 @@
  *      Author: Andrés Odio
  */
 
-#include <algorithm>  // for std::min_element
-using std::min_element;
+#include <algorithm>  // for std::sort, std::unique, std::binary_search,
+                       // std::rotate
+#include <stdlib.h>   // for abs
 #include <boost/math/common_factor.hpp>
 #include <chrono>
 using std::chrono::duration;
@@ -26,7 +27,6 @@ using std::setprecision;
 
 #include "liblager_connect.h"
 #include "liblager_recognize.h"
-#include "string_tokenizer.h"
 
 LagerRecognizer* LagerRecognizer::instance_ = NULL;
 
@@ -38,129 +38,391 @@ LagerRecognizer* LagerRecognizer::Instance(vector<struct SubscribedGesture>* sub
   return instance_;
 }
 
-#define d(i,j) dd[(i) * (m+2) + (j) ]
-#define min(x,y) ((x) < (y) ? (x) : (y))
-#define min3(a,b,c) ((a)< (b) ? min((a),(c)) : min((b),(c)))
-#define min4(a,b,c,d) ((a)< (b) ? min3((a),(c),(d)) : min3((b),(c),(d)))
+void LagerRecognizer::ScoreGesture(size_t gesture_index,
+                                   const string& current_gesture,
+                                   const RunLengthLager& run_length_input,
+                                   int& distance, float& distance_pct) {
+  if (distance_engine_ == LRDistanceEngine::run_length) {
+    distance = RunLengthLagerDistance(run_length_input,
+                                      run_length_gestures_[gesture_index],
+                                      distance_pct);
+    return;
+  }
 
-/* Calculates the Damerau-Levenshtein distance between two strings.
- * Based on implementation at: http://stackoverflow.com/a/10741694
- */
-int DLDistance(const char *s, const char* t, int n, int m) {
-  int *dd, *DA;
-  int i, j, cost, k, i1, j1, DB;
-  int infinity = n + m;
-
-  DA = (int*) malloc(256 * sizeof(int));
-  dd = (int*) malloc((n + 2) * (m + 2) * sizeof(int));
-
-  d(0,0)= infinity;
-  for (i = 0; i < n + 1; i++) {
-    d(i+1,1)= i;
-    d(i+1,0) = infinity;
-  }
-  for (j = 0; j < m + 1; j++) {
-    d(1,j+1)= j;
-    d(0,j+1) = infinity;
-  }
-  for (k = 0; k < 256; k++)
-    DA[k] = 0;
-  for (i = 1; i < n + 1; i++) {
-    DB = 0;
-    for (j = 1; j < m + 1; j++) {
-      i1 = DA[t[j - 1]];
-      j1 = DB;
-      cost = ((s[i - 1] == t[j - 1]) ? 0 : 1);
-      if (cost == 0)
-        DB = j;
-      d(i+1,j+1)=
-      min4(d(i,j)+cost,
-          d(i+1,j) + 1,
-          d(i,j+1)+1,
-          d(i1,j1) + (i-i1-1) + 1 + (j-j1-1));
+  distance = LagerDistance(current_gesture,
+                           (*subscribed_gestures_)[gesture_index].lager,
+                           distance_pct);
+}
+
+void LagerRecognizer::SetRotations(uint32_t rotation_mask) {
+  rotation_mask_ = (rotation_mask | LAGER_ROTATIONS_IDENTITY)
+      & LAGER_ROTATIONS_ALL;
+
+  rotations_.clear();
+  for (unsigned int rotation = 0; rotation < NUM_LAGER_ROTATIONS; rotation++) {
+    if (rotation_mask_ & (1u << rotation)) {
+      rotations_.push_back(rotation);
     }
-    DA[s[i - 1]] = i;
   }
-  cost = d(n + 1, m + 1);
-  free(dd);
-  return cost;
+
+  rotated_inputs_.resize(NUM_LAGER_ROTATIONS);
+  rotated_run_length_inputs_.resize(NUM_LAGER_ROTATIONS);
 }
 
-/* New size must be a multiple of the original string size */
-string ExpandString(const string& input_string, int new_size) {
-  stringstream output_string;
-  int length_multiplier = new_size / input_string.length();
+void LagerRecognizer::RotateInput(
+    const string& current_gesture,
+    const struct LagerHistogram& input_histogram) {
+  for (vector<unsigned int>::iterator it = rotations_.begin();
+      it < rotations_.end(); ++it) {
+    RotateLagerString(current_gesture, *it, rotated_inputs_[*it]);
+    if (distance_engine_ == LRDistanceEngine::run_length) {
+      EncodeRunLengthLager(rotated_inputs_[*it],
+                           rotated_run_length_inputs_[*it]);
+    }
+  }
 
-  vector<string> movement_pairs;
-  TokenizeString(input_string, movement_pairs, ".");
+  ComputeRotatedHistogramLanes(input_histogram.counts, LAGER_HISTOGRAM_BINS,
+                               rotated_histogram_lanes_);
+}
 
-  for (vector<string>::iterator it = movement_pairs.begin();
-      it < movement_pairs.end(); ++it) {
-    for (int i = 0; i < length_multiplier; i++) {
-      output_string << *it << ".";
+void LagerRecognizer::ScoreRotatedGesture(
+    size_t gesture_index, struct RecognitionCandidate& candidate) {
+  const float* lower_bounds = &rotation_lower_bounds_[gesture_index
+      * NUM_LAGER_ROTATIONS];
+
+  // Insertion sort: there are at most 24 rotations, mostly in order already
+  rotation_order_ = rotations_;
+  for (size_t i = 1; i < rotation_order_.size(); i++) {
+    unsigned int rotation = rotation_order_[i];
+    size_t j = i;
+    for (; j > 0 && lower_bounds[rotation_order_[j - 1]]
+        > lower_bounds[rotation]; j--) {
+      rotation_order_[j] = rotation_order_[j - 1];
     }
+    rotation_order_[j] = rotation;
   }
 
-  return output_string.str();
+  for (size_t i = 0; i < rotation_order_.size(); i++) {
+    unsigned int rotation = rotation_order_[i];
+
+    // Rotations are sorted by lower bound, so none of the rest can do better
+    if (i > 0 && lower_bounds[rotation] >= candidate.distance_pct) {
+      break;
+    }
+
+    int distance;
+    float distance_pct;
+    ScoreGesture(gesture_index, rotated_inputs_[rotation],
+                 rotated_run_length_inputs_[rotation], distance,
+                 distance_pct);
+
+    if (i == 0 || distance_pct < candidate.distance_pct) {
+      candidate.distance = distance;
+      candidate.distance_pct = distance_pct;
+      candidate.rotation = rotation;
+    }
+  }
 }
 
-bool GestureEntryLessThan(SubscribedGesture i, SubscribedGesture j) {
-  return (i.distance_pct < j.distance_pct);
+void LagerRecognizer::EncodeNewSubscribedGestures() {
+  for (size_t i = run_length_gestures_.size(); i < subscribed_gestures_->size();
+      i++) {
+    const string& lager = (*subscribed_gestures_)[i].lager;
+
+    run_length_gestures_.push_back(RunLengthLager());
+    EncodeRunLengthLager(lager, run_length_gestures_.back());
+
+    gesture_histograms_.push_back(LagerHistogram());
+    ComputeLagerHistogram(lager, gesture_histograms_.back());
+  }
 }
 
-void LagerRecognizer::UpdateSubscribedGestureDistance(
-    struct SubscribedGesture& subscribed_gesture, string current_gesture) {
-  const string input_gesture = current_gesture;
+void LagerRecognizer::AddPluginGestures(
+    const struct LagerGesturePlugin& plugin) {
+  // Keeps the encodings aligned with the gestures that were already there
+  EncodeNewSubscribedGestures();
 
-  int gesture_length_least_common_multiple = boost::math::lcm(
-      input_gesture.length(), subscribed_gesture.lager.length());
+  for (size_t i = 0; i < plugin.num_gestures; i++) {
+    const struct LagerPluginGesture& gesture = plugin.gestures[i];
 
-  string expanded_input_string = ExpandString(
-      input_gesture, gesture_length_least_common_multiple);
-  subscribed_gesture.expanded_lager = ExpandString(
-      subscribed_gesture.lager, gesture_length_least_common_multiple);
+    SubscribedGesture new_gesture;
+    new_gesture.name = gesture.name;
+    new_gesture.lager = gesture.lager;
+    new_gesture.pid = 0;
+    subscribed_gestures_->push_back(new_gesture);
 
-  subscribed_gesture.distance = DLDistance(
-      expanded_input_string.c_str(), subscribed_gesture.expanded_lager.c_str(),
-      expanded_input_string.length(),
-      subscribed_gesture.expanded_lager.length());
+    run_length_gestures_.push_back(RunLengthLager());
+    DecodeLagerPluginGesture(gesture, run_length_gestures_.back());
+    gesture_histograms_.push_back(gesture.histogram);
+  }
+}
 
-  subscribed_gesture.distance_pct = (subscribed_gesture.distance * 100.0f)
-      / subscribed_gesture.expanded_lager.length();
+void LagerRecognizer::ReplaceWithPluginGestures(
+    const struct LagerGesturePlugin& plugin) {
+  subscribed_gestures_->clear();
+  run_length_gestures_.clear();
+  gesture_histograms_.clear();
+  ranking_.clear();
+  classifier_gesture_indexes_.clear();
+
+  // Forces the context lists to be rebuilt even if the counts match
+  context_gestures_.clear();
+  num_indexed_gestures_ = 0;
+  num_indexed_subscribers_ = 0;
+  active_gestures_stale_ = true;
+
+  AddPluginGestures(plugin);
 }
 
-void LagerRecognizer::UpdateSubscribedGestureDistances(string current_gesture) {
+void LagerRecognizer::UpdateActiveGestures() {
+  size_t num_subscribers = 0;
   for (vector<SubscribedGesture>::iterator it = subscribed_gestures_->begin();
       it < subscribed_gestures_->end(); ++it) {
-    UpdateSubscribedGestureDistance(*it, current_gesture);
+    num_subscribers += it->subscribers.size();
   }
+
+  if (num_subscribers != num_indexed_subscribers_
+      || subscribed_gestures_->size() != num_indexed_gestures_) {
+    context_gestures_.clear();
+
+    for (size_t i = 0; i < subscribed_gestures_->size(); i++) {
+      const vector<GestureSubscriber>& subscribers =
+          (*subscribed_gestures_)[i].subscribers;
+
+      // Gestures read from a file have no subscribers and are always active
+      if (subscribers.empty()) {
+        context_gestures_[""].push_back(i);
+      }
+
+      for (vector<GestureSubscriber>::const_iterator it = subscribers.begin();
+          it < subscribers.end(); ++it) {
+        vector<size_t>& gestures = context_gestures_[it->context];
+        if (gestures.empty() || gestures.back() != i) {
+          gestures.push_back(i);
+        }
+      }
+    }
+
+    num_indexed_subscribers_ = num_subscribers;
+    num_indexed_gestures_ = subscribed_gestures_->size();
+    active_gestures_stale_ = true;
+  }
+
+  if (!active_gestures_stale_) {
+    return;
+  }
+
+  active_gestures_ = context_gestures_[""];
+  for (vector<string>::iterator it = active_contexts_.begin();
+      it < active_contexts_.end(); ++it) {
+    unordered_map<string, vector<size_t> >::iterator context_it =
+        context_gestures_.find(*it);
+    if (context_it != context_gestures_.end()) {
+      active_gestures_.insert(active_gestures_.end(),
+                              context_it->second.begin(),
+                              context_it->second.end());
+    }
+  }
+
+  // A gesture subscribed under several active contexts is only scored once
+  std::sort(active_gestures_.begin(), active_gestures_.end());
+  active_gestures_.erase(
+      std::unique(active_gestures_.begin(), active_gestures_.end()),
+      active_gestures_.end());
+
+  active_gestures_stale_ = false;
 }
 
-bool LagerRecognizer::IsSingleSensorGesture(string current_gesture) {
-  vector<string> movement_pairs;
-  TokenizeString(current_gesture, movement_pairs, ".");
-  bool sensor_0_moved = false;
-  bool sensor_1_moved = false;
-
-  for (vector<string>::iterator it = movement_pairs.begin();
-      it < movement_pairs.end(); ++it) {
-    // Check if sensor 0 movement is present
-    if ((*it).c_str()[0] != '_') {
-      sensor_0_moved = true;
+bool LagerRecognizer::IsGestureActive(size_t gesture_index) {
+  UpdateActiveGestures();
+  return std::binary_search(active_gestures_.begin(), active_gestures_.end(),
+                            gesture_index);
+}
+
+/*
+ * Takes the input histogram lanes and a gesture histogram, and stores the
+ * lower bound on the distance percentage under every rotation. Returns the
+ * smallest bound among the given rotations, which bounds the distance of the
+ * gesture whichever rotation ends up closest.
+ */
+float GetRotatedHistogramLowerBoundPcts(
+    const int* input_lanes, unsigned int input_length,
+    const struct LagerHistogram& gesture_histogram,
+    const vector<unsigned int>& rotations, float* lower_bounds) {
+  int distances[NUM_LAGER_ROTATIONS];
+
+  if (input_length == 0 || gesture_histogram.length == 0) {
+    for (unsigned int rotation = 0; rotation < NUM_LAGER_ROTATIONS;
+        rotation++) {
+      lower_bounds[rotation] = 0;
     }
+    return 0;
+  }
 
-    // Check if sensor 0 movement is present
-    if ((*it).c_str()[0] != '_') {
-      sensor_1_moved = true;
+  // Rotating a string does not change its length, so all lanes share factors
+  int least_common_multiple = boost::math::lcm(input_length,
+                                               gesture_histogram.length);
+  GetRotatedHistogramDistances(input_lanes,
+                               least_common_multiple / input_length,
+                               gesture_histogram.counts,
+                               least_common_multiple / gesture_histogram.length,
+                               LAGER_HISTOGRAM_BINS, distances);
+
+  float lowest_bound = -1;
+  for (vector<unsigned int>::const_iterator it = rotations.begin();
+      it < rotations.end(); ++it) {
+    lower_bounds[*it] = (((distances[*it] + 1) / 2) * 100.0f)
+        / least_common_multiple;
+    if (lowest_bound < 0 || lower_bounds[*it] < lowest_bound) {
+      lowest_bound = lower_bounds[*it];
     }
+  }
 
-    // If we already found movement on both sensors, there is no need to keep checking
-    if (sensor_0_moved && sensor_1_moved) {
-      break;
+  return lowest_bound;
+}
+
+void LagerRecognizer::ComputeScoringOrder(
+    const struct LagerHistogram& input_histogram) {
+  bool use_rotations = (rotation_mask_ != LAGER_ROTATIONS_IDENTITY);
+
+  UpdateActiveGestures();
+  scoring_order_.resize(active_gestures_.size());
+  if (use_rotations) {
+    rotation_lower_bounds_.resize(subscribed_gestures_->size()
+        * NUM_LAGER_ROTATIONS);
+  }
+
+  for (size_t j = 0; j < active_gestures_.size(); j++) {
+    size_t i = active_gestures_[j];
+    scoring_order_[j].gesture_index = i;
+    if (use_rotations) {
+      scoring_order_[j].lower_bound_pct = GetRotatedHistogramLowerBoundPcts(
+          rotated_histogram_lanes_, input_histogram.length,
+          gesture_histograms_[i], rotations_,
+          &rotation_lower_bounds_[i * NUM_LAGER_ROTATIONS]);
+    } else {
+      scoring_order_[j].lower_bound_pct = GetLagerLowerBoundPct(
+          input_histogram, run_length_input_, gesture_histograms_[i],
+          run_length_gestures_[i],
+          distance_engine_ == LRDistanceEngine::run_length);
+    }
+
+    // Movements of different widths are not costed character by character
+    if (use_rotations && distance_engine_ == LRDistanceEngine::run_length
+        && run_length_gestures_[i].symbol_width
+            != run_length_input_.symbol_width) {
+      scoring_order_[j].lower_bound_pct = 0;
+      for (unsigned int rotation = 0; rotation < NUM_LAGER_ROTATIONS;
+          rotation++) {
+        rotation_lower_bounds_[i * NUM_LAGER_ROTATIONS + rotation] = 0;
+      }
     }
   }
 
-  return (!sensor_0_moved || !sensor_1_moved);
+  std::sort(scoring_order_.begin(), scoring_order_.end(),
+            ScoringOrderLessThan);
+}
+
+size_t LagerRecognizer::RankGestures(const string& current_gesture,
+                                     struct RecognitionCandidate* candidates,
+                                     size_t max_candidates) {
+  bool partial_result;
+  return RankGestures(current_gesture, candidates, max_candidates,
+                      time_point<system_clock>::max(), partial_result);
+}
+
+size_t LagerRecognizer::RankGestures(const string& current_gesture,
+                                     struct RecognitionCandidate* candidates,
+                                     size_t max_candidates,
+                                     time_point<system_clock> deadline,
+                                     bool& partial_result) {
+  return RankClosestGestures(current_gesture, candidates, max_candidates,
+                             deadline, false, partial_result);
+}
+
+size_t LagerRecognizer::RankGestureNames(
+    const string& current_gesture, struct RecognitionCandidate* candidates,
+    size_t max_candidates, time_point<system_clock> deadline,
+    bool& partial_result) {
+  return RankClosestGestures(current_gesture, candidates, max_candidates,
+                             deadline, true, partial_result);
+}
+
+size_t LagerRecognizer::RankClosestGestures(
+    const string& current_gesture, struct RecognitionCandidate* candidates,
+    size_t max_candidates, time_point<system_clock> deadline,
+    bool distinct_names, bool& partial_result) {
+  struct LagerHistogram input_histogram;
+  bool has_deadline = (deadline != time_point<system_clock>::max());
+
+  partial_result = false;
+
+  if (max_candidates == 0 || current_gesture.empty()) {
+    return 0;
+  }
+
+  EncodeNewSubscribedGestures();
+  EncodeRunLengthLager(current_gesture, run_length_input_);
+  ComputeLagerHistogram(current_gesture, input_histogram);
+  if (rotation_mask_ != LAGER_ROTATIONS_IDENTITY) {
+    RotateInput(current_gesture, input_histogram);
+  }
+  ComputeScoringOrder(input_histogram);
+
+  deadline_statistics_.num_rankings++;
+  if (has_deadline) {
+    deadline_statistics_.num_rankings_with_deadline++;
+  }
+
+  size_t num_scored;
+  size_t num_candidates = SelectClosestLagerTemplates(
+      scoring_order_.data(), scoring_order_.size(),
+      [&](struct RecognitionCandidate& candidate) {
+        candidate.engine = distance_engine_;
+        candidate.rotation = 0;
+        if (rotation_mask_ == LAGER_ROTATIONS_IDENTITY) {
+          ScoreGesture(candidate.gesture_index, current_gesture,
+                       run_length_input_, candidate.distance,
+                       candidate.distance_pct);
+        } else {
+          ScoreRotatedGesture(candidate.gesture_index, candidate);
+        }
+      },
+      distinct_names,
+      [this](size_t i, size_t j) {
+        return (*subscribed_gestures_)[i].name
+            == (*subscribed_gestures_)[j].name;
+      },
+      [has_deadline, deadline]() {
+        return has_deadline && system_clock::now() >= deadline;
+      },
+      candidates, max_candidates, num_scored, partial_result);
+
+  deadline_statistics_.num_gestures_scored += num_scored;
+  if (partial_result) {
+    deadline_statistics_.num_deadline_hits++;
+    deadline_statistics_.num_gestures_unscored += scoring_order_.size()
+        - num_scored;
+  } else {
+    deadline_statistics_.num_gestures_pruned += scoring_order_.size()
+        - num_scored;
+  }
+
+  return num_candidates;
+}
+
+void LagerRecognizer::UpdateSubscribedGestureDistances(
+    const struct RecognitionCandidate* candidates, size_t num_candidates) {
+  for (size_t i = 0; i < num_candidates; i++) {
+    struct SubscribedGesture& subscribed_gesture =
+        (*subscribed_gestures_)[candidates[i].gesture_index];
+    subscribed_gesture.distance = candidates[i].distance;
+    subscribed_gesture.distance_pct = candidates[i].distance_pct;
+  }
+}
+
+bool LagerRecognizer::IsSingleSensorGesture(string current_gesture) {
+  return IsSingleSensorLager(current_gesture);
 }
 
 int LagerRecognizer::GetMillisecondsUntilNow(
@@ -169,10 +431,32 @@ int LagerRecognizer::GetMillisecondsUntilNow(
   return duration<double, std::milli>(now - last_time).count();
 }
 
+/*
+ * Returns the banner row that names a distance engine in the recognition
+ * output.
+ */
+static const char* GetDistanceEngineBanner(LRDistanceEngine distance_engine) {
+  if (distance_engine == LRDistanceEngine::run_length) {
+    return "|           RUN-LENGTH           |";
+  }
+  return "|      DAMERAU-LEVENSHTEIN       |";
+}
+
+/*
+ * Returns the unit of the distances a distance engine computes.
+ */
+static const char* GetDistanceEngineUnit(LRDistanceEngine distance_engine) {
+  if (distance_engine == LRDistanceEngine::run_length) {
+    return "run-length ops";
+  }
+  return "D-L ops";
+}
+
 void LagerRecognizer::PrintRecognitionResults(
     struct SubscribedGesture& closest_gesture,
     int gesture_distance_threshold_pct,
-    time_point<system_clock> recognition_start_time, bool match_found) {
+    time_point<system_clock> recognition_start_time, bool match_found,
+    bool partial_result) {
   unsigned int num_milliseconds_since_recognition_start =
       GetMillisecondsUntilNow(recognition_start_time);
 
@@ -183,18 +467,32 @@ void LagerRecognizer::PrintRecognitionResults(
        it < subscribed_gestures_->end(); ++it) {
     cout << "  "
          << std::left << std::setw(15)
-         << it->name << " : "
-         << setprecision (2) << fixed
+         << it->name << " : ";
+    if (it->distance < 0) {
+      cout << "not ranked" << endl;
+      continue;
+    }
+    cout << setprecision (2) << fixed
          << it->distance_pct << " % ("
-         << it->distance << " D-L ops)" << endl;
+         << it->distance << " " << GetDistanceEngineUnit(distance_engine_)
+         << ")" << endl;
   }
 
   cout << endl;
 
+  if (partial_result) {
+    cout << "PARTIAL RESULT: deadline reached after scoring "
+         << ranking_num_scored_ << " of " << subscribed_gestures_->size()
+         << " gestures (" << deadline_statistics_.num_deadline_hits
+         << " of " << deadline_statistics_.num_rankings_with_deadline
+         << " rankings with a deadline cut short so far)" << endl;
+    cout << endl;
+  }
+
   if (match_found) {
     cout << " ________________________________ " << endl;
     cout << "|                                |" << endl;
-    cout << "|      DAMERAU-LEVENSHTEIN       |" << endl;
+    cout << GetDistanceEngineBanner(distance_engine_) << endl;
     cout << "|          MATCH FOUND!          |" << endl;
     cout << "|________________________________|" << endl;
     cout << "                                  " << endl;
@@ -207,8 +505,12 @@ void LagerRecognizer::PrintRecognitionResults(
   cout << "Closest gesture:\t" << closest_gesture.name << endl;
   cout << endl;
   cout << "Distance:\t\t" << closest_gesture.distance_pct << " % ("
-      << closest_gesture.distance << " D-L ops)" << endl;
+      << closest_gesture.distance << " "
+      << GetDistanceEngineUnit(distance_engine_) << ")" << endl;
   cout << "Threshold:\t\t" << gesture_distance_threshold_pct << " %" << endl;
+  if (rotation_mask_ != LAGER_ROTATIONS_IDENTITY && !ranking_.empty()) {
+    cout << "Rotation:\t\t" << ranking_[0].rotation << endl;
+  }
   cout << endl;
   cout << "Recognition time: \t" << num_milliseconds_since_recognition_start
        << " ms" << endl;
@@ -247,11 +549,17 @@ void LagerRecognizer::PrintMlRecognitionResults(
 struct SubscribedGesture LagerRecognizer::RecognizeGesture(
     bool draw_gestures, string current_gesture,
     bool& match_found) {
-  int lowestDistance;
+  bool partial_result;
+  return RecognizeGesture(draw_gestures, current_gesture, match_found,
+                          time_point<system_clock>::max(), partial_result);
+}
 
+struct SubscribedGesture LagerRecognizer::RecognizeGesture(
+    bool draw_gestures, string current_gesture, bool& match_found,
+    time_point<system_clock> deadline, bool& partial_result) {
   cout << " ________________________________ " << endl;
   cout << "|                                |" << endl;
-  cout << "|      DAMERAU-LEVENSHTEIN       |" << endl;
+  cout << GetDistanceEngineBanner(distance_engine_) << endl;
   cout << "|          RECOGNIZER            |" << endl;
   cout << "|________________________________|" << endl;
   cout << "                                  " << endl;
@@ -262,15 +570,55 @@ struct SubscribedGesture LagerRecognizer::RecognizeGesture(
           SINGLE_SENSOR_GESTURE_DISTANCE_THRESHOLD_PCT :
           DUAL_SENSOR_GESTURE_DISTANCE_THRESHOLD_PCT;
 
-  UpdateSubscribedGestureDistances(current_gesture);
+  // Gestures pruned, cut off by the deadline or outside the ranking are
+  // marked as such
+  for (vector<SubscribedGesture>::iterator it = subscribed_gestures_->begin();
+      it < subscribed_gestures_->end(); ++it) {
+    it->distance = -1;
+  }
+
+  /*
+   * Only the candidates the decision needs are ranked, so the rest of the
+   * gestures can be pruned: the voters, or else the closest gesture and the
+   * closest one with another name, which the cascade compares.
+   */
+  unsigned long num_scored_before = deadline_statistics_.num_gestures_scored;
+  size_t num_candidates;
+  if (vote_neighbors_ > 1) {
+    ranking_.resize(vote_neighbors_);
+    num_candidates = RankGestures(current_gesture, ranking_.data(),
+                                  ranking_.size(), deadline, partial_result);
+  } else {
+    ranking_.resize(2);
+    num_candidates = RankGestureNames(current_gesture, ranking_.data(),
+                                      ranking_.size(), deadline,
+                                      partial_result);
+  }
+  ranking_.resize(num_candidates);
+  ranking_num_scored_ = deadline_statistics_.num_gestures_scored
+      - num_scored_before;
+  if (num_candidates == 0) {
+    match_found = false;
+    return SubscribedGesture();
+  }
+  UpdateSubscribedGestureDistances(ranking_.data(), num_candidates);
 
-  SubscribedGesture closest_gesture = *min_element(subscribed_gestures_->begin(),
-                                                   subscribed_gestures_->end(),
-                                                   GestureEntryLessThan);
+  unsigned int num_votes = 0;
+  if (vote_neighbors_ > 1) {
+    num_votes = VoteForClosestGestureName(gesture_distance_threshold_pct);
+  }
+
+  SubscribedGesture closest_gesture =
+      (*subscribed_gestures_)[ranking_[0].gesture_index];
   match_found = closest_gesture.distance_pct <= gesture_distance_threshold_pct;
+  ranking_threshold_pct_ = gesture_distance_threshold_pct;
 
   PrintRecognitionResults(closest_gesture, gesture_distance_threshold_pct,
-                          recognition_start_time, match_found);
+                          recognition_start_time, match_found, partial_result);
+  if (num_votes > 0) {
+    cout << "Votes:\t\t\t" << num_votes << " of " << vote_neighbors_ << endl;
+    cout << endl;
+  }
 
   return closest_gesture;
 }
@@ -295,13 +643,182 @@ struct SubscribedGesture LagerRecognizer::RecognizeGestureML(
     result.gesture_index = 0;
   }
 
-  SubscribedGesture recognized_gesture = (*subscribed_gestures_)[result.gesture_index];
+  // The classifier indexes the gestures file, whose exemplars may have been
+  // compressed into fewer subscribed gestures
+  size_t gesture_index = result.gesture_index;
+  if (!classifier_gesture_indexes_.empty()) {
+    gesture_index = (gesture_index < classifier_gesture_indexes_.size()) ?
+        classifier_gesture_indexes_[gesture_index] :
+        subscribed_gestures_->size();
+  }
+
+  SubscribedGesture recognized_gesture;
+  if (gesture_index >= subscribed_gestures_->size()) {
+    cout << "Gesture " << result.gesture_index
+         << " returned from ML classifier is not subscribed." << endl;
+    match_found = false;
+  } else {
+    recognized_gesture = (*subscribed_gestures_)[gesture_index];
+
+    // The classifier knows every gesture, including those in inactive
+    // contexts
+    if (match_found && !IsGestureActive(gesture_index)) {
+      cout << "Gesture " << result.gesture_index
+           << " is not in an active context." << endl;
+      match_found = false;
+    }
+  }
 
   PrintMlRecognitionResults(recognized_gesture, result.probability, ML_RECOGNITION_THRESHOLD_PCT, result.elapsed_time, match_found);
 
   return recognized_gesture;
 }
 
+bool LagerRecognizer::IsUnambiguousMatch(const string& current_gesture,
+                                         int gesture_distance_threshold_pct,
+                                         time_point<system_clock> deadline) {
+  if (ranking_.empty()
+      || ranking_[0].distance_pct > gesture_distance_threshold_pct) {
+    return false;
+  }
+
+  // Other exemplars of the same gesture do not make the match ambiguous
+  const string& closest_name =
+      (*subscribed_gestures_)[ranking_[0].gesture_index].name;
+  for (size_t i = 1; i < ranking_.size(); i++) {
+    if ((*subscribed_gestures_)[ranking_[i].gesture_index].name
+        != closest_name) {
+      return ((ranking_[i].distance_pct - ranking_[0].distance_pct)
+          >= cascade_margin_pct_);
+    }
+  }
+
+  // Every voter had the same name, but a closer gesture with another name
+  // may have been left out of the ranking
+  if (vote_neighbors_ > 1 && ranking_.size() == vote_neighbors_) {
+    struct RecognitionCandidate closest_names[2];
+    bool partial_result;
+    size_t num_names = RankGestureNames(current_gesture, closest_names, 2,
+                                        deadline, partial_result);
+    for (size_t i = 0; i < num_names; i++) {
+      if ((*subscribed_gestures_)[closest_names[i].gesture_index].name
+          != closest_name) {
+        return ((closest_names[i].distance_pct - ranking_[0].distance_pct)
+            >= cascade_margin_pct_);
+      }
+    }
+  }
+
+  return true;
+}
+
+unsigned int LagerRecognizer::VoteForClosestGestureName(
+    int gesture_distance_threshold_pct) {
+  vector<float> vote_weights;
+  vector<unsigned int> votes;
+  size_t num_voters = 0;
+  size_t winner = 0;
+
+  // Candidates are sorted by distance, so the first one with a given name is
+  // the closest of its gesture class
+  for (; num_voters < ranking_.size() && num_voters < vote_neighbors_;
+      num_voters++) {
+    float distance_pct = ranking_[num_voters].distance_pct;
+    if (distance_pct > gesture_distance_threshold_pct) {
+      break;
+    }
+
+    const string& name =
+        (*subscribed_gestures_)[ranking_[num_voters].gesture_index].name;
+    size_t first = 0;
+    while ((*subscribed_gestures_)[ranking_[first].gesture_index].name
+        != name) {
+      first++;
+    }
+
+    // Closer candidates weigh more, so far outliers cannot outvote a near match
+    vote_weights.resize(num_voters + 1, 0);
+    votes.resize(num_voters + 1, 0);
+    vote_weights[first] += gesture_distance_threshold_pct - distance_pct + 1;
+    votes[first]++;
+    if (vote_weights[first] > vote_weights[winner]) {
+      winner = first;
+    }
+  }
+
+  if (num_voters == 0) {
+    return 0;
+  }
+
+  std::rotate(ranking_.begin(), ranking_.begin() + winner,
+              ranking_.begin() + winner + 1);
+
+  return votes[winner];
+}
+
+void LagerRecognizer::PrintCascadeStatistics() {
+  const struct CascadeStatistics& stats = cascade_statistics_;
+
+  cout << "Cascade decisions:\t" << stats.num_distance_decisions
+       << " by distance, " << stats.num_ml_decisions << " by ML, out of "
+       << stats.num_recognitions << endl;
+
+  if (stats.num_recognitions > 0) {
+    cout << "Average stage times:\t"
+         << stats.distance_stage_microseconds / stats.num_recognitions
+         << " us distance, "
+         << stats.ml_stage_microseconds / stats.num_recognitions
+         << " us ML" << endl;
+  }
+  cout << endl;
+}
+
+struct SubscribedGesture LagerRecognizer::RecognizeGestureCascade(
+    bool draw_gestures, string current_gesture, bool& match_found) {
+  bool partial_result;
+  return RecognizeGestureCascade(draw_gestures, current_gesture, match_found,
+                                 time_point<system_clock>::max(),
+                                 partial_result);
+}
+
+struct SubscribedGesture LagerRecognizer::RecognizeGestureCascade(
+    bool draw_gestures, string current_gesture, bool& match_found,
+    time_point<system_clock> deadline, bool& partial_result) {
+  time_point<system_clock> stage_start_time = system_clock::now();
+
+  SubscribedGesture recognized_gesture = RecognizeGesture(draw_gestures,
+                                                          current_gesture,
+                                                          match_found,
+                                                          deadline,
+                                                          partial_result);
+
+  cascade_statistics_.num_recognitions++;
+  cascade_statistics_.distance_stage_microseconds +=
+      std::chrono::duration_cast<microseconds>(
+          system_clock::now() - stage_start_time).count();
+
+  // Without a classifier or time left, the distance engine has the last word
+  if (IsUnambiguousMatch(current_gesture, ranking_threshold_pct_, deadline)
+      || ml_classifier_ == NULL
+      || system_clock::now() >= deadline) {
+    cascade_statistics_.num_distance_decisions++;
+    PrintCascadeStatistics();
+    return recognized_gesture;
+  }
+
+  stage_start_time = system_clock::now();
+
+  recognized_gesture = RecognizeGestureML(current_gesture, match_found);
+
+  cascade_statistics_.num_ml_decisions++;
+  cascade_statistics_.ml_stage_microseconds +=
+      std::chrono::duration_cast<microseconds>(
+          system_clock::now() - stage_start_time).count();
+  PrintCascadeStatistics();
+
+  return recognized_gesture;
+}
+
 PyObject* LagerRecognizer::InitializePythonClassifier() {
   PyObject *pName, *pModule, *pFunc;
 
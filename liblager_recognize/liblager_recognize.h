@@ -13,15 +13,87 @@ using std::chrono::system_clock;
 using std::chrono::time_point;
 #include <string>
 using std::string;
+#include <unordered_map>
+using std::unordered_map;
 #include <vector>
 using std::vector;
 
+#include "lager_distance.h"
+#include "lager_gesture_plugin.h"
+#include "lager_ranking.h"
+#include "lager_rotation.h"
+#include "lager_run_length.h"
+
 #define RECOGNIZER_ERROR -1
 #define RECOGNIZER_NO_ERROR 0
 
-#define SINGLE_SENSOR_GESTURE_DISTANCE_THRESHOLD_PCT 25
-#define DUAL_SENSOR_GESTURE_DISTANCE_THRESHOLD_PCT 35
 #define ML_RECOGNITION_THRESHOLD_PCT 55
+#define CASCADE_MARGIN_PCT 10
+#define DEFAULT_VOTE_NEIGHBORS 1
+
+/**
+ * Algorithm used to compute the distance between the input gesture and each
+ * subscribed gesture.
+ *
+ * The Damerau-Levenshtein engine expands both LaGeR strings to the least
+ * common multiple of their lengths and compares them character by character.
+ * The run-length engine compares whole movements directly on the run-length
+ * representation of both gestures, without expanding them.
+ */
+enum class LRDistanceEngine { damerau_levenshtein, run_length };
+
+/**
+ * Describes one entry of a gesture ranking: a subscribed gesture and how far
+ * it is from the input gesture according to a given engine.
+ */
+struct RecognitionCandidate {
+  /// Index of the gesture within the subscribed gestures vector
+  size_t gesture_index;
+  /// Distance between the gesture and the input
+  int distance;
+  /// Distance as a percent of the expanded LaGeR string length
+  float distance_pct;
+  /// Engine that computed the distance
+  LRDistanceEngine engine;
+  /// Rotation of the input that gave the distance, 0 being the identity
+  unsigned int rotation;
+};
+
+/**
+ * Counts how often each stage of the cascade recognizer made the final
+ * decision, and how much time was spent in each of them.
+ */
+struct CascadeStatistics {
+  /// Number of gestures recognized through the cascade
+  unsigned long num_recognitions = 0;
+  /// Number of gestures decided by the distance engine alone
+  unsigned long num_distance_decisions = 0;
+  /// Number of gestures that were handed over to the ML classifier
+  unsigned long num_ml_decisions = 0;
+  /// Total time spent in the distance stage, in microseconds
+  unsigned long distance_stage_microseconds = 0;
+  /// Total time spent in the ML stage, in microseconds
+  unsigned long ml_stage_microseconds = 0;
+};
+
+/**
+ * Counts how often deadline-aware rankings ran out of time, and how many
+ * gestures were scored or skipped.
+ */
+struct DeadlineStatistics {
+  /// Number of rankings performed
+  unsigned long num_rankings = 0;
+  /// Number of rankings that were given a deadline
+  unsigned long num_rankings_with_deadline = 0;
+  /// Number of rankings that stopped early because the deadline passed
+  unsigned long num_deadline_hits = 0;
+  /// Number of gestures whose distance was fully computed
+  unsigned long num_gestures_scored = 0;
+  /// Number of gestures skipped because their lower bound ruled them out
+  unsigned long num_gestures_pruned = 0;
+  /// Number of gestures left unscored when the deadline passed
+  unsigned long num_gestures_unscored = 0;
+};
 
 struct PythonClassifierResult {
   long gesture_index;
@@ -48,6 +120,109 @@ class LagerRecognizer {
   ~LagerRecognizer() {
   }
 
+  /**
+   * Sets the distance_engine_ member variable.
+   *
+   * Defaults to Damerau-Levenshtein.
+   */
+  void SetDistanceEngine(LRDistanceEngine distance_engine) {
+    distance_engine_ = distance_engine;
+  }
+
+  /**
+   * Takes a gesture plugin and appends its gestures to the subscribed
+   * gestures, along with their precomputed run-length representations and
+   * histograms, so they are not encoded again. Everything is copied, so the
+   * plugin can be unloaded afterwards.
+   */
+  void AddPluginGestures(const struct LagerGesturePlugin& plugin);
+
+  /**
+   * Takes a gesture plugin and replaces every subscribed gesture with its
+   * gestures, dropping the encodings and context lists of the old ones.
+   */
+  void ReplaceWithPluginGestures(const struct LagerGesturePlugin& plugin);
+
+  /**
+   * Takes, for each gesture index the ML classifier can return, the index of
+   * the subscribed gesture that stands for it. The classifier indexes the
+   * gestures file, which no longer matches the subscribed gestures once the
+   * exemplars of each class are compressed. An empty list means the indexes
+   * are the same.
+   *
+   * Cleared when the subscribed gestures are replaced.
+   */
+  void SetClassifierGestureIndexes(
+      const vector<size_t>& classifier_gesture_indexes) {
+    classifier_gesture_indexes_ = classifier_gesture_indexes;
+  }
+
+  /**
+   * Takes a mask of the rotations (see lager_rotation.h) under which the
+   * input is matched against each gesture. The closest rotation wins, so
+   * gestures drawn with the sensors held in another orientation still match.
+   * The identity is always included.
+   *
+   * Defaults to LAGER_ROTATIONS_IDENTITY.
+   */
+  void SetRotations(uint32_t rotation_mask);
+
+  /**
+   * Takes the names of the active gesture contexts. Only gestures subscribed
+   * under one of them, or without a context, are scored from then on.
+   *
+   * By default no context is active.
+   */
+  void SetActiveContexts(const vector<string>& active_contexts) {
+    active_contexts_ = active_contexts;
+    active_gestures_stale_ = true;
+  }
+
+  /**
+   * Returns the names of the active gesture contexts.
+   */
+  const vector<string>& GetActiveContexts() {
+    return active_contexts_;
+  }
+
+  /**
+   * Takes a gesture LaGeR string and fills a caller-provided array with the
+   * max_candidates subscribed gestures closest to it, sorted from closest to
+   * farthest. Returns the number of candidates written.
+   *
+   * Only indexes and distances are returned, so ranking does not copy any
+   * gesture names or LaGeR strings and does not print anything.
+   */
+  size_t RankGestures(const string& current_gesture,
+                      struct RecognitionCandidate* candidates,
+                      size_t max_candidates);
+
+  /**
+   * Deadline-aware version of RankGestures().
+   *
+   * Gestures are scored in order of increasing lower bound, so the most
+   * likely candidates are scored first, and gestures whose lower bound cannot
+   * beat the current candidates are skipped. If the deadline passes before
+   * all remaining gestures are scored, the best candidates found so far are
+   * returned and partial_result is set to true.
+   */
+  size_t RankGestures(const string& current_gesture,
+                      struct RecognitionCandidate* candidates,
+                      size_t max_candidates,
+                      time_point<system_clock> deadline,
+                      bool& partial_result);
+
+  /**
+   * Version of RankGestures() that keeps only the closest gesture of each
+   * name, so the second candidate is the closest gesture with another name
+   * however many exemplars the first name has.
+   */
+  size_t RankGestureNames(const string& current_gesture,
+                          struct RecognitionCandidate* candidates,
+                          size_t max_candidates,
+                          time_point<system_clock> deadline,
+                          bool& partial_result);
+
   /**
    * Takes a gesture LaGeR string and returns the closest matching subscribed
    * gesture.
@@ -62,6 +237,25 @@ class LagerRecognizer {
                                             string current_gesture,
                                             bool& match_found);
 
+  /**
+   * Deadline-aware version of RecognizeGesture().
+   *
+   * Returns the closest gesture found before the deadline passes, and sets
+   * partial_result to true if some gestures could not be scored in time.
+   */
+  struct SubscribedGesture RecognizeGesture(bool draw_gestures,
+                                            string current_gesture,
+                                            bool& match_found,
+                                            time_point<system_clock> deadline,
+                                            bool& partial_result);
+
+  /**
+   * Returns how often deadline-aware rankings ran out of time.
+   */
+  const struct DeadlineStatistics& GetDeadlineStatistics() const {
+    return deadline_statistics_;
+  }
+
   /**
    * Takes a gesture LaGeR string, finds the closest matching subscribed
    * gesture via a machine learning algorithm, and returns it.
@@ -72,6 +266,58 @@ class LagerRecognizer {
   struct SubscribedGesture RecognizeGestureML(string current_gesture,
                                               bool& match_found);
 
+  /**
+   * Sets the cascade_margin_pct_ member variable.
+   *
+   * The distance engine decides on its own when its closest gesture is below
+   * the distance threshold and at least this many percentage points closer
+   * than the second closest one.
+   */
+  void SetCascadeMargin(float cascade_margin_pct) {
+    cascade_margin_pct_ = cascade_margin_pct;
+  }
+
+  /**
+   * Sets the vote_neighbors_ member variable.
+   *
+   * When a gesture name has several subscribed exemplars, the closest
+   * vote_neighbors gestures under the distance threshold vote for their name,
+   * each vote weighted by how far under the threshold the gesture is, and the
+   * name with the highest total wins. With a single neighbor the closest
+   * gesture wins, as before.
+   */
+  void SetVoteNeighbors(unsigned int vote_neighbors) {
+    vote_neighbors_ = (vote_neighbors > 0) ? vote_neighbors : 1;
+  }
+
+  /**
+   * Returns how often each stage of the cascade made the final decision.
+   */
+  const struct CascadeStatistics& GetCascadeStatistics() const {
+    return cascade_statistics_;
+  }
+
+  /**
+   * Takes a gesture LaGeR string and recognizes it with the distance engine
+   * first. The machine learning classifier is only called when the distance
+   * engine has no clear winner, as determined by the cascade margin.
+   *
+   * If no match is found, it indicates it by toggling a Boolean parameter.
+   */
+  struct SubscribedGesture RecognizeGestureCascade(bool draw_gestures,
+                                                   string current_gesture,
+                                                   bool& match_found);
+
+  /**
+   * Deadline-aware version of RecognizeGestureCascade().
+   *
+   * The distance stage stops scoring when the deadline passes, and the
+   * machine learning stage is skipped if the deadline has already passed.
+   */
+  struct SubscribedGesture RecognizeGestureCascade(
+      bool draw_gestures, string current_gesture, bool& match_found,
+      time_point<system_clock> deadline, bool& partial_result);
+
   /**
     * Initializes and returns a Python classifier function.
     */
@@ -86,6 +332,7 @@ class LagerRecognizer {
    */
   LagerRecognizer(vector<struct SubscribedGesture>* subscribed_gestures)
       : subscribed_gestures_(subscribed_gestures) {
+    SetRotations(LAGER_ROTATIONS_IDENTITY);
     ml_classifier_ = InitializePythonClassifier();
   }
   ;
@@ -117,15 +364,48 @@ class LagerRecognizer {
    */
   bool IsSingleSensorGesture(string current_gesture);
 
+  /**
+   * Takes the input gesture, the distance threshold used for the latest
+   * ranking and the recognition deadline, and returns whether the closest
+   * gesture is a match by a wide enough margin for the cascade to skip the
+   * machine learning classifier.
+   */
+  bool IsUnambiguousMatch(const string& current_gesture,
+                          int gesture_distance_threshold_pct,
+                          time_point<system_clock> deadline);
+
+  /**
+   * Common implementation of RankGestures() and RankGestureNames(). When
+   * distinct_names is true, only the closest gesture of each name is kept.
+   */
+  size_t RankClosestGestures(const string& current_gesture,
+                             struct RecognitionCandidate* candidates,
+                             size_t max_candidates,
+                             time_point<system_clock> deadline,
+                             bool distinct_names, bool& partial_result);
+
+  /**
+   * Takes the distance threshold used for the latest ranking and lets its
+   * closest candidates vote for their gesture name. The closest candidate of
+   * the winning name is moved to the front of the ranking. Returns the number
+   * of votes it got.
+   */
+  unsigned int VoteForClosestGestureName(int gesture_distance_threshold_pct);
+
+  /**
+   * Prints how often each stage of the cascade made the final decision.
+   */
+  void PrintCascadeStatistics();
+
   /**
    * Takes the closest gesture match, the distance threshold, the recognition
-   * starting time, and whether a match was found, then prints the
-   * corresponding recognition results.
+   * starting time, whether a match was found, and whether the deadline cut
+   * the ranking short, then prints the corresponding recognition results.
    */
   void PrintRecognitionResults(struct SubscribedGesture& closest_gesture,
                                int gesture_distance_threshold_pct,
                                time_point<system_clock> recognition_start_time,
-                               bool match_found);
+                               bool match_found, bool partial_result);
 
   /**
    * Prints the ML recognition results including the classified gesture,
@@ -138,20 +418,61 @@ class LagerRecognizer {
                                  bool match_found);
 
   /**
-   * Takes a reference to a SubscribedGesture and the LaGeR string of the input
-   * gesture being recognized, then updates the SubscribedGesture's distance
-   * members.
-   *
+   * Takes the index of a SubscribedGesture and the LaGeR string of the input
+   * gesture being recognized, along with its run-length representation, then
+   * computes their distance with the current engine.
    */
-  void UpdateSubscribedGestureDistance(
-      struct SubscribedGesture& subscribed_gesture, string current_gesture);
+  void ScoreGesture(size_t gesture_index, const string& current_gesture,
+                    const RunLengthLager& run_length_input, int& distance,
+                    float& distance_pct);
 
   /**
-   * Takes the LaGeR string of the input gesture being recognized, then
-   * iterates through the SubscribedGestures and updates their distance
-   * members.
+   * Takes the index of a SubscribedGesture and scores it against every
+   * rotation of the input, from the lowest histogram bound up, until no
+   * remaining rotation can beat the best distance. The best distance and its
+   * rotation are stored in the candidate.
    */
-  void UpdateSubscribedGestureDistances(string current_gesture);
+  void ScoreRotatedGesture(size_t gesture_index,
+                           struct RecognitionCandidate& candidate);
+
+  /**
+   * Takes the input gesture and its histogram, and prepares its rotated
+   * strings, run-length representations and histogram lanes.
+   */
+  void RotateInput(const string& current_gesture,
+                   const struct LagerHistogram& input_histogram);
+
+  /**
+   * Takes a ranking of candidates and copies their distances into the
+   * distance members of the corresponding SubscribedGestures.
+   */
+  void UpdateSubscribedGestureDistances(
+      const struct RecognitionCandidate* candidates, size_t num_candidates);
+
+  /**
+   * Computes the run-length representation and the histogram of the
+   * SubscribedGestures that have arrived since the last recognition.
+   */
+  void EncodeNewSubscribedGestures();
+
+  /**
+   * Rebuilds the per-context gesture lists when gestures or subscribers have
+   * been added, and the list of gestures in active contexts when either the
+   * context lists or the active contexts have changed.
+   */
+  void UpdateActiveGestures();
+
+  /**
+   * Takes the index of a subscribed gesture and returns whether it belongs to
+   * an active context.
+   */
+  bool IsGestureActive(size_t gesture_index);
+
+  /**
+   * Takes the input gesture's histogram and sorts the subscribed gestures in
+   * active contexts by increasing lower bound on their distance to it.
+   */
+  void ComputeScoringOrder(const struct LagerHistogram& input_histogram);
 
   /**
    * Calls a Python classifier function and returns the results.
@@ -167,6 +488,87 @@ class LagerRecognizer {
 
   /// Pointer to a Python ML classifier
   PyObject* ml_classifier_;
+
+  /// Subscribed gesture index for each classifier gesture index, if they
+  /// differ
+  vector<size_t> classifier_gesture_indexes_;
+
+  /// Algorithm used to compute gesture distances
+  LRDistanceEngine distance_engine_ = LRDistanceEngine::damerau_levenshtein;
+
+  /// Run-length representations of the SubscribedGestures, in the same order
+  vector<RunLengthLager> run_length_gestures_;
+
+  /// Run-length representation of the input gesture being recognized
+  RunLengthLager run_length_input_;
+
+  /// Histograms of the SubscribedGestures, in the same order
+  vector<struct LagerHistogram> gesture_histograms_;
+
+  /// Indexes of the SubscribedGestures subscribed under each context, in
+  /// increasing order. Gestures without a context are under the empty name.
+  unordered_map<string, vector<size_t> > context_gestures_;
+
+  /// Number of subscribers accounted for in context_gestures_
+  size_t num_indexed_subscribers_ = 0;
+
+  /// Number of SubscribedGestures accounted for in context_gestures_
+  size_t num_indexed_gestures_ = 0;
+
+  /// Names of the active gesture contexts
+  vector<string> active_contexts_;
+
+  /// Indexes of the SubscribedGestures in active contexts, in increasing order
+  vector<size_t> active_gestures_;
+
+  /// Whether active_gestures_ needs to be rebuilt
+  bool active_gestures_stale_ = true;
+
+  /// Mask of the rotations the input is matched under
+  uint32_t rotation_mask_ = LAGER_ROTATIONS_IDENTITY;
+
+  /// Indexes of the rotations in rotation_mask_
+  vector<unsigned int> rotations_;
+
+  /// Input gesture under each rotation, by rotation index
+  vector<string> rotated_inputs_;
+
+  /// Run-length representation of the input under each rotation
+  vector<RunLengthLager> rotated_run_length_inputs_;
+
+  /// Input histogram under every rotation, one row of rotations per bin
+  int rotated_histogram_lanes_[LAGER_HISTOGRAM_BINS * NUM_LAGER_ROTATIONS];
+
+  /// Histogram lower bound of each SubscribedGesture under each rotation
+  vector<float> rotation_lower_bounds_;
+
+  /// Order in which the rotations are tried for the current gesture
+  vector<unsigned int> rotation_order_;
+
+  /// Order in which the SubscribedGestures are scored for the current input
+  vector<struct ScoringOrderEntry> scoring_order_;
+
+  /// Counters for deadline-aware rankings
+  struct DeadlineStatistics deadline_statistics_;
+
+  /// Ranking buffer reused by RecognizeGesture()
+  vector<struct RecognitionCandidate> ranking_;
+
+  /// Number of gestures scored for the latest ranking
+  unsigned long ranking_num_scored_ = 0;
+
+  /// Distance threshold applied to the latest ranking
+  int ranking_threshold_pct_ = 0;
+
+  /// Minimum gap between the two closest gestures for the distance engine to
+  /// decide without the ML classifier
+  float cascade_margin_pct_ = CASCADE_MARGIN_PCT;
+
+  /// Number of closest candidates that vote for the recognized gesture name
+  unsigned int vote_neighbors_ = DEFAULT_VOTE_NEIGHBORS;
+
+  /// Per-stage decision counters for the cascade recognizer
+  struct CascadeStatistics cascade_statistics_;
 };
 
 #endif /* LIBLAGER_RECOGNIZE_H_ */
@@ -1,7 +1,14 @@
+#include <stdlib.h>     // for atof, atol
 #include <boost/thread/thread.hpp>
+#include <atomic>
+#include <chrono>
+using std::chrono::milliseconds;
 #include <iostream>
 using std::cout;
 using std::endl;
+#include <memory>
+using std::shared_ptr;
+#include <mutex>
 #include <string>
 using std::string;
 #include <fstream>
@@ -18,18 +25,52 @@ using std::vector;
 #include "liblager_connect.h"
 #include "liblager_convert.h"
 #include "liblager_recognize.h"
+#include "lager_early_commit.h"
+#include "lager_exemplars.h"
+#include "lager_gesture_library.h"
+#include "lager_gesture_reloader.h"
+#include "lager_recognition_server.h"
+#include "string_tokenizer.h"
 
 /* Globals */
 
 /// Global vector of SubscribedGestures
 vector<SubscribedGesture> g_subscribed_gestures;
 
+/// Global gesture contexts activated by the subscribed processes
+ActiveGestureContexts g_active_gesture_contexts;
+
+/// Held while the subscribed gestures are modified, by subscriptions or a
+/// reloaded gestures file, and by every thread that reads them
+std::mutex g_subscribed_gestures_mutex;
+
+/// Incremented under g_subscribed_gestures_mutex whenever the subscribed
+/// gestures change, so readers can tell without taking the mutex
+std::atomic<unsigned int> g_subscribed_gestures_generation(0);
+
+/// Copy of the subscribed gestures that the main loop recognizes against, so
+/// that scoring and the ML classifier run without holding
+/// g_subscribed_gestures_mutex. Only used by the main thread.
+vector<SubscribedGesture> g_recognition_gestures;
+
 /*****************************************************************************
  *
  Callback handler
  *
  *****************************************************************************/
 
+/**
+ * Takes the LaGeR string of the gesture being drawn and a pointer to the
+ * EarlyCommitTracker, and returns whether the gesture can be committed to
+ * before it has finished.
+ */
+bool HandleLagerUpdate(const string& lager_string, void* user_data) {
+  EarlyCommitTracker* early_commit_tracker =
+      static_cast<EarlyCommitTracker*>(user_data);
+  std::lock_guard<std::mutex> lock(g_subscribed_gestures_mutex);
+  return early_commit_tracker->Update(lager_string);
+}
+
 /**
  * Reads the program arguments and returns whether a given string is present
  */
@@ -51,6 +92,22 @@ bool DetermineArgumentPresent(const int argc, const char** argv,
   return string_found;
 }
 
+/**
+ * Reads the program arguments and returns the value that follows a given
+ * argument, or a default value if the argument is not present.
+ */
+string DetermineArgumentValue(const int argc, const char** argv,
+                              const char* string_to_find,
+                              const string& default_value) {
+  for (int i = 1; i < argc - 1; i++) {
+    if (string(argv[i]) == string_to_find) {
+      return string(argv[i + 1]);
+    }
+  }
+
+  return default_value;
+}
+
 /**
  * Reads the program arguments and returns whether sensor tracker reports are
  * going to be interpreted as absolute coordinates or as relative movements.
@@ -71,6 +128,33 @@ LCTrackingMode DetermineTrackingMode(const int argc, const char** argv) {
   return tracking_mode;
 }
 
+/**
+ * Reads the program arguments and fills a vector with the OSVR paths of the
+ * sensors to convert, given as a comma-separated list.
+ *
+ * Returns false if no paths were given, in which case the converter keeps
+ * using the left and right hands.
+ */
+bool DetermineSensorPaths(const int argc, const char** argv,
+                          vector<string>& sensor_paths) {
+  TokenizeString(DetermineArgumentValue(argc, argv, "--sensor_paths", ""),
+                 sensor_paths, ",");
+
+  if (sensor_paths.empty()) {
+    cout << "Converting the left and right hand sensors." << endl;
+    return false;
+  }
+
+  cout << "Converting " << sensor_paths.size() << " sensors:";
+  for (vector<string>::iterator it = sensor_paths.begin();
+      it < sensor_paths.end(); ++it) {
+    cout << " " << *it;
+  }
+  cout << endl;
+
+  return true;
+}
+
 /**
  * Reads the program arguments and returns whether sensor buttons are going to
  * be used to start/stop gesture detection, or whether buttons will be ignored
@@ -93,12 +177,32 @@ bool DetermineButtonUse(const int argc, const char** argv) {
 /**
  * Reads the program arguments and returns whether the gesture input is going
  * to be compared to subscribed gestures or to a fixed list of gestures in a
- * file.
+ * file, a gesture plugin or a gesture library.
+ *
+ * Plugins and libraries are generated from a gestures file by
+ * lager_compile_gestures. A plugin is set with --gesture_plugin <path> and
+ * stored in gesture_plugin_path, and a library with --gesture_library <path>
+ * and stored in gesture_library_path.
  */
-bool DetermineGesturesFileUse(const int argc, const char** argv) {
+bool DetermineGesturesFileUse(const int argc, const char** argv,
+                              string& gesture_plugin_path,
+                              string& gesture_library_path) {
   bool use_gestures_file;
 
-  if (DetermineArgumentPresent(argc, argv, "--use_gestures_file")) {
+  gesture_plugin_path = DetermineArgumentValue(argc, argv, "--gesture_plugin",
+                                               "");
+  gesture_library_path = DetermineArgumentValue(argc, argv,
+                                                "--gesture_library", "");
+
+  if (!gesture_library_path.empty()) {
+    cout << "Comparing input to gestures in " << gesture_library_path << "."
+         << endl;
+    use_gestures_file = true;
+  } else if (!gesture_plugin_path.empty()) {
+    cout << "Comparing input to gestures in " << gesture_plugin_path << "."
+         << endl;
+    use_gestures_file = true;
+  } else if (DetermineArgumentPresent(argc, argv, "--use_gestures_file")) {
     cout << "Comparing input to gestures in a file." << endl;
     use_gestures_file = true;
   } else {
@@ -127,6 +231,87 @@ bool DetermineUpdatePrinting(const int argc, const char** argv) {
   return print_updates;
 }
 
+/**
+ * Reads the program arguments and returns whether the end of each gesture is
+ * detected with a timer instead of by checking the time after every update.
+ * The sensors are polled either way.
+ */
+bool DeterminePauseTimerUse(const int argc, const char** argv) {
+  bool use_pause_timer;
+
+  if (DetermineArgumentPresent(argc, argv, "--pause_timer")) {
+    cout << "Detecting the end of gestures with a timer." << endl;
+    use_pause_timer = true;
+  } else {
+    cout << "Detecting the end of gestures after every update." << endl;
+    use_pause_timer = false;
+  }
+
+  return use_pause_timer;
+}
+
+/**
+ * Reads the program arguments and returns how sensor jitter is filtered out
+ * before conversion.
+ *
+ * Positions are smoothed with --smooth_positions, tuned with
+ * --smoothing_min_cutoff <Hz> and --smoothing_beta <value>, and letters only
+ * change once a movement leaves its direction cone by --angle_hysteresis
+ * <degrees>.
+ */
+LagerFilterSettings DetermineFilterSettings(const int argc,
+                                            const char** argv) {
+  LagerFilterSettings filter_settings;
+
+  filter_settings.smooth_positions = DetermineArgumentPresent(
+      argc, argv, "--smooth_positions");
+  filter_settings.min_cutoff_hz = atof(DetermineArgumentValue(
+      argc, argv, "--smoothing_min_cutoff",
+      std::to_string(LAGER_FILTER_MIN_CUTOFF_HZ)).c_str());
+  filter_settings.beta = atof(DetermineArgumentValue(
+      argc, argv, "--smoothing_beta",
+      std::to_string(LAGER_FILTER_BETA)).c_str());
+  filter_settings.angle_hysteresis_degrees = atof(DetermineArgumentValue(
+      argc, argv, "--angle_hysteresis", "0").c_str());
+
+  if (filter_settings.smooth_positions) {
+    cout << "Smoothing sensor positions (min cutoff: "
+         << filter_settings.min_cutoff_hz << " Hz, beta: "
+         << filter_settings.beta << ")." << endl;
+  }
+  if (filter_settings.angle_hysteresis_degrees > 0) {
+    cout << "Changing movement letters with "
+         << filter_settings.angle_hysteresis_degrees
+         << " degrees of hysteresis." << endl;
+  }
+
+  return filter_settings;
+}
+
+/**
+ * Reads the program arguments and returns what the converter does with a
+ * completed gesture when too many are waiting to be recognized.
+ *
+ * If no policy is specified, the oldest waiting gesture is dropped.
+ */
+LagerQueueOverflow DetermineGestureQueueOverflow(const int argc,
+                                                 const char** argv) {
+  string overflow = DetermineArgumentValue(argc, argv,
+                                           "--gesture_queue_overflow",
+                                           "drop_oldest");
+
+  if (overflow == "drop_newest") {
+    cout << "Dropping new gestures while the gesture queue is full." << endl;
+    return LagerQueueOverflow::drop_newest;
+  } else if (overflow == "block") {
+    cout << "Waiting for recognition while the gesture queue is full." << endl;
+    return LagerQueueOverflow::block;
+  } else {
+    cout << "Dropping old gestures while the gesture queue is full." << endl;
+    return LagerQueueOverflow::drop_oldest;
+  }
+}
+
 /**
  * Reads the program arguments and returns whether or not the input and
  * subscribed gestures will be drawn on screen via lager_viewer.
@@ -145,6 +330,174 @@ bool DetermineGestureDrawing(const int argc, const char** argv) {
   return draw_gestures;
 }
 
+/**
+ * Reads the program arguments and returns which algorithm will be used to
+ * compute the distance between the input and the subscribed gestures.
+ */
+LRDistanceEngine DetermineDistanceEngine(const int argc, const char** argv) {
+  LRDistanceEngine distance_engine;
+
+  if (DetermineArgumentPresent(argc, argv, "--run_length_distance")) {
+    cout << "Comparing run-length encoded movements." << endl;
+    distance_engine = LRDistanceEngine::run_length;
+  } else {
+    cout << "Comparing expanded LaGeR strings with Damerau-Levenshtein." << endl;
+    distance_engine = LRDistanceEngine::damerau_levenshtein;
+  }
+
+  return distance_engine;
+}
+
+/**
+ * Reads the program arguments and returns the mask of rotations under which
+ * input gestures are matched, set with --rotations <identity|vertical|all>.
+ */
+uint32_t DetermineRotations(const int argc, const char** argv) {
+  string rotations = DetermineArgumentValue(argc, argv, "--rotations",
+                                            "identity");
+  uint32_t rotation_mask;
+
+  if (rotations == "all") {
+    cout << "Matching gestures under all 24 sensor orientations." << endl;
+    rotation_mask = LAGER_ROTATIONS_ALL;
+  } else if (rotations == "vertical") {
+    cout << "Matching gestures under rotations about the vertical axis."
+         << endl;
+    rotation_mask = LAGER_ROTATIONS_VERTICAL_AXIS;
+  } else {
+    cout << "Matching gestures in their subscribed orientation only." << endl;
+    rotation_mask = LAGER_ROTATIONS_IDENTITY;
+  }
+
+  return rotation_mask;
+}
+
+/**
+ * Reads the program arguments and returns whether the machine learning
+ * classifier is only used when the distance engine has no clear winner.
+ *
+ * The margin between the two closest gestures that is considered a clear
+ * winner can be set with --cascade_margin <percentage points>.
+ */
+bool DetermineCascadeUse(const int argc, const char** argv,
+                         float& cascade_margin_pct) {
+  bool use_cascade;
+
+  cascade_margin_pct = atof(DetermineArgumentValue(
+      argc, argv, "--cascade_margin",
+      std::to_string(CASCADE_MARGIN_PCT)).c_str());
+
+  if (DetermineArgumentPresent(argc, argv, "--cascade")) {
+    cout << "Using the ML classifier only for ambiguous gestures (margin: "
+         << cascade_margin_pct << " %)." << endl;
+    use_cascade = true;
+  } else {
+    cout << "Using both the distance engine and the ML classifier." << endl;
+    use_cascade = false;
+  }
+
+  return use_cascade;
+}
+
+/**
+ * Reads the program arguments and returns whether gestures are committed to
+ * as soon as only one subscribed gesture can still match them.
+ *
+ * The distance threshold used for early commits can be set with
+ * --early_commit_threshold <percentage>.
+ */
+bool DetermineEarlyCommitUse(const int argc, const char** argv,
+                             float& early_commit_threshold_pct) {
+  bool use_early_commit;
+
+  early_commit_threshold_pct = atof(DetermineArgumentValue(
+      argc, argv, "--early_commit_threshold",
+      std::to_string(EARLY_COMMIT_DISTANCE_THRESHOLD_PCT)).c_str());
+
+  if (DetermineArgumentPresent(argc, argv, "--early_commit")) {
+    cout << "Committing to gestures before they finish (threshold: "
+         << early_commit_threshold_pct << " %)." << endl;
+    use_early_commit = true;
+  } else {
+    cout << "Waiting for gestures to finish before recognizing them." << endl;
+    use_early_commit = false;
+  }
+
+  return use_early_commit;
+}
+
+/**
+ * Reads the program arguments and returns the recognition time budget in
+ * milliseconds set with --deadline_ms, or 0 if recognition is not bounded.
+ */
+long DetermineRecognitionDeadline(const int argc, const char** argv) {
+  long deadline_ms = atol(DetermineArgumentValue(argc, argv, "--deadline_ms",
+                                                 "0").c_str());
+
+  if (deadline_ms > 0) {
+    cout << "Returning the best gesture found within " << deadline_ms
+         << " ms." << endl;
+  } else {
+    deadline_ms = 0;
+  }
+
+  return deadline_ms;
+}
+
+/**
+ * Reads the program arguments and returns whether gestures with many recorded
+ * exemplars are reduced to a few representatives per name before recognition.
+ *
+ * The number of representatives kept per name can be set with
+ * --max_representatives <count>, and the number of closest gestures that vote
+ * for the recognized name with --vote_neighbors <count>.
+ */
+bool DetermineExemplarCompression(const int argc, const char** argv,
+                                  unsigned int& max_representatives,
+                                  unsigned int& vote_neighbors) {
+  bool compress_exemplars =
+      DetermineArgumentPresent(argc, argv, "--compress_exemplars");
+
+  max_representatives = atol(DetermineArgumentValue(
+      argc, argv, "--max_representatives",
+      std::to_string(DEFAULT_MAX_CLASS_REPRESENTATIVES)).c_str());
+  vote_neighbors = atol(DetermineArgumentValue(
+      argc, argv, "--vote_neighbors",
+      std::to_string(compress_exemplars ? DEFAULT_CLASS_VOTE_NEIGHBORS :
+                     DEFAULT_VOTE_NEIGHBORS)).c_str());
+
+  if (compress_exemplars) {
+    cout << "Keeping up to " << max_representatives
+         << " representatives per gesture name." << endl;
+  }
+  if (vote_neighbors > 1) {
+    cout << "Letting the " << vote_neighbors
+         << " closest gestures vote for the recognized name." << endl;
+  }
+
+  return compress_exemplars;
+}
+
+/**
+ * Reads the program arguments and returns whether other processes can send
+ * their own LaGeR strings to be scored, which is enabled with
+ * --recognition_service.
+ *
+ * The socket path can be set with --recognition_socket <path>, and the number
+ * of worker threads with --recognition_workers <count>.
+ */
+bool DetermineRecognitionService(const int argc, const char** argv,
+                                 string& socket_path,
+                                 unsigned int& num_workers) {
+  socket_path = DetermineArgumentValue(argc, argv, "--recognition_socket",
+                                       RECOGNITION_SOCKET_PATH);
+  num_workers = atol(DetermineArgumentValue(argc, argv,
+                                            "--recognition_workers",
+                                            "0").c_str());
+
+  return DetermineArgumentPresent(argc, argv, "--recognition_service");
+}
+
 /**
  * Reads a file named gestures.dat and parses it to save its gestures into the
  * global vector of SubscribedGestures.
@@ -172,6 +525,80 @@ int GetSubscribedGesturesFromFile() {
   return RECOGNIZER_NO_ERROR;
 }
 
+/**
+ * Takes the path of a gesture plugin and hands its gestures, already encoded,
+ * to the recognizer, which appends them to the gestures it recognizes against.
+ * They are then copied into the global vector of SubscribedGestures.
+ */
+int GetSubscribedGesturesFromPlugin(const string& gesture_plugin_path,
+                                    LagerRecognizer* lager_recognizer) {
+  const struct LagerGesturePlugin* plugin =
+      LoadLagerGesturePlugin(gesture_plugin_path);
+  if (plugin == NULL) {
+    return RECOGNIZER_ERROR;
+  }
+
+  lager_recognizer->AddPluginGestures(*plugin);
+  g_subscribed_gestures = g_recognition_gestures;
+  cout << "Added " << plugin->num_gestures << " gestures compiled from "
+       << plugin->source_file << endl;
+
+  return RECOGNIZER_NO_ERROR;
+}
+
+/**
+ * Takes the path of a gesture library and maps it, then hands its gestures,
+ * already encoded, to the recognizer, which copies them into the gestures it
+ * recognizes against and from there into the global vector of
+ * SubscribedGestures. The library is unmapped on return.
+ */
+int GetSubscribedGesturesFromLibrary(const string& gesture_library_path,
+                                     LagerRecognizer* lager_recognizer) {
+  LagerGestureLibrary gesture_library;
+
+  if (!gesture_library.Open(gesture_library_path)) {
+    return RECOGNIZER_ERROR;
+  }
+
+  lager_recognizer->AddPluginGestures(gesture_library.GetGestureTable());
+  g_subscribed_gestures = g_recognition_gestures;
+  cout << "Added " << gesture_library.GetGestureTable().num_gestures
+       << " gestures from " << gesture_library_path << endl;
+
+  return RECOGNIZER_NO_ERROR;
+}
+
+/**
+ * Takes the gestures file reloader, the recognizer, the early commit tracker
+ * and the generation of the recognizer's copy of the subscribed gestures, and
+ * replaces the gestures of both with the ones compiled since the last
+ * recognition, if the gestures file changed.
+ */
+void ApplyReloadedGestures(GestureFileReloader* gestures_file_reloader,
+                           LagerRecognizer* lager_recognizer,
+                           EarlyCommitTracker* early_commit_tracker,
+                           unsigned int* recognition_gestures_generation) {
+  shared_ptr<const CompiledGestureSet> reloaded_gestures =
+      gestures_file_reloader->TakeReloadedGestures();
+  if (!reloaded_gestures) {
+    return;
+  }
+
+  // The recognizer's gestures belong to the main thread, so only publishing
+  // them takes the mutex
+  lager_recognizer->ReplaceWithPluginGestures(reloaded_gestures->table);
+  lager_recognizer->SetClassifierGestureIndexes(
+      reloaded_gestures->representative_indexes);
+
+  std::lock_guard<std::mutex> lock(g_subscribed_gestures_mutex);
+  g_subscribed_gestures = g_recognition_gestures;
+  *recognition_gestures_generation = ++g_subscribed_gestures_generation;
+  early_commit_tracker->Reset();
+
+  cout << "Now recognizing " << g_subscribed_gestures.size()
+       << " gestures from " << reloaded_gestures->file_path << endl;
+}
+
 /**
  * Takes a reference to a SubscribedGesture and an input gesture LaGeR string,
  * and draws them on screen via lager_viewer.
@@ -222,30 +649,171 @@ int main(int argc, const char *argv[]) {
 
   LCTrackingMode tracking_mode = DetermineTrackingMode(argc, argv);
   bool use_buttons = DetermineButtonUse(argc, argv);
-  bool use_gestures_file = DetermineGesturesFileUse(argc, argv);
+  string gesture_plugin_path;
+  string gesture_library_path;
+  bool use_gestures_file = DetermineGesturesFileUse(argc, argv,
+                                                    gesture_plugin_path,
+                                                    gesture_library_path);
   bool print_updates = DetermineUpdatePrinting(argc, argv);
+  bool use_pause_timer = DeterminePauseTimerUse(argc, argv);
+  vector<string> sensor_paths;
+  bool use_sensor_paths = DetermineSensorPaths(argc, argv, sensor_paths);
+  LagerQueueOverflow gesture_queue_overflow = DetermineGestureQueueOverflow(
+      argc, argv);
+  LagerFilterSettings filter_settings = DetermineFilterSettings(argc, argv);
   bool draw_gestures = DetermineGestureDrawing(argc, argv);
+  LRDistanceEngine distance_engine = DetermineDistanceEngine(argc, argv);
+  uint32_t rotation_mask = DetermineRotations(argc, argv);
+  float cascade_margin_pct;
+  bool use_cascade = DetermineCascadeUse(argc, argv, cascade_margin_pct);
+  long deadline_ms = DetermineRecognitionDeadline(argc, argv);
+  float early_commit_threshold_pct;
+  bool use_early_commit = DetermineEarlyCommitUse(argc, argv,
+                                                  early_commit_threshold_pct);
+  unsigned int max_representatives;
+  unsigned int vote_neighbors;
+  bool compress_exemplars = DetermineExemplarCompression(argc, argv,
+                                                         max_representatives,
+                                                         vote_neighbors);
+  string recognition_socket_path;
+  unsigned int num_recognition_workers;
+  bool use_recognition_service = DetermineRecognitionService(
+      argc, argv, recognition_socket_path, num_recognition_workers);
   bool match_found = false;
+  bool partial_result = false;
   LagerConverter* lager_converter = LagerConverter::Instance();
-  LagerRecognizer* lager_recognizer = LagerRecognizer::Instance(&g_subscribed_gestures);
-
-  if (use_gestures_file) {
+  LagerRecognizer* lager_recognizer = LagerRecognizer::Instance(
+      &g_recognition_gestures);
+  lager_recognizer->SetDistanceEngine(distance_engine);
+  lager_recognizer->SetRotations(rotation_mask);
+  lager_recognizer->SetCascadeMargin(cascade_margin_pct);
+  lager_recognizer->SetVoteNeighbors(vote_neighbors);
+  EarlyCommitTracker early_commit_tracker(&g_subscribed_gestures);
+  early_commit_tracker.SetThreshold(early_commit_threshold_pct);
+  early_commit_tracker.SetUseRunLengthDistance(
+      distance_engine == LRDistanceEngine::run_length);
+
+  if (!gesture_library_path.empty()) {
+    // Library gestures are used as compiled, without exemplar compression
+    if (GetSubscribedGesturesFromLibrary(gesture_library_path,
+                                         lager_recognizer)
+        == RECOGNIZER_ERROR) {
+      return RECOGNIZER_ERROR;
+    }
+  } else if (!gesture_plugin_path.empty()) {
+    // Plugin gestures are used as compiled, without exemplar compression
+    if (GetSubscribedGesturesFromPlugin(gesture_plugin_path, lager_recognizer)
+        == RECOGNIZER_ERROR) {
+      return RECOGNIZER_ERROR;
+    }
+  } else if (use_gestures_file) {
     GetSubscribedGesturesFromFile();
+
+    // Exemplars are only known up front when they come from the file
+    if (compress_exemplars) {
+      vector<SubscribedGesture> representatives;
+      vector<size_t> representative_indexes;
+      CompressGestureClasses(g_subscribed_gestures, max_representatives,
+                             distance_engine == LRDistanceEngine::run_length,
+                             0, representatives, representative_indexes);
+      g_subscribed_gestures.swap(representatives);
+      lager_recognizer->SetClassifierGestureIndexes(representative_indexes);
+    }
   } else {
     CreateGestureSubscriptionQueue();
-    boost::thread subscription_updater(AddSubscribedGestures, &g_subscribed_gestures);
+    boost::thread subscription_updater(AddSubscribedGestures,
+                                       &g_subscribed_gestures,
+                                       &g_subscribed_gestures_mutex,
+                                       &g_subscribed_gestures_generation);
+    CreateGestureContextQueue();
+    boost::thread context_updater(MonitorActiveGestureContexts,
+                                  &g_active_gesture_contexts);
+  }
+  unsigned int active_contexts_generation = 0;
+
+  // Gestures loaded up front are recognized against straight away
+  unsigned int recognition_gestures_generation;
+  {
+    std::lock_guard<std::mutex> lock(g_subscribed_gestures_mutex);
+    g_recognition_gestures = g_subscribed_gestures;
+    recognition_gestures_generation = g_subscribed_gestures_generation;
+  }
+
+  LagerRecognitionServer recognition_server(&g_subscribed_gestures,
+                                            recognition_socket_path,
+                                            num_recognition_workers);
+  recognition_server.SetSubscribedGesturesMutex(
+      &g_subscribed_gestures_mutex, &g_subscribed_gestures_generation);
+  if (use_recognition_service) {
+    recognition_server.SetUseRunLengthDistance(
+        distance_engine == LRDistanceEngine::run_length);
+    recognition_server.Start();
+  }
+
+  // Gestures file edits are picked up between recognitions
+  GestureFileReloader gestures_file_reloader("gestures.dat");
+  if (use_gestures_file && gesture_plugin_path.empty()
+      && gesture_library_path.empty()) {
+    gestures_file_reloader.SetMaxRepresentatives(
+        compress_exemplars ? max_representatives : 0);
+    gestures_file_reloader.SetUseRunLengthDistance(
+        distance_engine == LRDistanceEngine::run_length);
+    gestures_file_reloader.Start();
   }
 
   lager_converter->SetPrintUpdates(print_updates);
   lager_converter->SetTrackingMode(tracking_mode);
   lager_converter->SetUseButtons(use_buttons);
+  lager_converter->SetUsePauseTimer(use_pause_timer);
+  if (use_sensor_paths) {
+    lager_converter->SetSensorPaths(sensor_paths);
+  }
+  lager_converter->SetGestureQueueOverflow(gesture_queue_overflow);
+  lager_converter->SetFilterSettings(filter_settings);
+  if (use_early_commit) {
+    lager_converter->SetLagerUpdateCallback(HandleLagerUpdate,
+                                            &early_commit_tracker);
+  }
   lager_converter->Start();
 
 
 
   while(true) {
     string gesture_string = lager_converter->BlockingGetLagerString();
-    if (g_subscribed_gestures.size() > 0) {
+    ApplyReloadedGestures(&gestures_file_reloader, lager_recognizer,
+                          &early_commit_tracker,
+                          &recognition_gestures_generation);
+
+    /*
+     * Only copying the subscribed gestures and taking the early commit hold
+     * the mutex. Recognition runs on the copy, so it never keeps the converter
+     * or the recognition service waiting.
+     */
+    bool gesture_committed = false;
+    size_t committed_gesture_index;
+    {
+      std::lock_guard<std::mutex> lock(g_subscribed_gestures_mutex);
+      if (g_subscribed_gestures_generation
+          != recognition_gestures_generation) {
+        g_recognition_gestures = g_subscribed_gestures;
+        recognition_gestures_generation = g_subscribed_gestures_generation;
+      }
+
+      if (g_active_gesture_contexts.generation()
+          != active_contexts_generation) {
+        lager_recognizer->SetActiveContexts(
+            g_active_gesture_contexts.GetActiveContexts(
+                active_contexts_generation));
+        early_commit_tracker.SetActiveContexts(
+            lager_recognizer->GetActiveContexts());
+      }
+
+      gesture_committed = use_early_commit
+          && early_commit_tracker.TakeCommittedGesture(
+              gesture_string, committed_gesture_index);
+    }
+
+    if (g_recognition_gestures.size() > 0) {
 
       cout << endl;
 
@@ -257,11 +825,29 @@ int main(int argc, const char *argv[]) {
 
       cout << gesture_string << endl << endl;
 
-      lager_recognizer->RecognizeGesture(
-          draw_gestures, gesture_string, match_found);
+      SubscribedGesture recognized_gesture;
+      time_point<system_clock> deadline = time_point<system_clock>::max();
+      if (deadline_ms > 0) {
+        deadline = system_clock::now() + milliseconds(deadline_ms);
+      }
 
-      SubscribedGesture recognized_gesture = lager_recognizer->RecognizeGestureML(
-          gesture_string, match_found);
+      // The tracker only commits once the distance engine agrees, so the
+      // handed over prefix is a match
+      if (gesture_committed) {
+        recognized_gesture = g_recognition_gestures[committed_gesture_index];
+        match_found = true;
+      } else if (use_cascade) {
+        recognized_gesture = lager_recognizer->RecognizeGestureCascade(
+            draw_gestures, gesture_string, match_found, deadline,
+            partial_result);
+      } else {
+        lager_recognizer->RecognizeGesture(
+            draw_gestures, gesture_string, match_found, deadline,
+            partial_result);
+
+        recognized_gesture = lager_recognizer->RecognizeGestureML(
+            gesture_string, match_found);
+      }
 
       if (!match_found) {
         continue;
@@ -271,10 +857,10 @@ int main(int argc, const char *argv[]) {
         DrawMatchingGestures(recognized_gesture, gesture_string);
       }
 
-      if (!use_gestures_file && recognized_gesture.pid != 0) {
+      if (!use_gestures_file) {
         cout << "Sending detected gesture" << endl;
-        SendDetectedGestureMessage(recognized_gesture.name,
-                                    recognized_gesture.pid);
+        SendDetectedGestureMessages(recognized_gesture,
+                                    lager_recognizer->GetActiveContexts());
       }
     }
   }